@@ -52,6 +52,12 @@ struct BinaryBinBlock
 	Buffer metaData;
 	Buffer dnaData;
 
+	// when not empty, the data of the descriptors is not copied into the buffers above,
+	// but referenced in place -- e.g. in a memory-mapped file
+	//
+	std::vector<const byte*> metaSpans;
+	std::vector<const byte*> dnaSpans;
+
 	uint64 metaSize;
 	uint64 dnaSize;
 	uint64 rawDnaSize;
@@ -68,6 +74,9 @@ struct BinaryBinBlock
 		metaSize = 0;
 		dnaSize = 0;
 		rawDnaSize = 0;
+
+		metaSpans.clear();
+		dnaSpans.clear();
 	}
 };
 
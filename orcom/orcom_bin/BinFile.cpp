@@ -20,6 +20,7 @@
 BinFileWriter::BinFileWriter()
 	:	metaStream(NULL)
 	,	dnaStream(NULL)
+	,	ownsStreams(true)
 	,	currentBlockId(0)
 	,	minimizersCount(0)
 {		
@@ -29,6 +30,9 @@ BinFileWriter::BinFileWriter()
 
 BinFileWriter::~BinFileWriter()
 {
+	if (!ownsStreams)
+		return;
+
 	if (metaStream != NULL)
 		delete metaStream;
 
@@ -48,7 +52,28 @@ void BinFileWriter::StartCompress(const std::string& fileName_, const BinModuleC
 	dnaStream = new FileStreamWriter(fileName_ + ".bdna");
 	((FileStreamWriter*)dnaStream)->SetBuffering(true);
 
+	ownsStreams = true;
+	StartCompress(params_);
+}
+
+
+void BinFileWriter::StartCompress(IDataStreamWriter* metaStream_, IDataStreamWriter* dnaStream_, const BinModuleConfig& params_)
+{
+	ASSERT(metaStream == NULL);
+	ASSERT(dnaStream == NULL);
+	ASSERT(metaStream_ != NULL);
+	ASSERT(dnaStream_ != NULL);
+
+	metaStream = metaStream_;
+	dnaStream = dnaStream_;
 
+	ownsStreams = false;
+	StartCompress(params_);
+}
+
+
+void BinFileWriter::StartCompress(const BinModuleConfig& params_)
+{
 	// clear header and footer
 	//
 	std::fill((uchar*)&fileHeader, (uchar*)&fileHeader + sizeof(BinFileHeader), 0);
@@ -120,8 +145,11 @@ void BinFileWriter::FinishCompress()
 	metaStream->Close();
 	dnaStream->Close();
 
-	delete metaStream;
-	delete dnaStream;
+	if (ownsStreams)
+	{
+		delete metaStream;
+		delete dnaStream;
+	}
 
 	metaStream = NULL;
 	dnaStream = NULL;
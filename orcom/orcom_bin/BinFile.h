@@ -59,6 +59,11 @@ public:
 
 	void StartCompress(const std::string& filename_, const BinModuleConfig& params_);
 
+	// writes to the given streams, which are only closed when finished -- they remain
+	// owned by the caller
+	//
+	void StartCompress(IDataStreamWriter* metaStream_, IDataStreamWriter* dnaStream_, const BinModuleConfig& params_);
+
 	void WriteNextBlock(const BinaryBinBlock* block_);
 	void FinishCompress();
 
@@ -67,6 +72,7 @@ public:
 protected:
 	IDataStreamWriter* metaStream;
 	IDataStreamWriter* dnaStream;
+	bool ownsStreams;
 
 	BinFileHeader fileHeader;
 	BinFileFooter fileFooter;
@@ -74,6 +80,7 @@ protected:
 	uint64 currentBlockId;
 	uint64 minimizersCount;
 
+	void StartCompress(const BinModuleConfig& params_);
 	void WriteFileHeader();
 	void WriteFileFooter();
 };
@@ -21,22 +21,45 @@
 #include "DnaBlockData.h"
 #include "Exception.h"
 #include "Thread.h"
+#include "MemoryMonitor.h"
 
 
 void BinModule::Fastq2Bin(const std::vector<std::string> &inFastqFiles_, const std::string &outBinFile_,
-						  uint32 threadNum_,  bool compressedInput_, bool verboseMode_)
+						  uint32 threadNum_,  bool compressedInput_, bool verboseMode_,
+						  uint32 sortThreadNum_, bool packedDna_, uint64 memoryBudget_)
+{
+	BinFileWriter binFile;
+	binFile.StartCompress(outBinFile_, config);
+
+	Fastq2Bin(inFastqFiles_, binFile, threadNum_, compressedInput_, verboseMode_, sortThreadNum_, packedDna_,
+			  memoryBudget_);
+}
+
+
+void BinModule::Fastq2Bin(const std::vector<std::string> &inFastqFiles_, BinFileWriter &binFile_,
+						  uint32 threadNum_,  bool compressedInput_, bool verboseMode_,
+						  uint32 sortThreadNum_, bool packedDna_, uint64 memoryBudget_)
 {
 	// TODO: try/catch to free resources
 	//
 	IFastqStreamReader* fastqFile = NULL;
 	if (compressedInput_)
-		fastqFile = new MultiFastqFileReaderGz(inFastqFiles_);
+		fastqFile = new MultiFastqFileReaderGz(inFastqFiles_, threadNum_);
 	else
 		fastqFile = new MultiFastqFileReader(inFastqFiles_);
 
 
-	BinFileWriter binFile;
-	binFile.StartCompress(outBinFile_, config);
+	// fit the pipeline into the memory budget -- the block size stored in the file header
+	// remains the configured one, being an upper bound of the actual one
+	//
+	uint64 fastqBlockSize = config.fastqBlockSize;
+	uint32 partNum = (threadNum_ > 1) ? threadNum_ * 4 : 1;
+	uint32 finalPartNum = partNum;
+
+	if (memoryBudget_ > 0 && !FitMemoryBudget(memoryBudget_, threadNum_, fastqBlockSize, partNum))
+		std::cerr << "Warning: memory budget too small, using the minimal settings" << std::endl;
+
+	MemoryMonitor memoryMonitor(memoryBudget_);
 
 	const uint32 minimizersCount = config.minimizer.TotalMinimizersCount();
 	if (threadNum_ > 1)
@@ -49,15 +72,15 @@ void BinModule::Fastq2Bin(const std::vector<std::string> &inFastqFiles_, const s
 		FastqChunkReader* fastqReader = NULL;
 		BinChunkWriter* binWriter = NULL;
 
-		const uint32 partNum = threadNum_ * 4;
-		fastqPool = new FastqChunkPool(partNum, config.fastqBlockSize);
-		fastqQueue = new FastqChunkQueue(partNum, 1);
+		fastqPool = new FastqChunkPool(partNum, fastqBlockSize);
+		fastqQueue = new FastqChunkQueue(partNum, 1, FastqChunkQueue::UnorderedDelivery);
 
 		binPool = new BinaryPartsPool(partNum, minimizersCount);
 		binQueue = new BinaryPartsQueue(partNum, threadNum_);
 
-		fastqReader = new FastqChunkReader(fastqFile, fastqQueue, fastqPool);
-		binWriter = new BinChunkWriter(&binFile, binQueue, binPool);
+		fastqReader = new FastqChunkReader(fastqFile, fastqQueue, fastqPool,
+										   (memoryBudget_ > 0) ? &memoryMonitor : NULL);
+		binWriter = new BinChunkWriter(&binFile_, binQueue, binPool);
 
 		// launch stuff
 		//
@@ -73,7 +96,7 @@ void BinModule::Fastq2Bin(const std::vector<std::string> &inFastqFiles_, const s
 		{
 			operators[i] = new BinEncoder(config.minimizer, config.catParams,
 										  fastqQueue, fastqPool,
-										  binQueue, binPool);
+										  binQueue, binPool, sortThreadNum_, packedDna_);
 			opThreadGroup.create_thread(mt::ref(*operators[i]));
 		}
 
@@ -89,7 +112,7 @@ void BinModule::Fastq2Bin(const std::vector<std::string> &inFastqFiles_, const s
 		for (uint32 i = 0; i < threadNum_; ++i)
 		{
 			operators[i] = new BinEncoder(config.minimizer, config.catParams,
-										  fastqQueue, fastqPool, binQueue, binPool);
+										  fastqQueue, fastqPool, binQueue, binPool, sortThreadNum_, packedDna_);
 			opThreadGroup.push_back(mt::thread(mt::ref(*operators[i])));
 		}
 
@@ -109,6 +132,8 @@ void BinModule::Fastq2Bin(const std::vector<std::string> &inFastqFiles_, const s
 			delete operators[i];
 		}
 
+		finalPartNum = fastqPool->MaxPartNum();
+
 		TFREE(binWriter);
 		TFREE(fastqReader);
 
@@ -119,11 +144,11 @@ void BinModule::Fastq2Bin(const std::vector<std::string> &inFastqFiles_, const s
 	}
 	else
 	{
-		DnaParser parser;
-		DnaCategorizer categorizer(config.minimizer, config.catParams);
-		DnaPacker packer(config.minimizer);
+		DnaParser parser(packedDna_);
+		DnaCategorizer categorizer(config.minimizer, config.catParams, sortThreadNum_, packedDna_);
+		DnaPacker packer(config.minimizer, packedDna_);
 
-		DataChunk fastqChunk(config.fastqBlockSize);
+		DataChunk fastqChunk(fastqBlockSize);
 		std::vector<DnaRecord> records;
 		records.resize(1 << 10);
 
@@ -141,16 +166,26 @@ void BinModule::Fastq2Bin(const std::vector<std::string> &inFastqFiles_, const s
 
 			packer.PackToBins(dnaBins, binBins);
 
-			binFile.WriteNextBlock(&binBins);
+			binFile_.WriteNextBlock(&binBins);
 		}
 	}
 
-	binFile.FinishCompress();
+	binFile_.FinishCompress();
 
 	if (verboseMode_)
 	{
+		std::cout << "FASTQ block size: " << (fastqBlockSize >> 20) << " MB\n";
+		std::cout << "FASTQ chunks in flight: " << partNum;
+		if (finalPartNum != partNum)
+			std::cout << " (lowered to " << finalPartNum << ")";
+		std::cout << '\n';
+		std::cout << "Peak memory: " << (MemoryMonitor::PeakResidentSize() >> 20) << " MB";
+		if (memoryBudget_ > 0)
+			std::cout << " (budget: " << (memoryBudget_ >> 20) << " MB)";
+		std::cout << "\n\n";
+
 		std::vector<uint64> recordCounts;
-		binFile.GetBinStats(recordCounts);
+		binFile_.GetBinStats(recordCounts);
 
 		std::cout << "Signatures count: " << recordCounts.size() << std::endl;
 		std::cout << "Records distribution in bins by signature:\n";
@@ -195,3 +230,19 @@ void BinModule::Bin2Dna(const std::string &inBinFile_, const std::string &outDna
 	dnaFile.Close();
 	binFile.FinishDecompress();
 }
+
+
+bool BinModule::FitMemoryBudget(uint64 memoryBudget_, uint32 threadNum_, uint64& fastqBlockSize_, uint32& partNum_)
+{
+	// make the pipeline shallower first, as smaller blocks lower the compression ratio
+	//
+	const uint32 minPartNum = MIN(threadNum_, partNum_);
+	while (partNum_ > minPartNum && EstimateMemory(threadNum_, fastqBlockSize_, partNum_) > memoryBudget_)
+		partNum_--;
+
+	while (fastqBlockSize_ > BinModuleConfig::MinFastqBlockSize
+		   && EstimateMemory(threadNum_, fastqBlockSize_, partNum_) > memoryBudget_)
+		fastqBlockSize_ = MAX(fastqBlockSize_ / 2, BinModuleConfig::MinFastqBlockSize);
+
+	return EstimateMemory(threadNum_, fastqBlockSize_, partNum_) <= memoryBudget_;
+}
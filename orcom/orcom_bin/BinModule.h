@@ -17,11 +17,23 @@
 #include "Params.h"
 
 
+class BinFileWriter;
+
 class BinModule
 {
 public:
+	// with the memory budget (in bytes, 0 - not limited) given, the FASTQ block size and
+	// the number of chunks in flight are lowered to fit in it
+	//
 	void Fastq2Bin(const std::vector<std::string>& inFastqFiles_, const std::string& outBinFile_,
-				   uint32 threadNum_ = 1, bool compressedInput_ = false, bool verboseMode_ = false);
+				   uint32 threadNum_ = 1, bool compressedInput_ = false, bool verboseMode_ = false,
+				   uint32 sortThreadNum_ = 1, bool packedDna_ = false, uint64 memoryBudget_ = 0);
+
+	// bins the reads into an already started writer, finishing it
+	//
+	void Fastq2Bin(const std::vector<std::string>& inFastqFiles_, BinFileWriter& binFile_,
+				   uint32 threadNum_ = 1, bool compressedInput_ = false, bool verboseMode_ = false,
+				   uint32 sortThreadNum_ = 1, bool packedDna_ = false, uint64 memoryBudget_ = 0);
 	void Bin2Dna(const std::string& inBinFile_, const std::string& outDnaFile_);
 
 	void SetModuleConfig(const BinModuleConfig& config_)
@@ -29,8 +41,20 @@ public:
 		config = config_;
 	}
 
+	// a rough estimate of the memory used: a FASTQ chunk in flight takes the block size and
+	// a worker thread 1.5 of it -- the parsed, categorized and packed reads
+	//
+	static const uint64 ReservedMemorySize = 1 << 26;		// the output buffers etc.
+
+	static uint64 EstimateMemory(uint32 threadNum_, uint64 fastqBlockSize_, uint32 partNum_)
+	{
+		return ReservedMemorySize + fastqBlockSize_ * (2 * partNum_ + 3 * threadNum_) / 2;
+	}
+
 private:
 	BinModuleConfig config;
+
+	static bool FitMemoryBudget(uint64 memoryBudget_, uint32 threadNum_, uint64& fastqBlockSize_, uint32& partNum_);
 };
 
 
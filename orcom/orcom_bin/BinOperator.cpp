@@ -49,6 +49,13 @@ void FastqChunkReader::Run()
 	{
 		partsQueue->Push(partId++, part);
 
+		if (memoryMonitor != NULL && memoryMonitor->IsOverBudget())
+		{
+			const uint32 partNum = partsPool->MaxPartNum();
+			if (partNum > 1)
+				partsPool->LowerMaxPartNum(partNum - 1);
+		}
+
 		partsPool->Acquire(part);
 	}
 
@@ -77,8 +84,8 @@ void BinChunkWriter::Run()
 
 void BinEncoder::Run()
 {
-	DnaPacker packer(params);
-	DnaCategorizer categorizer(params, catParams);
+	DnaPacker packer(params, packedDna);
+	DnaCategorizer categorizer(params, catParams, sortThreadsNum, packedDna);
 
 	int64 partId = 0;
 	DataChunk* fqPart = NULL;
@@ -88,7 +95,7 @@ void BinEncoder::Run()
 	std::vector<DnaRecord> records;
 	records.resize(1 << 10);
 
-	DnaParser parser;
+	DnaParser parser(packedDna);
 
 	DataChunk dnaBuffer;
 
@@ -14,6 +14,7 @@
 #include "DataQueue.h"
 #include "BinBlockData.h"
 #include "Params.h"
+#include "MemoryMonitor.h"
 
 typedef BinaryBinBlock BinaryPart;
 
@@ -28,13 +29,18 @@ typedef TDataQueue<DataChunk> FastqChunkQueue;
 
 // TODO: readers and writers can be fully templatized
 //
+// when given the memory monitor, lowers the number of FASTQ chunks in flight each time
+// the memory budget is exceeded
+//
 class FastqChunkReader : public IOperator
 {
 public:
-	FastqChunkReader(IFastqStreamReader* partsStream_, FastqChunkQueue* partsQueue_, FastqChunkPool* partsPool_)
+	FastqChunkReader(IFastqStreamReader* partsStream_, FastqChunkQueue* partsQueue_, FastqChunkPool* partsPool_,
+					 const MemoryMonitor* memoryMonitor_ = NULL)
 		:	partsStream(partsStream_)
 		,	partsQueue(partsQueue_)
 		,	partsPool(partsPool_)
+		,	memoryMonitor(memoryMonitor_)
 	{}
 
 	void Run();
@@ -43,6 +49,7 @@ private:
 	IFastqStreamReader* partsStream;
 	FastqChunkQueue* partsQueue;
 	FastqChunkPool* partsPool;
+	const MemoryMonitor* memoryMonitor;
 };
 
 
@@ -70,9 +77,12 @@ public:
 	BinEncoder(const MinimizerParameters& params_,
 			   const CategorizerParameters& catParams_,
 			   FastqChunkQueue* fqPartsQueue_, FastqChunkPool* fqPartsPool_,
-			   BinaryPartsQueue* binPartsQueue_, BinaryPartsPool* binPartsPool_)
+			   BinaryPartsQueue* binPartsQueue_, BinaryPartsPool* binPartsPool_,
+			   uint32 sortThreadsNum_ = 1, bool packedDna_ = false)
 		:	params(params_)
 		,	catParams(catParams_)
+		,	sortThreadsNum(sortThreadsNum_)
+		,	packedDna(packedDna_)
 		,	fqPartsQueue(fqPartsQueue_)
 		,	fqPartsPool(fqPartsPool_)
 		,	binPartsQueue(binPartsQueue_)
@@ -82,6 +92,8 @@ public:
 protected:
 	const MinimizerParameters params;
 	const CategorizerParameters catParams;
+	const uint32 sortThreadsNum;
+	const bool packedDna;
 
 	FastqChunkQueue* fqPartsQueue;
 	FastqChunkPool* fqPartsPool;
@@ -21,7 +21,7 @@
 class BitMemoryReader
 {
 public:
-	BitMemoryReader(const Buffer& buffer_, uint64 size_)
+	BitMemoryReader(const IBuffer& buffer_, uint64 size_)
 		:	buffer(buffer_)
 		,	size(size_)
 		,	position(0)
@@ -116,6 +116,56 @@ public:
 		return word;
 	}
 
+	// reads n_ symbols of bitsPerSymbol_ bits each, translating the codes using the table
+	//
+	void GetSymbols(char* symbols_, uint32 n_, const char* codeToSymbol_, uint32 bitsPerSymbol_)
+	{
+		switch (bitsPerSymbol_)
+		{
+			case 2:		GetSymbols<2>(symbols_, n_, codeToSymbol_);		break;
+			case 3:		GetSymbols<3>(symbols_, n_, codeToSymbol_);		break;
+			default:
+			{
+				ASSERT(bitsPerSymbol_ > 0 && bitsPerSymbol_ < 8);
+				for (uint32 i = 0; i < n_; ++i)
+					symbols_[i] = codeToSymbol_[GetBits(bitsPerSymbol_)];
+			}
+		}
+	}
+
+	template <uint32 _TBitsPerSymbol>
+	void GetSymbols(char* symbols_, uint32 n_, const char* codeToSymbol_)
+	{
+		const uint32 mask = (1 << _TBitsPerSymbol) - 1;
+		const byte* data = buffer.Pointer();
+
+		uint64 bits = wordBuffer & BitMask(wordBufferPos);
+		uint32 bitsNum = wordBufferPos;
+
+		for (uint32 i = 0; i < n_; ++i)
+		{
+			if (bitsNum < _TBitsPerSymbol)
+			{
+				while (bitsNum <= 56 && position < size)
+				{
+					bits = (bits << 8) | data[position++];
+					bitsNum += 8;
+				}
+				ASSERT(bitsNum >= _TBitsPerSymbol);
+			}
+
+			bitsNum -= _TBitsPerSymbol;
+			symbols_[i] = codeToSymbol_[(bits >> bitsNum) & mask];
+		}
+
+		// give back the bytes read ahead
+		//
+		position -= bitsNum / 8;
+		wordBufferPos = bitsNum % 8;
+		if (wordBufferPos > 0)
+			wordBuffer = data[position - 1];
+	}
+
 	byte GetByte()
 	{
 		ASSERT(position < size);
@@ -163,6 +213,13 @@ public:
 		position += n_;
 	}
 
+	// whether all the data has been read -- including the buffered bits
+	//
+	bool IsEnd() const
+	{
+		return position >= size && wordBufferPos == 0;
+	}
+
 	void FlushInputWordBuffer()
 	{
 		wordBufferPos = 0;
@@ -181,7 +238,7 @@ public:
 private:
 	static const uint32 WordBufferSize = 8;
 
-	const Buffer& buffer;
+	const IBuffer& buffer;
 	uint64 size;
 	uint64 position;
 
@@ -274,23 +331,62 @@ public:
 
 	void PutBits(uint32 word_, uint32 n_)
 	{
-		ASSERT(n_ > 0);
-		word_ &= BitMask(n_);
+		ASSERT(n_ > 0 && n_ <= 32);
 
-		uint32 rest = WordBufferSize - wordBufferPos;
-		if (n_ >= rest)
+		if (wordBufferPos == WordBufferSize)
 		{
-			n_ -= rest;
-			wordBuffer <<= rest;
-			wordBuffer += word_ >> n_;
-			wordBufferPos = 0;
 			Put4Bytes(wordBuffer);
-			wordBuffer = 0;
+			wordBufferPos = 0;
 		}
 
-		wordBuffer <<= n_;
-		wordBuffer += word_ & BitMask(n_);
+		uint64 bits = ((uint64)wordBuffer << n_) | (word_ & (((uint64)1 << n_) - 1));
 		wordBufferPos += n_;
+
+		if (wordBufferPos >= WordBufferSize)
+		{
+			wordBufferPos -= WordBufferSize;
+			Put4Bytes((uint32)(bits >> wordBufferPos));
+		}
+		wordBuffer = (uint32)bits;
+	}
+
+	// writes n_ symbols using bitsPerSymbol_ bits each, translating the symbols using the table
+	//
+	void PutSymbols(const char* symbols_, uint32 n_, const char* symbolToCode_, uint32 bitsPerSymbol_)
+	{
+		switch (bitsPerSymbol_)
+		{
+			case 2:		PutSymbols<2>(symbols_, n_, symbolToCode_);		break;
+			case 3:		PutSymbols<3>(symbols_, n_, symbolToCode_);		break;
+			default:
+			{
+				ASSERT(bitsPerSymbol_ > 0 && bitsPerSymbol_ <= 8);
+				for (uint32 i = 0; i < n_; ++i)
+					PutBits(symbolToCode_[(uint32)symbols_[i]], bitsPerSymbol_);
+			}
+		}
+	}
+
+	template <uint32 _TBitsPerSymbol>
+	void PutSymbols(const char* symbols_, uint32 n_, const char* symbolToCode_)
+	{
+		const uint32 symbolsPerWord = WordBufferSize / _TBitsPerSymbol;
+
+		for ( ; n_ >= symbolsPerWord; n_ -= symbolsPerWord, symbols_ += symbolsPerWord)
+		{
+			uint32 word = 0;
+			for (uint32 i = 0; i < symbolsPerWord; ++i)
+				word = (word << _TBitsPerSymbol) | (uint32)symbolToCode_[(uint32)symbols_[i]];
+			PutBits(word, symbolsPerWord * _TBitsPerSymbol);
+		}
+
+		if (n_ > 0)
+		{
+			uint32 word = 0;
+			for (uint32 i = 0; i < n_; ++i)
+				word = (word << _TBitsPerSymbol) | (uint32)symbolToCode_[(uint32)symbols_[i]];
+			PutBits(word, n_ * _TBitsPerSymbol);
+		}
 	}
 
 	void PutByte(byte b_)
@@ -339,10 +435,15 @@ public:
 
 	void Put4Bytes(uint32 data_)
 	{
-		PutByte(data_ >> 24);
-		PutByte((data_ >> 16) & 0xFF);
-		PutByte((data_ >> 8) & 0xFF);
-		PutByte(data_ & 0xFF);
+		if (position + 4 > buffer.Size())
+			buffer.Extend(position + 4 + (buffer.Size() >> 1), true);
+
+		byte* p = buffer.Pointer() + position;
+		p[0] = data_ >> 24;
+		p[1] = (data_ >> 16) & 0xFF;
+		p[2] = (data_ >> 8) & 0xFF;
+		p[3] = data_ & 0xFF;
+		position += 4;
 	}
 
 	void FlushFullWordBuffer()
@@ -63,6 +63,20 @@ public:
 
 		ASSERT(availablePartsPool.size() > 0);
 
+		// after lowering the limit, reuse the idle parts before allocating new ones
+		//
+		if (availablePartsPool.back() == NULL && allocatedPartsPool.size() >= maxPartNum)
+		{
+			for (typename part_pool::iterator i = availablePartsPool.begin(); i != availablePartsPool.end(); ++i)
+			{
+				if (*i != NULL)
+				{
+					std::swap(*i, availablePartsPool.back());
+					break;
+				}
+			}
+		}
+
 		DataType*& pp = availablePartsPool.back();
 		availablePartsPool.pop_back();
 		if (pp == NULL)
@@ -84,17 +98,58 @@ public:
 		mt::lock_guard<mt::mutex> lock(mutex);
 
 		ASSERT(part_ != NULL);
-		ASSERT(partNum != 0 && partNum <= maxPartNum);
+		ASSERT(partNum != 0);
 		ASSERT(std::find(allocatedPartsPool.begin(), allocatedPartsPool.end(), part_) != allocatedPartsPool.end());
 
-		availablePartsPool.push_back((DataType*)part_);
+		// free the parts above the lowered limit
+		//
+		if (allocatedPartsPool.size() > maxPartNum)
+		{
+			allocatedPartsPool.erase(std::find(allocatedPartsPool.begin(), allocatedPartsPool.end(), part_));
+			delete part_;
+			availablePartsPool.push_back(NULL);
+		}
+		else
+		{
+			availablePartsPool.push_back((DataType*)part_);
+		}
 		partNum--;
 
 		partsAvailableCondition.notify_one();
 	}
 
+	uint32 MaxPartNum()
+	{
+		mt::lock_guard<mt::mutex> lock(mutex);
+		return maxPartNum;
+	}
+
+	// lowers the number of parts in use -- the parts above the limit are freed when
+	// released, the new ones need to wait for them
+	//
+	void LowerMaxPartNum(uint32 maxPartNum_)
+	{
+		mt::lock_guard<mt::mutex> lock(mutex);
+
+		ASSERT(maxPartNum_ > 0);
+		maxPartNum = MIN(maxPartNum, maxPartNum_);
+
+		for (typename part_pool::iterator i = availablePartsPool.begin(); i != availablePartsPool.end(); ++i)
+		{
+			if (allocatedPartsPool.size() <= maxPartNum)
+				break;
+
+			if (*i != NULL)
+			{
+				allocatedPartsPool.erase(std::find(allocatedPartsPool.begin(), allocatedPartsPool.end(), *i));
+				delete *i;
+				*i = NULL;
+			}
+		}
+	}
+
 private:
-	const uint32 maxPartNum;
+	uint32 maxPartNum;
 	const uint32 bufferPartSize;
 	uint32 partNum;
 
@@ -11,11 +11,16 @@
 
 #include "Globals.h"
 
-#include <queue>
+#include <deque>
+#include <algorithm>
 
 #include "Thread.h"
 
 
+// the queue of the parts passed between the threads -- with the ordered delivery the parts are
+// popped in the order of their ids (the writers of the output streams), with the unordered one
+// in the order of pushing (the workers taking the next part to process)
+//
 template <class _TDataType>
 class TDataQueue
 {
@@ -26,10 +31,23 @@ class TDataQueue
 public:
 	static const uint32 DefaultMaxPartNum = 64;
 
-	TDataQueue(uint32 maxPartNum_ = DefaultMaxPartNum, uint32 threadNum_ = 1)
+	// the number of the lock retries before a thread parks on the condition
+	static const uint32 SpinCount = 16;
+
+	enum DeliveryOrder
+	{
+		OrderedDelivery,
+		UnorderedDelivery
+	};
+
+	TDataQueue(uint32 maxPartNum_ = DefaultMaxPartNum, uint32 threadNum_ = 1,
+			   DeliveryOrder order_ = OrderedDelivery)
 		:	threadNum(threadNum_)
 		,	maxPartNum(maxPartNum_)
+		,	ordered(order_ == OrderedDelivery)
 		,	currentThreadMask(0)
+		,	pushWaitersNum(0)
+		,	popWaitersNum(0)
 	{
 		ASSERT(maxPartNum_ > 0);
 		ASSERT(threadNum_ >= 1);
@@ -65,31 +83,74 @@ public:
 	{
 		mt::unique_lock<mt::mutex> lock(mutex);
 
-		while (parts.size() > maxPartNum && partId_ > parts.front().first)
+		// with the ordered delivery the part with the lowest id is always accepted, as the
+		// consumer can be waiting for it
+		//
+		uint32 spins = 0;
+		while (parts.size() > maxPartNum && (!ordered || partId_ > parts.front().first))
+		{
+			if (spins++ < SpinCount)
+			{
+				SpinWait(lock);
+				continue;
+			}
+
+			pushWaitersNum++;
 			queueFullCondition.wait(lock);
+			pushWaitersNum--;
+		}
 
+		// the ordered parts are kept as a min-heap on part id
+		//
 		parts.push_back(std::make_pair(partId_, (DataType*)part_));
-		if(parts.size() > 1)
-		{
-			std::sort(parts.begin(), parts.end(), sortByPartId);
-		}
+		if (ordered)
+			std::push_heap(parts.begin(), parts.end(), partIdGreater);
 
-		queueEmptyCondition.notify_one();
+		if (popWaitersNum > 0)
+			queueEmptyCondition.notify_one();
 	}
 
 	bool Pop(int64 &partId_, DataType* &part_)
 	{
 		mt::unique_lock<mt::mutex> lock(mutex);
 
+		uint32 spins = 0;
 		while ((parts.size() == 0) && currentThreadMask != completedThreadMask)
+		{
+			if (spins++ < SpinCount)
+			{
+				SpinWait(lock);
+				continue;
+			}
+
+			popWaitersNum++;
 			queueEmptyCondition.wait(lock);
+			popWaitersNum--;
+		}
 
 		if (parts.size() != 0)
 		{
-			partId_ = parts.front().first;
-			part_ = parts.front().second;
-			parts.pop_front();
-			queueFullCondition.notify_one();
+			if (ordered)
+			{
+				std::pop_heap(parts.begin(), parts.end(), partIdGreater);
+				partId_ = parts.back().first;
+				part_ = parts.back().second;
+				parts.pop_back();
+
+				// the waiting producers block on different part ids, wake all of them
+				//
+				if (pushWaitersNum > 0)
+					queueFullCondition.notify_all();
+			}
+			else
+			{
+				partId_ = parts.front().first;
+				part_ = parts.front().second;
+				parts.pop_front();
+
+				if (pushWaitersNum > 0)
+					queueFullCondition.notify_one();
+			}
 			return true;
 		}
 
@@ -109,17 +170,30 @@ public:
 private:
 	const uint32 threadNum;
 	const uint32 maxPartNum;
+	const bool ordered;
 	uint64 completedThreadMask;
 	uint64 currentThreadMask;
+	uint32 pushWaitersNum;
+	uint32 popWaitersNum;
 	part_queue parts;
 
 	mt::mutex mutex;
 	mt::condition_variable queueFullCondition;
 	mt::condition_variable queueEmptyCondition;
 
-	inline static bool sortByPartId(const part_pair& p1_, const part_pair& p2_)
+	// lets the other threads run before the condition is checked again, the short waits end
+	// here without the cost of parking the thread
+	//
+	static void SpinWait(mt::unique_lock<mt::mutex>& lock_)
+	{
+		lock_.unlock();
+		mt::this_thread::yield();
+		lock_.lock();
+	}
+
+	inline static bool partIdGreater(const part_pair& p1_, const part_pair& p2_)
 	{
-		return p1_.first < p2_.first;
+		return p1_.first > p2_.first;
 	}
 
 };
@@ -13,20 +13,158 @@
 
 #include "DnaCategorizer.h"
 #include "DnaBlockData.h"
+#include "DnaRecordSorter.h"
+#include "PackedDna.h"
+#include "Thread.h"
 
 
-DnaCategorizer::DnaCategorizer(const MinimizerParameters& params_, const CategorizerParameters& catParams_)
+// operators used for sorting the bins in parallel
+//
+class BinSortTaskList
+{
+public:
+	BinSortTaskList(std::vector<DnaBin*>& bins_)
+		:	bins(bins_)
+		,	nextTask(0)
+	{}
+
+	bool Pop(DnaBin*& bin_)
+	{
+		mt::lock_guard<mt::mutex> lock(mutex);
+
+		if (nextTask == bins.size())
+			return false;
+
+		bin_ = bins[nextTask++];
+		return true;
+	}
+
+private:
+	std::vector<DnaBin*>& bins;
+	uint64 nextTask;
+	mt::mutex mutex;
+};
+
+
+class BinSorter : public IOperator
+{
+public:
+	BinSorter(BinSortTaskList* tasks_, const DnaRecordSorter& sorter_)
+		:	tasks(tasks_)
+		,	sorter(sorter_)
+	{}
+
+	void Run()
+	{
+		DnaBin* db = NULL;
+		while (tasks->Pop(db))
+			sorter.Sort(db->Begin(), db->End());
+	}
+
+private:
+	BinSortTaskList* tasks;
+	DnaRecordSorter sorter;
+};
+
+
+typedef std::vector<DnaRecord>::iterator DnaRecordIterator;
+
+
+class BinRangeSorter : public IOperator
+{
+public:
+	BinRangeSorter(DnaRecordIterator begin_, DnaRecordIterator end_, const DnaRecordSorter& sorter_)
+		:	begin(begin_)
+		,	end(end_)
+		,	sorter(sorter_)
+	{}
+
+	void Run()
+	{
+		sorter.Sort(begin, end);
+	}
+
+private:
+	DnaRecordIterator begin;
+	DnaRecordIterator end;
+	DnaRecordSorter sorter;
+};
+
+
+class BinRangeMerger : public IOperator
+{
+public:
+	BinRangeMerger(DnaRecordIterator begin_, DnaRecordIterator middle_, DnaRecordIterator end_,
+				   const DnaRecordSorter& sorter_)
+		:	begin(begin_)
+		,	middle(middle_)
+		,	end(end_)
+		,	sorter(sorter_)
+	{}
+
+	void Run()
+	{
+		sorter.Merge(begin, middle, end);
+	}
+
+private:
+	DnaRecordIterator begin;
+	DnaRecordIterator middle;
+	DnaRecordIterator end;
+	const DnaRecordSorter& sorter;
+};
+
+
+// runs the operators in separate threads, the first one in the calling thread
+//
+template <class _TOperator>
+void RunOperators(std::vector<_TOperator*>& operators_)
+{
+	std::vector<mt::thread*> threads;
+
+	for (uint32 i = 1; i < operators_.size(); ++i)
+		threads.push_back(new mt::thread(mt::ref(*operators_[i])));
+
+	if (operators_.size() > 0)
+		(*operators_[0])();
+
+	for (uint32 i = 0; i < threads.size(); ++i)
+	{
+		threads[i]->join();
+		delete threads[i];
+	}
+
+	for (uint32 i = 0; i < operators_.size(); ++i)
+		delete operators_[i];
+	operators_.clear();
+}
+
+
+struct BinSizeComparator
+{
+	bool operator() (const DnaBin* b1_, const DnaBin* b2_) const
+	{
+		return b1_->Size() > b2_->Size();
+	}
+};
+
+
+DnaCategorizer::DnaCategorizer(const MinimizerParameters& params_, const CategorizerParameters& catParams_,
+							   uint32 sortThreadsNum_, bool packedDna_)
 	:	params(params_)
 	,	catParams(catParams_)
 	,	maxShortMinimValue(1 << (2 * params.signatureSuffixLen))
 	,	maxLongMinimValue(1 << (2 * params.signatureLen))
 	,	nBinValue(maxLongMinimValue)
+	,	sortThreadsNum(sortThreadsNum_)
+	,	packedDna(packedDna_)
+	,	kernel(params_)
 {
-	ASSERT(params.signatureSuffixLen <= params.signatureLen);
+	ASSERT(PackedDna::MaxUnpackedLen <= MinimizerKernel::BufferSize);
+	unpackedRecord.dna = unpackedDna;
 
-	std::fill(symbolIdxTable, symbolIdxTable + 128, -1);
-	for (uint32 i = 0; i < 5; ++i)
-		symbolIdxTable[(int32)params.dnaSymbolOrder[i]] = i;
+	ASSERT(params.signatureSuffixLen <= params.signatureLen);
+	ASSERT(sortThreadsNum > 0);
 
 	freqTable.resize(maxShortMinimValue, 0);
 }
@@ -53,24 +191,91 @@ void DnaCategorizer::Categorize(std::vector<DnaRecord>& records_, uint64 records
 	//
 	FindMinimizerPositions(bin_.stdBins);
 
-	DnaRecordComparator comparator(params.signatureLen - params.signatureSuffixLen);
-	for (uint32 i = 0; i < bin_.stdBins.Size(); ++i)
+	SortBins(bin_.stdBins);
+}
+
+
+void DnaCategorizer::SortBins(DnaBinCollection& bins_)
+{
+	DnaRecordSorter sorter(params.signatureLen - params.signatureSuffixLen, packedDna);
+
+	if (sortThreadsNum == 1)
+	{
+		for (uint32 i = 0; i < bins_.Size(); ++i)
+		{
+			DnaBin& db = bins_[i];
+			if (db.Size() > 0)
+				sorter.Sort(db.Begin(), db.End());
+		}
+		return;
+	}
+
+	// the biggest bins are sorted one by one using all the threads, the rest
+	// is handed out to the threads starting from the largest ones
+	//
+	sortTasks.clear();
+
+	uint64 totalSize = 0;
+	for (uint32 i = 0; i < bins_.Size(); ++i)
+	{
+		if (bins_[i].Size() > 1)
+		{
+			sortTasks.push_back(&bins_[i]);
+			totalSize += bins_[i].Size();
+		}
+	}
+
+	std::sort(sortTasks.begin(), sortTasks.end(), BinSizeComparator());
+
+	const uint64 bigBinSize = MAX(MinParallelSortBinSize, totalSize / sortThreadsNum);
+	std::vector<DnaBin*>::iterator smallBinsBegin = sortTasks.begin();
+	for ( ; smallBinsBegin != sortTasks.end() && (*smallBinsBegin)->Size() >= bigBinSize; ++smallBinsBegin)
+		ParallelSortBin(**smallBinsBegin);
+
+	sortTasks.erase(sortTasks.begin(), smallBinsBegin);
+
+	BinSortTaskList taskList(sortTasks);
+	std::vector<BinSorter*> sorters;
+	for (uint32 i = 0; i < MIN((uint64)sortThreadsNum, (uint64)sortTasks.size()); ++i)
+		sorters.push_back(new BinSorter(&taskList, sorter));
+
+	RunOperators(sorters);
+}
+
+
+void DnaCategorizer::ParallelSortBin(DnaBin& bin_)
+{
+	DnaRecordSorter sorter(params.signatureLen - params.signatureSuffixLen, packedDna);
+
+	// sort equal parts of the bin independently and merge them pairwise
+	//
+	std::vector<uint64> bounds;
+	for (uint32 i = 0; i <= sortThreadsNum; ++i)
+		bounds.push_back(bin_.Size() * i / sortThreadsNum);
+
+	std::vector<BinRangeSorter*> sorters;
+	for (uint32 i = 0; i < sortThreadsNum; ++i)
+		sorters.push_back(new BinRangeSorter(bin_.Begin() + bounds[i], bin_.Begin() + bounds[i + 1], sorter));
+	RunOperators(sorters);
+
+	std::vector<BinRangeMerger*> mergers;
+	for (uint32 step = 1; step < sortThreadsNum; step *= 2)
 	{
-		DnaBin& db = bin_.stdBins[i];
-		if (db.Size() > 0)
-			std::sort(db.Begin(), db.End(), comparator);
+		for (uint32 i = 0; i + step < sortThreadsNum; i += 2 * step)
+		{
+			const uint32 last = MIN(i + 2 * step, sortThreadsNum);
+			mergers.push_back(new BinRangeMerger(bin_.Begin() + bounds[i], bin_.Begin() + bounds[i + step],
+												 bin_.Begin() + bounds[last], sorter));
+		}
+		RunOperators(mergers);
 	}
 }
 
 
+
 // todo: split into rev and non-rev
 void DnaCategorizer::DistributeToBins(std::vector<DnaRecord>& records_, uint64 recordsCount_, DnaBinCollection& bins_, DnaBin& nBin_)
 {
-	char revBuffer[1024];	// TODO: make size constant depending on the record max len
-	DnaRecord rcRec;
-	rcRec.dna = revBuffer;
-	rcRec.reverse = true;
-
 	if (params.tryReverseCompliment)
 	{
 		for (uint32 i = 0; i < recordsCount_; ++i)
@@ -80,12 +285,12 @@ void DnaCategorizer::DistributeToBins(std::vector<DnaRecord>& records_, uint64 r
 
 			ASSERT(rec.len > 0);
 
-			rec.ComputeRC(rcRec);
-
-			// find and select minimizers
+			// find and select minimizers -- both strands are scanned in a single pass
 			//
-			const uint32 minimizerFwd = FindMinimizer(rec);
-			const uint32 minimizerRev = FindMinimizer(rcRec);
+			uint32 minimizerFwd = 0;
+			uint32 minimizerRev = 0;
+			FindMinimizerPair(UnpackedRecord(rec), minimizerFwd, minimizerRev);
+
 			uint32 minimizer = 0;
 			bool reverse = false;
 
@@ -105,8 +310,8 @@ void DnaCategorizer::DistributeToBins(std::vector<DnaRecord>& records_, uint64 r
 			{
 				if (reverse)
 				{
+					ReverseRecord(rec);
 					rec.reverse = true;
-					std::copy(rcRec.dna, rcRec.dna + rec.len, rec.dna);
 				}
 
 				bins_[minimizer].Insert(rec);
@@ -126,7 +331,7 @@ void DnaCategorizer::DistributeToBins(std::vector<DnaRecord>& records_, uint64 r
 			DnaRecord& r = records_[i];
 			ASSERT(r.len > 0);
 			ASSERT(!r.reverse);
-			uint32 minimizer = FindMinimizer(r);
+			uint32 minimizer = FindMinimizer(UnpackedRecord(r));
 
 			if (minimizer != nBinValue)										// !TODO --- find here minimizer pos
 			{
@@ -142,6 +347,7 @@ void DnaCategorizer::DistributeToBins(std::vector<DnaRecord>& records_, uint64 r
 
 	// re-balance bins
 	//
+	MinimizerCandidate candidates[MaxMinimizerCandidates];
 	for (uint32 i = 0; i < bins_.Size(); ++i)
 	{
 		DnaBin& db = bins_[i];
@@ -156,27 +362,26 @@ void DnaCategorizer::DistributeToBins(std::vector<DnaRecord>& records_, uint64 r
 			// un-reverse the record
 			if (r.reverse)
 			{
-				r.ComputeRC(rcRec);
+				ReverseRecord(r);
 				r.reverse = false;
-				std::copy(rcRec.dna, rcRec.dna + r.len, r.dna);
 			}
 
-			std::map<uint32, uint16> mins = FindMinimizers(r);
-			std::map<uint32, uint16>::iterator mit = mins.begin();
+			const uint32 candidatesCount = FindMinimizers(UnpackedRecord(r), candidates);
 
-			for ( ; mit != mins.end(); ++mit)
+			uint32 k = 0;
+			for ( ; k < candidatesCount; ++k)
 			{
-				const uint32 m = mit->first;
+				const uint32 m = candidates[k].minimizer;
 				if (bins_[m].Size() >= catParams.minBlockBinSize)// && bins_[m].Size() < maxBinSize)
 				{
-					r.minimizerPos = mit->second;
+					r.minimizerPos = candidates[k].pos;
 					bins_[m].Insert(r);
 					break;
 				}
 			}
 
 			// only one minimizer or we did not find appropriate bin
-			if (mit == mins.end())
+			if (k == candidatesCount)
 			{
 				nBin_.Insert(r);
 			}
@@ -199,22 +404,23 @@ void DnaCategorizer::FindMinimizerPositions(DnaBinCollection& bins_)
 		for (uint32 j = 0; j < bins_[i].Size(); ++j)
 		{
 			DnaRecord& r = bins_[i][j];
+			const char* dna = UnpackedRecord(r).dna;
 #if EXP_USE_RC_ADV
-			const char* beg = r.dna + (r.reverse ? params.skipZoneLen : 0);
-			const char* end = r.dna + r.len - (r.reverse ? params.skipZoneLen : 0);
+			const char* beg = dna + (r.reverse ? params.skipZoneLen : 0);
+			const char* end = dna + r.len - (r.reverse ? params.skipZoneLen : 0);
 			const char* mi = std::search(beg, end, minString, minString + params.signatureSuffixLen);
 
-			ASSERT(mi != r.dna + r.len);
+			ASSERT(mi != dna + r.len);
 
-			r.minimizerPos = mi - r.dna;
+			r.minimizerPos = mi - dna;
 			ASSERT((!r.reverse && r.minimizerPos < r.len - params.skipZoneLen) ||
 					(r.minimizerPos >= params.skipZoneLen) );
 #else
-			const char* mi = std::search(r.dna, r.dna + r.len, minString, minString + params.signatureSuffixLen);
+			const char* mi = std::search(dna, dna + r.len, minString, minString + params.signatureSuffixLen);
 
-			ASSERT(mi != r.dna + r.len);
+			ASSERT(mi != dna + r.len);
 
-			r.minimizerPos = mi - r.dna;
+			r.minimizerPos = mi - dna;
 			ASSERT(r.minimizerPos < r.len - params.skipZoneLen);
 #endif
 
@@ -223,9 +429,36 @@ void DnaCategorizer::FindMinimizerPositions(DnaBinCollection& bins_)
 }
 
 
-uint32 DnaCategorizer::FindMinimizer(DnaRecord &rec_)
+const DnaRecord& DnaCategorizer::UnpackedRecord(const DnaRecord& rec_)
+{
+	if (!packedDna)
+		return rec_;
+
+	PackedDna::Decode(rec_, unpackedDna);
+	unpackedRecord.len = rec_.len;
+	unpackedRecord.minimizerPos = rec_.minimizerPos;
+	unpackedRecord.reverse = rec_.reverse;
+	return unpackedRecord;
+}
+
+
+void DnaCategorizer::ReverseRecord(DnaRecord& rec_)
+{
+	if (packedDna)
+	{
+		PackedDna::ComputeRC(rec_);
+		return;
+	}
+
+	DnaRecord rcRec;
+	rcRec.dna = rcDna;
+	rec_.ComputeRC(rcRec);
+	std::copy(rcRec.dna, rcRec.dna + rec_.len, rec_.dna);
+}
+
+
+uint32 DnaCategorizer::FindMinimizer(const DnaRecord& rec_)
 {
-	uint32 minimizer = maxLongMinimValue;
 	ASSERT(rec_.len >= params.signatureLen - params.skipZoneLen + 1);
 
 #if EXP_USE_RC_ADV
@@ -236,13 +469,9 @@ uint32 DnaCategorizer::FindMinimizer(DnaRecord &rec_)
 	const int32 iend = rec_.len - params.signatureLen + 1 - params.skipZoneLen;
 #endif
 
-	for (int32 i = ibeg; i < iend; ++i)
-	{
-		uint32 m = ComputeMinimizer(rec_.dna + i, params.signatureLen);
-
-		if (m < minimizer && IsMinimizerValid(m, params.signatureLen))
-			minimizer = m;
-	}
+	uint32 minimizer = 0;
+	uint32 dummy = 0;
+	kernel.FindMinimumSignatures(rec_.dna, rec_.len, ibeg, iend - 1, 0, -1, minimizer, dummy);
 
 	if (minimizer >= maxLongMinimValue)
 		return nBinValue;
@@ -251,67 +480,65 @@ uint32 DnaCategorizer::FindMinimizer(DnaRecord &rec_)
 }
 
 
-std::map<uint32, uint16> DnaCategorizer::FindMinimizers(DnaRecord &rec_)
+void DnaCategorizer::FindMinimizerPair(const DnaRecord& rec_, uint32& minimizerFwd_, uint32& minimizerRev_)
 {
-	ASSERT(rec_.len >= params.signatureLen - params.skipZoneLen + 1);
+	ASSERT(!rec_.reverse);
 
-	// find all
-	std::map<uint32, uint16> signatures;
-	for (int32 i = 0; i < rec_.len - params.signatureLen + 1 - params.skipZoneLen; ++i)
-	{
-		uint32 m = ComputeMinimizer(rec_.dna + i, params.signatureLen);
+	// forward windows start at [0, len - sigLen - skipZone], while the reverse-compliment
+	// windows (skip-zone at the other end of the read) start at [skipZone, len - sigLen]
+	//
+	const int32 sigLen = params.signatureLen;
+	const int32 fwdEnd = (int32)rec_.len - sigLen - params.skipZoneLen;
+#if EXP_USE_RC_ADV
+	const int32 revBeg = 0;
+	const int32 revEnd = fwdEnd;
+#else
+	const int32 revBeg = params.skipZoneLen;
+	const int32 revEnd = (int32)rec_.len - sigLen;
+#endif
 
-		if (IsMinimizerValid(m, params.signatureLen) && m < maxLongMinimValue)
-		{
-			m &= (maxShortMinimValue - 1);
-			if (signatures.count(m) == 0)
-				signatures[m] = i + (params.signatureLen - params.signatureSuffixLen);
-		}
-	}
+	uint32 minFwd = 0;
+	uint32 minRev = 0;
+	kernel.FindMinimumSignatures(rec_.dna, rec_.len, 0, fwdEnd, revBeg, revEnd, minFwd, minRev);
 
-	return signatures;
+	minimizerFwd_ = (minFwd >= maxLongMinimValue) ? nBinValue : (minFwd & (maxShortMinimValue - 1));
+	minimizerRev_ = (minRev >= maxLongMinimValue) ? nBinValue : (minRev & (maxShortMinimValue - 1));
 }
 
 
-uint32 DnaCategorizer::ComputeMinimizer(const char* dna_, uint32 mLen_)
+uint32 DnaCategorizer::FindMinimizers(const DnaRecord& rec_, MinimizerCandidate* candidates_)
 {
-	uint32 r = 0;
+	ASSERT(rec_.len >= params.signatureLen - params.skipZoneLen + 1);
+
+	uint32 sigs[MinimizerKernel::BufferSize];
+	kernel.ComputeSignatures(rec_.dna, rec_.len, sigs);
 
-	for (uint32 i = 0; i < mLen_; ++i)
+	// find all
+	uint32 count = 0;
+	for (int32 i = 0; i < rec_.len - params.signatureLen + 1 - params.skipZoneLen; ++i)
 	{
-		if (dna_[i] == 'N')
-			return nBinValue;
+		if (sigs[i] == MinimizerKernel::InvalidSignature)
+			continue;
 
-		ASSERT(dna_[i] >= 'A' && dna_[i] <= 'T');
-		r <<= 2;
-		r |= symbolIdxTable[(uint32)dna_[i]];
+		ASSERT(count < MaxMinimizerCandidates);
+		candidates_[count].minimizer = sigs[i] & (maxShortMinimValue - 1);
+		candidates_[count].pos = i + (params.signatureLen - params.signatureSuffixLen);
+		count++;
 	}
 
-	return r;
-}
+	if (count == 0)
+		return 0;
 
+	// sort by minimizer and leave only the first occurrence of each one
+	//
+	std::sort(candidates_, candidates_ + count);
 
-bool DnaCategorizer::IsMinimizerValid(uint32 minim_, uint32 mLen_)
-{
-	if (minim_ == 0)
-		minim_ = 0;
-
-	const uint32 excludeLen = 3;
-	const uint32 excludeMask = 0x3F;
-	const uint32 symbolExcludeTable[] = {0x00, 0x15, 0x2A, 0x3F};
-
-	minim_ &= (1 << (2*mLen_)) - 1;
-	bool hasInvalidSeq = false;
-
-	for (uint32 i = 0; !hasInvalidSeq && i <= (mLen_ - excludeLen); ++i)
+	uint32 unique = 1;
+	for (uint32 i = 1; i < count; ++i)
 	{
-		uint32 x = minim_ & excludeMask;
-
-		for (uint32 j = 0; j < 4; ++j)
-			hasInvalidSeq |= (x == symbolExcludeTable[j]);
-
-		minim_ >>= 2;
+		if (candidates_[i].minimizer != candidates_[unique - 1].minimizer)
+			candidates_[unique++] = candidates_[i];
 	}
 
-	return !hasInvalidSeq;
+	return unique;
 }
@@ -12,40 +12,71 @@
 #include "Globals.h"
 
 #include <vector>
-#include <map>
 
 #include "DnaRecord.h"
 #include "Collections.h"
 #include "Params.h"
+#include "MinimizerKernel.h"
 
 
 class DnaCategorizer
 {
 public:
-	DnaCategorizer(const MinimizerParameters& params_, const CategorizerParameters& catParams_);
+	static const uint64 MinParallelSortBinSize = 1 << 16;
+
+	DnaCategorizer(const MinimizerParameters& params_, const CategorizerParameters& catParams_,
+				   uint32 sortThreadsNum_ = 1, bool packedDna_ = false);
 
 	void Categorize(std::vector<DnaRecord>& records_, uint64 recordsCount_, DnaBinBlock& bin_);
 
 private:
+	// minimizer candidate of a record used while re-balancing the bins
+	//
+	struct MinimizerCandidate
+	{
+		uint32 minimizer;
+		uint16 pos;
+
+		bool operator< (const MinimizerCandidate& c_) const
+		{
+			return minimizer < c_.minimizer || (minimizer == c_.minimizer && pos < c_.pos);
+		}
+	};
+
+	static const uint32 MaxMinimizerCandidates = DnaRecord::MaxDnaLen + 1;
+
 	const MinimizerParameters& params;
 	const CategorizerParameters catParams;
 
 	const uint32 maxShortMinimValue;
 	const uint32 maxLongMinimValue;
 	const uint32 nBinValue;
-
-	char symbolIdxTable[128];
+	const uint32 sortThreadsNum;
+	const bool packedDna;
 
 	std::vector<uint64> freqTable;
 
+	MinimizerKernel kernel;
+
+	std::vector<DnaBin*> sortTasks;
+
+	// work buffers for the packed records
+	//
+	DnaRecord unpackedRecord;
+	char unpackedDna[MinimizerKernel::BufferSize];
+	char rcDna[MinimizerKernel::BufferSize];
+
 	void DistributeToBins(std::vector<DnaRecord>& records_, uint64 recordsCount_, DnaBinCollection& bins_, DnaBin& nBin_);
 	void FindMinimizerPositions(DnaBinCollection& bins_);
+	void SortBins(DnaBinCollection& bins_);
+	void ParallelSortBin(DnaBin& bin_);
 
-	uint32 FindMinimizer(DnaRecord& rec_);
-	std::map<uint32, uint16> FindMinimizers(DnaRecord &rec_);
-	uint32 ComputeMinimizer(const char* dna_, uint32 mLen_);
+	const DnaRecord& UnpackedRecord(const DnaRecord& rec_);
+	void ReverseRecord(DnaRecord& rec_);
 
-	bool IsMinimizerValid(uint32 minim_, uint32 mLen_);
+	uint32 FindMinimizer(const DnaRecord& rec_);
+	void FindMinimizerPair(const DnaRecord& rec_, uint32& minimizerFwd_, uint32& minimizerRev_);
+	uint32 FindMinimizers(const DnaRecord& rec_, MinimizerCandidate* candidates_);
 };
 
 
@@ -12,10 +12,12 @@
 #include "DnaBlockData.h"
 #include "BinBlockData.h"
 #include "Utils.h"
+#include "PackedDna.h"
 
 
-DnaPacker::DnaPacker(const MinimizerParameters& params_)
+DnaPacker::DnaPacker(const MinimizerParameters& params_, bool packedDna_)
 	:	params(params_)
+	,	packedDna(packedDna_)
 {
 	std::fill(dnaToIdx, dnaToIdx + 128, -1);
 	for (uint32 i = 0; i < 5; ++i)
@@ -30,6 +32,15 @@ DnaPacker::DnaPacker(const MinimizerParameters& params_)
 	{
 		idxToDna[i] = params_.dnaSymbolOrder[i];
 	}
+
+	// the packed records' symbol codes can be copied directly when they match the symbol order
+	//
+	isCodeOrder = true;
+	for (uint32 i = 0; i < 4; ++i)
+	{
+		codeToIdx[i] = dnaToIdx[(uint32)"ACGT"[i]];
+		isCodeOrder &= (codeToIdx[i] == (char)i);
+	}
 }
 
 
@@ -120,7 +131,9 @@ void DnaPacker::StoreNextRecord(const DnaRecord &rec_, BitMemoryWriter& metaWrit
 
 	// store meta info
 	//
-	const bool isDnaPlain = std::find(rec_.dna, rec_.dna + rec_.len, 'N') == rec_.dna + rec_.len;
+	const bool isDnaPlain = packedDna
+			? !rec_.hasN
+			: std::find(rec_.dna, rec_.dna + rec_.len, 'N') == rec_.dna + rec_.len;
 	const bool hasMinimizer = settings_.suffixLen != 0;
 
 	metaWriter_.PutBit(isDnaPlain);
@@ -141,21 +154,57 @@ void DnaPacker::StoreNextRecord(const DnaRecord &rec_, BitMemoryWriter& metaWrit
 
 	// when saving record, skip writing bytes identifying the signature
 	//
-	if (isDnaPlain)
+	if (packedDna)
 	{
-		for (uint32 i = 0 ; i < rec_.minimizerPos; ++i)
-			dnaWriter_.Put2Bits(dnaToIdx[(uint32)rec_.dna[i]]);
+		if (isDnaPlain)
+		{
+			StorePackedSymbols(rec_, 0, rec_.minimizerPos, dnaWriter_);
+			StorePackedSymbols(rec_, rec_.minimizerPos + settings_.suffixLen, rec_.len, dnaWriter_);
+		}
+		else
+		{
+			for (uint32 i = 0; i < rec_.minimizerPos; ++i)
+				dnaWriter_.PutBits(dnaToIdx[(uint32)PackedDna::Symbol(rec_, i)], 3);
 
-		for (uint32 i = rec_.minimizerPos + settings_.suffixLen; i < rec_.len; ++i)
-			dnaWriter_.Put2Bits(dnaToIdx[(uint32)rec_.dna[i]]);
+			for (uint32 i = rec_.minimizerPos + settings_.suffixLen; i < rec_.len; ++i)
+				dnaWriter_.PutBits(dnaToIdx[(uint32)PackedDna::Symbol(rec_, i)], 3);
+		}
 	}
 	else
 	{
-		for (uint32 i = 0; i < rec_.minimizerPos; ++i)
-			dnaWriter_.PutBits(dnaToIdx[(uint32)rec_.dna[i]], 3);
+		const uint32 bitsPerSymbol = isDnaPlain ? 2 : 3;
+		const uint32 suffixEnd = rec_.minimizerPos + settings_.suffixLen;
+
+		dnaWriter_.PutSymbols(rec_.dna, rec_.minimizerPos, dnaToIdx, bitsPerSymbol);
+		dnaWriter_.PutSymbols(rec_.dna + suffixEnd, rec_.len - suffixEnd, dnaToIdx, bitsPerSymbol);
+	}
+}
+
+
+void DnaPacker::StorePackedSymbols(const DnaRecord& rec_, uint32 begin_, uint32 end_, BitMemoryWriter& dnaWriter_)
+{
+	const uint64* words = PackedDna::Words(rec_);
+
+	if (!isCodeOrder)
+	{
+		for (uint32 i = begin_; i < end_; ++i)
+			dnaWriter_.Put2Bits(codeToIdx[PackedDna::Code(words, i)]);
+		return;
+	}
+
+	// copy the codes in chunks of up to 16 symbols
+	//
+	const uint32 MaxChunkSymbols = 16;
+	for (uint32 i = begin_; i < end_; i += MaxChunkSymbols)
+	{
+		const uint32 n = MIN(end_ - i, MaxChunkSymbols);
+		const uint32 off = i % PackedDna::SymbolsPerWord;
+
+		uint64 bits = words[i / PackedDna::SymbolsPerWord] << (2 * off);
+		if (off + n > PackedDna::SymbolsPerWord)
+			bits |= words[i / PackedDna::SymbolsPerWord + 1] >> (64 - 2 * off);
 
-		for (uint32 i = rec_.minimizerPos + settings_.suffixLen; i < rec_.len; ++i)
-			dnaWriter_.PutBits(dnaToIdx[(uint32)rec_.dna[i]], 3);
+		dnaWriter_.PutBits((uint32)(bits >> (64 - 2 * n)), 2 * n);
 	}
 }
 
@@ -341,17 +390,28 @@ void DnaPacker::UnpackFromBin(const BinaryBinBlock& binBin_, DnaBin& dnaBin_, ui
 		settings.suffixLen = 0;
 	}
 
-	BitMemoryReader metaReader(binBin_.metaData, binBin_.metaSize);
-	BitMemoryReader dnaReader(binBin_.dnaData, binBin_.dnaSize);
+	const bool hasSpans = binBin_.metaSpans.size() > 0;
+	ASSERT(!hasSpans || binBin_.metaSpans.size() == binBin_.descriptors.size());
+	ASSERT(!hasSpans || binBin_.dnaSpans.size() == binBin_.descriptors.size());
 
 	char* dnaBufferPtr = (char*)dnaChunk_.data.Pointer();
+	uint64 metaPos = 0;
+	uint64 dnaPos = 0;
 
 	for (uint32 i = 0; i < binBin_.descriptors.size(); ++i)
 	{
 		const BinaryBinDescriptor& desc = binBin_.descriptors[i];
 
-		const uint64 initialMetaPos = metaReader.Position();
-		const uint64 initialDnaPos = dnaReader.Position();
+		// every descriptor's data is a separate byte-aligned stream -- either referenced
+		// in place or stored one after another in the bin buffers
+		//
+		const IBuffer metaData(hasSpans ? (byte*)binBin_.metaSpans[i] : binBin_.metaData.Pointer() + metaPos, desc.metaSize);
+		const IBuffer dnaData(hasSpans ? (byte*)binBin_.dnaSpans[i] : binBin_.dnaData.Pointer() + dnaPos, desc.dnaSize);
+		metaPos += desc.metaSize;
+		dnaPos += desc.dnaSize;
+
+		BitMemoryReader metaReader(metaData, desc.metaSize);
+		BitMemoryReader dnaReader(dnaData, desc.dnaSize);
 
 		// read bin header
 		//
@@ -401,14 +461,11 @@ void DnaPacker::UnpackFromBin(const BinaryBinBlock& binBin_, DnaBin& dnaBin_, ui
 			}
 		}
 
-		metaReader.FlushInputWordBuffer();
-		dnaReader.FlushInputWordBuffer();
-
 		dnaBin_.SetStats(MIN(settings.minLen, dnaBin_.GetStats().minLen),
 						 MAX(settings.maxLen, dnaBin_.GetStats().maxLen));
 
-		ASSERT(metaReader.Position() - initialMetaPos == desc.metaSize);
-		ASSERT(dnaReader.Position() - initialDnaPos == desc.dnaSize);
+		ASSERT(metaReader.Position() == desc.metaSize);
+		ASSERT(dnaReader.Position() == desc.dnaSize);
 	}
 }
 
@@ -416,7 +473,7 @@ void DnaPacker::UnpackFromBin(const BinaryBinBlock& binBin_, DnaBin& dnaBin_, ui
 bool DnaPacker::ReadNextRecord(BitMemoryReader &metaReader_, BitMemoryReader &dnaReader_, DnaRecord &rec_,
 							   const BinPackSettings& settings_)
 {
-	if (dnaReader_.Position() >= dnaReader_.Size())
+	if (dnaReader_.IsEnd())
 		return false;
 
 	// read general record info
@@ -446,34 +503,11 @@ bool DnaPacker::ReadNextRecord(BitMemoryReader &metaReader_, BitMemoryReader &dn
 	}
 	ASSERT(rec_.len > 0 && rec_.len < DnaRecord::MaxDnaLen);
 
-	if (isDnaPlain)
-	{
-		for (uint32 i = 0; i < rec_.minimizerPos; ++i)
-		{
-			rec_.dna[i] = idxToDna[dnaReader_.Get2Bits()];
-			ASSERT(rec_.dna[i] != -1);
-		}
-
-		for (uint32 i = rec_.minimizerPos + settings_.suffixLen; i < rec_.len; ++i)
-		{
-			rec_.dna[i] = idxToDna[dnaReader_.Get2Bits()];
-			ASSERT(rec_.dna[i] != -1);
-		}
-	}
-	else
-	{
-		for (uint32 i = 0; i < rec_.minimizerPos; ++i)
-		{
-			rec_.dna[i] = idxToDna[dnaReader_.GetBits(3)];
-			ASSERT(rec_.dna[i] != -1);
-		}
+	const uint32 bitsPerSymbol = isDnaPlain ? 2 : 3;
+	const uint32 suffixEnd = rec_.minimizerPos + settings_.suffixLen;
 
-		for (uint32 i = rec_.minimizerPos + settings_.suffixLen; i < rec_.len; ++i)
-		{
-			rec_.dna[i] = idxToDna[dnaReader_.GetBits(3)];
-			ASSERT(rec_.dna[i] != -1);
-		}
-	}
+	dnaReader_.GetSymbols(rec_.dna, rec_.minimizerPos, idxToDna, bitsPerSymbol);
+	dnaReader_.GetSymbols(rec_.dna + suffixEnd, rec_.len - suffixEnd, idxToDna, bitsPerSymbol);
 
 	return true;
 }
@@ -17,7 +17,7 @@
 class DnaPacker
 {
 public:
-	DnaPacker(const MinimizerParameters& params_);
+	DnaPacker(const MinimizerParameters& params_, bool packedDna_ = false);
 
 	void PackToBins(const DnaBinBlock& dnaBins_, BinaryBinBlock& binBins_);
 	void UnpackFromBins(const BinaryBinBlock& binBins_, DnaBinBlock& dnaBins_, DataChunk& dnaChunk_);
@@ -45,9 +45,12 @@ private:
 	static const uint32 LenBits = 8;
 
 	const MinimizerParameters params;
+	const bool packedDna;
 
 	char dnaToIdx[128];
 	char idxToDna[8];
+	char codeToIdx[4];
+	bool isCodeOrder;
 
 
 	void PackToBin(const DnaBin& dnaBin_, BitMemoryWriter& metaWriter_, BitMemoryWriter& dnaWriter_,
@@ -59,6 +62,8 @@ private:
 	void StoreNextRecord(const DnaRecord& rec_, BitMemoryWriter& binWriter_,
 						 BitMemoryWriter& dnaWriter_, const BinPackSettings& settings_);
 
+	void StorePackedSymbols(const DnaRecord& rec_, uint32 begin_, uint32 end_, BitMemoryWriter& dnaWriter_);
+
 	bool ReadNextRecord(BitMemoryReader& binReader_, BitMemoryReader& dnaReader_,
 						DnaRecord& rec_, const BinPackSettings& settings_);
 
@@ -9,16 +9,19 @@
 #include "Globals.h"
 #include "DnaParser.h"
 #include "DnaBlockData.h"
+#include "PackedDna.h"
 
 #define REC_EXTENSION_FACTOR(size)		( ((size) / 4 > 1024) ? ((size) / 4) : 1024 )
 
 
-DnaParser::DnaParser()
-	:	memory(NULL)
+DnaParser::DnaParser(bool packedDna_)
+	:	packedDna(packedDna_)
+	,	memory(NULL)
 	,	memoryPos(0)
 	,	memorySize(0)
 	,	skippedBytes(0)
 	,	buf(NULL)
+	,	dnaBuf(NULL)
 	,	dnaMemory(NULL)
 	,	dnaSize(0)
 {
@@ -31,9 +34,16 @@ uint64 DnaParser::ParseFrom(const DataChunk& chunk_, DataChunk& dnaBuffer_, std:
 	memory = chunk_.data.Pointer();
 	memoryPos = 0;
 	memorySize = chunk_.size;
-
-	if (dnaBuffer_.data.Size() < chunk_.size / 2)
-		dnaBuffer_.data.Extend(chunk_.size / 2);
+	lineIndexer.Start(memory, memorySize);
+
+	// packed records take ~1/8 of the FASTQ data for the typical reads, the buffer
+	// is extended while parsing if needed
+	//
+	const uint64 dnaBufferSize = packedDna ? chunk_.size / 8 + PackedDna::MaxRecordWords * sizeof(uint64)
+										   : chunk_.size / 2;
+	if (dnaBuffer_.data.Size() < dnaBufferSize)
+		dnaBuffer_.data.Extend(dnaBufferSize);
+	dnaBuf = &dnaBuffer_.data;
 	dnaMemory = dnaBuffer_.data.Pointer();
 	dnaSize = 0;
 
@@ -49,6 +59,19 @@ uint64 DnaParser::ParseFrom(const DataChunk& chunk_, DataChunk& dnaBuffer_, std:
 
 	dnaBuffer_.size = dnaSize;
 
+	// the packed buffer might have been reallocated -- set the records' pointers now
+	//
+	if (packedDna)
+	{
+		uint64* words = dnaBuffer_.data.Pointer64();
+		for (uint64 i = 0; i < rec_count_; ++i)
+		{
+			records_[i].dna = (char*)words;
+			words += PackedDna::RecordWordsNum(records_[i]);
+		}
+		ASSERT((byte*)words == dnaBuffer_.data.Pointer() + dnaSize);
+	}
+
 	return chunk_.size - skippedBytes;
 }
 
@@ -77,14 +100,32 @@ bool DnaParser::ReadNextRecord(DnaRecord& rec_)
 	ASSERT(slen < DnaRecord::MaxDnaLen);
 
 
-	std::copy(seq, seq + slen, dnaMemory + dnaSize);
-
-	rec_.dna = (char*)(dnaMemory + dnaSize);
-	dnaSize += slen;
-
 	rec_.len = slen;
 	rec_.reverse = false;
 
+	if (packedDna)
+	{
+		if (dnaSize + PackedDna::MaxRecordWords * sizeof(uint64) > dnaBuf->Size())
+		{
+			dnaBuf->Extend(dnaBuf->Size() + (dnaBuf->Size() >> 1), true);
+			dnaMemory = dnaBuf->Pointer();
+		}
+
+		bool hasN = false;
+		dnaSize += PackedDna::Encode(seq, slen, (uint64*)(dnaMemory + dnaSize), hasN) * sizeof(uint64);
+
+		rec_.dna = NULL;
+		rec_.hasN = hasN;
+	}
+	else
+	{
+		std::copy(seq, seq + slen, dnaMemory + dnaSize);
+
+		rec_.dna = (char*)(dnaMemory + dnaSize);
+		dnaSize += slen;
+		rec_.hasN = false;
+	}
+
 	return true;
 }
 
@@ -123,24 +164,17 @@ bool DnaParser::ReadLine(uchar *str_, uint32& len_, uint32& size_)
 
 uint32 DnaParser::SkipLine()
 {
-	uint32 len = 0;
-	for (;;)
-	{
-		int32 c = Getc();
-		if (c == -1)
-			break;
+	const uint64 eol = lineIndexer.NextEol();
+	ASSERT(eol >= memoryPos);
 
-		if (c != '\n' && c != '\r')
-		{
-			len++;
-		}
-		else
-		{
-			if (c == '\r' && Peekc() == '\n')	// case of CR LF
-				Skipc();
+	const uint32 len = eol - memoryPos;
+	memoryPos = eol;
 
-			break;
-		}
+	if (memoryPos < memorySize)
+	{
+		memoryPos++;
+		if (memory[eol] == '\r' && Peekc() == '\n')	// case of CR LF
+			Skipc();
 	}
 	return len;
 }
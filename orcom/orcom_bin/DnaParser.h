@@ -15,12 +15,13 @@
 
 #include "DnaRecord.h"
 #include "Buffer.h"
+#include "LineIndexer.h"
 
 
 class DnaParser
 {
 public:
-	DnaParser();
+	DnaParser(bool packedDna_ = false);
 
 	uint64 ParseTo(const DnaBinBlock& dnaBins_, DataChunk& chunk_);
 	uint64 ParseTo(const DnaBin& dnaBin_, DataChunk& chunk_);
@@ -29,13 +30,17 @@ public:
 					 std::vector<DnaRecord>& records_, uint64& rec_count_);
 
 protected:
+	const bool packedDna;
+
 	byte* memory;
 	uint64 memoryPos;
 	uint64 memorySize;
 	uint64 skippedBytes;
 	Buffer* buf;
+	LineIndexer lineIndexer;
 
-	byte* dnaMemory;			// TODO: move out
+	Buffer* dnaBuf;				// TODO: move out
+	byte* dnaMemory;			// *
 	uint64 dnaSize;				// *
 	DnaRecord revRecord;		// *
 	char revBuffer[1024];		// * + make constant
@@ -24,14 +24,16 @@ struct DnaRecord
 	uint16 len;								// 2B
 	uint8 minimizerPos;						// 1B
 	bool reverse;							// 1B
+	bool hasN;								// 1B -- used only by the packed representation
 	//
-	// 4B padding by default !
+	// 3B padding
 
 	DnaRecord()
 		:	dna(NULL)
 		,	len(0)
 		,	minimizerPos(0)
 		,	reverse(false)
+		,	hasN(false)
 	{}
 
 	DnaRecord(const DnaRecord& r_)
@@ -39,6 +41,7 @@ struct DnaRecord
 		,	len(r_.len)
 		,	minimizerPos(r_.minimizerPos)
 		,	reverse(r_.reverse)
+		,	hasN(r_.hasN)
 	{}
 
 	void ComputeRC(DnaRecord& rc_) const
@@ -56,27 +59,66 @@ struct DnaRecord
 			ASSERT(rc_.dna[len-1-i] != -1);
 		}
 	}
+
+	// replaces the record with its reverse-compliment, in place
+	//
+	void ComputeRCInPlace()
+	{
+		const char rcCodes[24] = {	-1,'T',-1,'G',-1,-1,-1,'C',		// 64+
+									-1,-1,-1,-1,-1,-1,'N',-1,		// 72+,
+									-1,-1,-1,-1,'A',-1,-1,-1,		// 80+
+								};
+		for (int32 i = 0, j = (int32)len - 1; i < j; ++i, --j)
+		{
+			ASSERT(dna[i] > 64 && dna[i] < 88);
+			ASSERT(dna[j] > 64 && dna[j] < 88);
+			const char c = rcCodes[(int32)dna[i] - 64];
+			dna[i] = rcCodes[(int32)dna[j] - 64];
+			dna[j] = c;
+		}
+		if (len % 2 == 1)
+			dna[len / 2] = rcCodes[(int32)dna[len / 2] - 64];
+
+		reverse = !reverse;
+	}
 };
 
 #pragma pack(pop)
 
 
+// orders the records by their contents starting from the signature position -- a record
+// being a prefix of the other one goes after it. Records with the same contents are ordered
+// by the signature position and then by the rest of the contents, which makes the order
+// total and independent of the sorting algorithm used
+//
 struct DnaRecordComparator
 {
 	DnaRecordComparator(uint32 signatureShift_)
 		:	signatureShift(signatureShift_)
 	{}
 
-	bool operator() (const DnaRecord& r1_, const DnaRecord& r2_)
+	bool operator() (const DnaRecord& r1_, const DnaRecord& r2_) const
 	{
 		const char* r1p = r1_.dna + r1_.minimizerPos - signatureShift;
 		const char* r2p = r2_.dna + r2_.minimizerPos - signatureShift;
-		uint32 len = MIN(r1_.len - r1_.minimizerPos, r2_.len - r2_.minimizerPos) + signatureShift;
-
-		int32 r = strncmp(r1p, r2p, len);
-		if (r == 0)
+		const uint32 len1 = r1_.len - r1_.minimizerPos + signatureShift;
+		const uint32 len2 = r2_.len - r2_.minimizerPos + signatureShift;
+
+		int32 r = memcmp(r1p, r2p, MIN(len1, len2));
+		if (r != 0)
+			return r < 0;
+		if (len1 != len2)
+			return len1 > len2;
+		if (r1_.minimizerPos != r2_.minimizerPos)
 			return r1_.minimizerPos < r2_.minimizerPos;
-		return r < 0;
+
+		if (r1_.minimizerPos > signatureShift)
+		{
+			r = memcmp(r1_.dna, r2_.dna, r1_.minimizerPos - signatureShift);
+			if (r != 0)
+				return r < 0;
+		}
+		return r1_.reverse < r2_.reverse;
 	}
 
 	const uint32 signatureShift;
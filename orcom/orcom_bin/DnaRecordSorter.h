@@ -0,0 +1,240 @@
+/*
+  This file is a part of ORCOM software distributed under GNU GPL 2 licence.
+  Homepage:	http://sun.aei.polsl.pl/orcom
+  Github:	http://github.com/lrog/orcom
+
+  Authors: Sebastian Deorowicz, Szymon Grabowski and Lucas Roguski
+*/
+
+#ifndef H_DNARECORDSORTER
+#define H_DNARECORDSORTER
+
+#include "Globals.h"
+
+#include <vector>
+#include <algorithm>
+
+#include "DnaRecord.h"
+#include "PackedDna.h"
+
+
+// multikey quicksort of the records, anchored at the signature position -- produces
+// exactly the same order as sorting with DnaRecordComparator. The next 8 symbols of
+// every record are cached as a single big-endian key, so the records' data is touched
+// once per 8 symbols instead of once per comparison. Handles both the plain and the
+// 2-bit packed records
+//
+class DnaRecordSorter
+{
+public:
+	typedef std::vector<DnaRecord>::iterator RecordIterator;
+
+	DnaRecordSorter(uint32 signatureShift_, bool packedDna_ = false)
+		:	comparator(signatureShift_)
+		,	packedComparator(signatureShift_)
+		,	packedDna(packedDna_)
+	{}
+
+	void Sort(RecordIterator begin_, RecordIterator end_)
+	{
+		const uint64 size = end_ - begin_;
+		if (size < 2)
+			return;
+
+		items.resize(size);
+		for (uint64 i = 0; i < size; ++i)
+		{
+			items[i].rec = begin_[i];
+			items[i].key = LoadKey(items[i].rec, 0);
+		}
+
+		if (packedDna)
+			SortRange(&items[0], size, 0, packedComparator);
+		else
+			SortRange(&items[0], size, 0, comparator);
+
+		for (uint64 i = 0; i < size; ++i)
+			begin_[i] = items[i].rec;
+	}
+
+	// merges two consecutive sorted ranges
+	//
+	void Merge(RecordIterator begin_, RecordIterator middle_, RecordIterator end_) const
+	{
+		if (packedDna)
+			std::inplace_merge(begin_, middle_, end_, packedComparator);
+		else
+			std::inplace_merge(begin_, middle_, end_, comparator);
+	}
+
+private:
+	static const uint32 KeySymbols = 8;
+	static const uint64 InsertionSortThreshold = 16;
+
+	struct SortItem
+	{
+		uint64 key;
+		DnaRecord rec;
+	};
+
+	template <class _TComparator>
+	struct TSortItemComparator
+	{
+		const _TComparator& comparator;
+
+		TSortItemComparator(const _TComparator& comparator_)
+			:	comparator(comparator_)
+		{}
+
+		bool operator() (const SortItem& i1_, const SortItem& i2_) const
+		{
+			if (i1_.key != i2_.key)
+				return i1_.key < i2_.key;
+			return comparator(i1_.rec, i2_.rec);
+		}
+	};
+
+	const DnaRecordComparator comparator;
+	const PackedDnaRecordComparator packedComparator;
+	const bool packedDna;
+	std::vector<SortItem> items;
+
+	// symbols past the end of the record are encoded as 0xFF, which is greater than any
+	// symbol and makes a record go after the records it is a prefix of
+	//
+	uint64 LoadKey(const DnaRecord& rec_, uint32 depth_) const
+	{
+		const int32 keyBeg = rec_.minimizerPos - comparator.signatureShift;
+		const int32 keyLen = rec_.len - keyBeg;
+		const int32 n = MIN(keyLen - (int32)depth_, (int32)KeySymbols);
+
+		uint64 k = 0;
+		int32 i = 0;
+		if (packedDna)
+		{
+			if (n > 0)
+			{
+				uint64 x = PackedDna::SymbolsAt(rec_, keyBeg + depth_);
+				uint64 nx = rec_.hasN ? PackedDna::NMaskAt(rec_, keyBeg + depth_) : 0;
+				for ( ; i < n; ++i)
+				{
+					k = (k << 8) | (uchar)((nx >> 63) ? 'N' : "ACGT"[x >> 62]);
+					x <<= 2;
+					nx <<= 1;
+				}
+			}
+		}
+		else
+		{
+			const char* key = rec_.dna + keyBeg;
+			for ( ; i < n; ++i)
+				k = (k << 8) | (uchar)key[depth_ + i];
+		}
+		for ( ; i < (int32)KeySymbols; ++i)
+			k = (k << 8) | 0xFF;
+		return k;
+	}
+
+	// the middle part of a partition is equal on the current key -- either all its records
+	// end within the key and only the remaining tie-breaks are left, or it is sorted on the
+	// next key. Returns false if the part is already sorted
+	//
+	template <class _TComparator>
+	bool NextKey(SortItem* items_, uint64 size_, uint32& depth_, uint64 pivot_,
+				 const TSortItemComparator<_TComparator>& itemComparator_) const
+	{
+		if ((pivot_ & 0xFF) == 0xFF)
+		{
+			std::sort(items_, items_ + size_, itemComparator_);
+			return false;
+		}
+
+		depth_ += KeySymbols;
+		for (uint64 j = 0; j < size_; ++j)
+			items_[j].key = LoadKey(items_[j].rec, depth_);
+		return true;
+	}
+
+	template <class _TComparator>
+	void SortRange(SortItem* items_, uint64 size_, uint32 depth_, const _TComparator& comparator_)
+	{
+		TSortItemComparator<_TComparator> itemComparator(comparator_);
+
+		while (size_ > InsertionSortThreshold)
+		{
+			// median of three keys as the pivot
+			//
+			uint64 k0 = items_[0].key;
+			uint64 k1 = items_[size_ / 2].key;
+			const uint64 k2 = items_[size_ - 1].key;
+			if (k0 > k1)
+				std::swap(k0, k1);
+			const uint64 pivot = (k2 <= k0) ? k0 : MIN(k1, k2);
+
+			// 3-way partition: [0, lt) < pivot, [lt, gt) == pivot, [gt, size) > pivot
+			//
+			uint64 lt = 0;
+			uint64 gt = size_;
+			uint64 i = 0;
+			while (i < gt)
+			{
+				if (items_[i].key < pivot)
+					std::swap(items_[lt++], items_[i++]);
+				else if (items_[i].key > pivot)
+					std::swap(items_[i], items_[--gt]);
+				else
+					i++;
+			}
+
+			// recurse into the two smaller parts and continue with the largest one -- each
+			// recursion at least halves the range, which bounds the stack depth by log(n)
+			// whatever the pivots are
+			//
+			const uint64 eqSize = gt - lt;
+			const uint64 gtSize = size_ - gt;
+
+			if (eqSize >= lt && eqSize >= gtSize)
+			{
+				SortRange(items_, lt, depth_, comparator_);
+				SortRange(items_ + gt, gtSize, depth_, comparator_);
+
+				items_ += lt;
+				size_ = eqSize;
+				if (!NextKey(items_, size_, depth_, pivot, itemComparator))
+					return;
+			}
+			else
+			{
+				uint32 eqDepth = depth_;
+				if (NextKey(items_ + lt, eqSize, eqDepth, pivot, itemComparator))
+					SortRange(items_ + lt, eqSize, eqDepth, comparator_);
+
+				if (lt < gtSize)
+				{
+					SortRange(items_, lt, depth_, comparator_);
+					items_ += gt;
+					size_ = gtSize;
+				}
+				else
+				{
+					SortRange(items_ + gt, gtSize, depth_, comparator_);
+					size_ = lt;
+				}
+			}
+		}
+
+		// insertion sort for the small ranges
+		//
+		for (uint64 i = 1; i < size_; ++i)
+		{
+			SortItem it = items_[i];
+			uint64 j = i;
+			for ( ; j > 0 && itemComparator(it, items_[j - 1]); --j)
+				items_[j] = items_[j - 1];
+			items_[j] = it;
+		}
+	}
+};
+
+
+#endif // H_DNARECORDSORTER
@@ -15,6 +15,8 @@
 #include <vector>
 
 #include "FileStream.h"
+#include "GzStream.h"
+#include "LineIndexer.h"
 
 
 class IFastqStreamReader
@@ -68,10 +70,9 @@ private:
 	{
 		ASSERT(pos_ < size_);
 
-		while (data_[pos_] != '\n' && data_[pos_] != '\r' && pos_ < size_)
-			++pos_;
+		pos_ = LineIndexer::FindEol(data_, pos_, size_);
 
-		if (data_[pos_] == '\r' && pos_ < size_)
+		if (pos_ + 1 < size_ && data_[pos_] == '\r')
 		{
 			if (data_[pos_ + 1] == '\n')
 			{
@@ -161,9 +162,9 @@ public:
 class MultiFastqFileReaderGz : public IFastqStreamReader
 {
 public:
-	MultiFastqFileReaderGz(const std::vector<std::string>& fileNames_)
+	MultiFastqFileReaderGz(const std::vector<std::string>& fileNames_, uint32 threadNum_ = 1)
 	{
-		stream = new MultiFileStreamReaderGz(fileNames_);
+		stream = new ParallelGzStreamReader(fileNames_, threadNum_);
 	}
 
 	~MultiFastqFileReaderGz()
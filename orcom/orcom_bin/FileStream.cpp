@@ -96,11 +96,13 @@ struct IMemoryStream::MemoryStreamImpl
 	int32 fileDescriptor;
 	void* memory;
 	uint64 size;
+	bool mapped;
 
 	MemoryStreamImpl()
 		:	fileDescriptor(0)
 		,	memory(NULL)
 		,	size(0)
+		,	mapped(false)
 	{}
 };
 
@@ -210,12 +212,27 @@ MemoryStreamReader::MemoryStreamReader(const std::string &fileName_)
 	impl->fileDescriptor = fd;
 	impl->size = s.st_size;
 	impl->memory = (void*)region;
+	impl->mapped = true;
 	position = 0;
 
 	memoryBuffer = new IBuffer((byte*)impl->memory, impl->size);
 }
 
 
+MemoryStreamReader::MemoryStreamReader(const byte* memory_, uint64 size_)
+	:	position(0)
+	,	memoryBuffer(NULL)
+{
+	ASSERT(memory_ != NULL || size_ == 0);
+
+	impl->size = size_;
+	impl->memory = (void*)memory_;
+	impl->mapped = false;
+
+	memoryBuffer = new IBuffer((byte*)impl->memory, impl->size);
+}
+
+
 MemoryStreamReader::~MemoryStreamReader()
 {
 	Close();
@@ -229,8 +246,10 @@ void MemoryStreamReader::Close()
 {
 	if (impl->memory != NULL)
 	{
-		munmap(impl->memory, impl->size);
+		if (impl->mapped)
+			munmap(impl->memory, impl->size);
 		impl->memory = NULL;
+		impl->mapped = false;
 	}
 
 	if (impl->fileDescriptor > 0)
@@ -295,6 +314,32 @@ int64 MemoryStreamReader::Attach(uchar *&mem_, uint64 size_)
 }
 
 
+void MemoryStreamReader::Advise(AccessAdvice advice_, uint64 pos_, uint64 size_)
+{
+	if (impl->memory == NULL || !impl->mapped || pos_ >= impl->size)
+		return;
+
+	if (size_ == 0 || pos_ + size_ > impl->size)
+		size_ = impl->size - pos_;
+
+	int32 advice = MADV_NORMAL;
+	switch (advice_)
+	{
+		case AdviceSequential:	advice = MADV_SEQUENTIAL;	break;
+		case AdviceRandom:		advice = MADV_RANDOM;		break;
+		case AdviceWillNeed:	advice = MADV_WILLNEED;		break;
+		default:				break;
+	}
+
+	// the range needs to start at the page boundary
+	//
+	const uint64 pageSize = sysconf(_SC_PAGESIZE);
+	const uint64 beg = pos_ - pos_ % pageSize;
+
+	madvise((byte*)impl->memory + beg, size_ + (pos_ - beg), advice);	// only a hint -- ignore the result
+}
+
+
 FileStreamWriter::FileStreamWriter(const std::string& fileName_)
 	:	position(0)
 {
@@ -342,6 +387,131 @@ void FileStreamWriter::SetPosition(uint64 pos_)
 	position = pos_;
 }
 
+
+SpillStreamWriter::SpillStreamWriter(const std::string& fileName_, uint64 memoryLimit_)
+	:	fileName(fileName_)
+	,	memoryLimit(memoryLimit_)
+	,	memory(NULL)
+	,	file(NULL)
+	,	spilled(false)
+	,	size(0)
+	,	position(0)
+{}
+
+
+SpillStreamWriter::~SpillStreamWriter()
+{
+	Close();
+
+	if (memory != NULL)
+		delete memory;
+
+	if (spilled)
+		remove(fileName.c_str());
+}
+
+
+void SpillStreamWriter::Close()
+{
+	if (file != NULL)
+	{
+		file->Close();
+		delete file;
+		file = NULL;
+	}
+}
+
+
+int64 SpillStreamWriter::Write(const uchar *mem_, uint64 size_)
+{
+	if (size_ == 0)
+		return 0;
+
+	// grow the buffer geometrically -- the data is moved to the file once the old and
+	// the new buffers would not fit within the limit together, as they are both held
+	// while the data is copied
+	//
+	const uint64 newSize = position + size_;
+	if (!spilled && (memory == NULL || memory->Size() < newSize))
+	{
+		const uint64 held = (memory != NULL) ? memory->Size() : 0;
+		uint64 capacity = MAX(newSize, (memory != NULL) ? memory->Size() * 2 : (uint64)1 << 20);
+		capacity = MIN(capacity, memoryLimit - MIN(held, memoryLimit));
+
+		if (capacity < newSize)
+		{
+			Spill();
+		}
+		else if (memory == NULL)
+		{
+			memory = new Buffer(capacity);
+		}
+		else
+		{
+			memory->Extend(capacity, true);
+		}
+	}
+
+	if (spilled)
+	{
+		ASSERT(file != NULL);
+
+		int64 n = file->Write(mem_, size_);
+		if (n >= 0)
+			position += n;
+		size = MAX(size, position);
+		return n;
+	}
+
+	// the gap left by moving past the end reads as zeros, as it would in a file
+	//
+	if (position > size)
+		std::fill(memory->Pointer() + size, memory->Pointer() + position, 0);
+
+	std::copy(mem_, mem_ + size_, memory->Pointer() + position);
+	position += size_;
+	size = MAX(size, position);
+	return size_;
+}
+
+
+void SpillStreamWriter::SetPosition(uint64 pos_)
+{
+	if (spilled)
+	{
+		ASSERT(file != NULL);
+		file->SetPosition(pos_);
+	}
+	position = pos_;
+}
+
+
+void SpillStreamWriter::Spill()
+{
+	ASSERT(!spilled);
+
+	file = new FileStreamWriter(fileName);
+	file->SetBuffering(true);
+
+	if (size > 0)
+		file->Write(memory->Pointer(), size);
+	file->SetPosition(position);
+
+	TFREE(memory);
+	spilled = true;
+}
+
+
+MemoryStreamReader* SpillStreamWriter::CreateReader() const
+{
+	ASSERT(file == NULL);
+
+	if (spilled)
+		return new MemoryStreamReader(fileName);
+	return new MemoryStreamReader(memory != NULL ? memory->Pointer() : NULL, size);
+}
+
+
 IMultiFileStreamReader::IMultiFileStreamReader(const std::vector<std::string> &fileNames_, const IFileFuncImpl* fileFuncImpl_)
 	:	fileNames(fileNames_)
 	,	fileFuncImpl(fileFuncImpl_)
@@ -87,6 +87,7 @@ class MemoryStreamReader : public IDataStreamReader, public IMemoryStream
 {
 public:
 	MemoryStreamReader(const std::string& fileName_);
+	MemoryStreamReader(const byte* memory_, uint64 size_);		// reads the memory in place, not owning it
 	~MemoryStreamReader();
 
 	int64 Read(uchar* mem_, uint64 size_);
@@ -97,6 +98,19 @@ public:
 
 	int64 Attach(uchar *&mem_, uint64 size_);
 
+	enum AccessAdvice
+	{
+		AdviceNormal,
+		AdviceSequential,
+		AdviceRandom,
+		AdviceWillNeed
+	};
+
+	// hints the expected access pattern of the given range (till the end of the stream
+	// if size_ is 0) to the kernel, does nothing if not supported
+	//
+	void Advise(AccessAdvice advice_, uint64 pos_ = 0, uint64 size_ = 0);
+
 	IBuffer* MemoryBuffer() const
 	{
 		return memoryBuffer;
@@ -193,4 +207,53 @@ private:
 };
 
 
+// keeps the written data in memory, moving it to a temporary file once its buffer
+// cannot grow within the memory limit, which bounds the peak use -- after closing,
+// the data can be read in place using a MemoryStreamReader. The temporary file is
+// removed when the stream is destroyed
+//
+class SpillStreamWriter : public IDataStreamWriter
+{
+public:
+	SpillStreamWriter(const std::string& fileName_, uint64 memoryLimit_);
+	~SpillStreamWriter();
+
+	void Close();
+
+	virtual	int64 Write(const uchar* mem_, uint64 size_);
+
+	void SetPosition(uint64 pos_);
+
+	uint64 Position() const
+	{
+		return position;
+	}
+
+	uint64 Size() const
+	{
+		return size;
+	}
+
+	bool IsSpilled() const
+	{
+		return spilled;
+	}
+
+	MemoryStreamReader* CreateReader() const;
+
+private:
+	const std::string fileName;
+	const uint64 memoryLimit;
+
+	Buffer* memory;
+	FileStreamWriter* file;
+	bool spilled;
+
+	uint64 size;
+	uint64 position;
+
+	void Spill();
+};
+
+
 #endif // H_FILESTREAM
@@ -0,0 +1,481 @@
+/*
+  This file is a part of ORCOM software distributed under GNU GPL 2 licence.
+  Homepage:	http://sun.aei.polsl.pl/orcom
+  Github:	http://github.com/lrog/orcom
+
+  Authors: Sebastian Deorowicz, Szymon Grabowski and Lucas Roguski
+*/
+
+#include "Globals.h"
+
+#ifndef DISABLE_GZ_STREAM
+
+#include <string.h>
+#include <zlib.h>
+
+#include "GzStream.h"
+#include "FileStream.h"
+#include "Exception.h"
+
+
+// BGZF member layout: 18B gzip header with the 'BC' extra subfield holding the member
+// size - 1, raw deflate data, 4B CRC32 and 4B inflated size
+//
+namespace bgzf
+{
+
+static const uint32 HeaderSize = 18;
+static const uint32 TrailerSize = 8;
+
+inline uint32 Get2Bytes(const byte* p_)
+{
+	return (uint32)p_[0] | ((uint32)p_[1] << 8);
+}
+
+inline uint32 Get4Bytes(const byte* p_)
+{
+	return Get2Bytes(p_) | (Get2Bytes(p_ + 2) << 16);
+}
+
+// returns the size of the member starting with the header or 0 if it is not a BGZF one
+//
+inline uint32 MemberSize(const byte* header_)
+{
+	if (header_[0] != 0x1f || header_[1] != 0x8b || header_[2] != 8 || (header_[3] & 4) == 0)
+		return 0;
+
+	if (Get2Bytes(header_ + 10) != 6 || header_[12] != 'B' || header_[13] != 'C'
+			|| Get2Bytes(header_ + 14) != 2)
+		return 0;
+
+	const uint32 size = Get2Bytes(header_ + 16) + 1;
+	if (size < HeaderSize + TrailerSize)
+		return 0;
+	return size;
+}
+
+inline uint32 InflatedSize(const byte* member_, uint32 memberSize_)
+{
+	return Get4Bytes(member_ + memberSize_ - 4);
+}
+
+}
+
+
+void GzStreamState::ThrowIfError()
+{
+	mt::lock_guard<mt::mutex> lock(mutex);
+	if (!error.empty())
+		throw Exception(error);
+}
+
+
+// reads the input files -- collects the BGZF members into blocks to be inflated by
+// the workers or inflates the plain gzip data itself
+//
+class GzBlockReader : public IOperator
+{
+public:
+	static const uint32 InputBufferSize = 1 << 20;
+
+	GzBlockReader(const std::vector<std::string>& fileNames_, GzStreamState& state_,
+				  GzBlockPool* pool_, GzBlockQueue* inflateQueue_, GzBlockQueue* dataQueue_)
+		:	fileNames(fileNames_)
+		,	state(state_)
+		,	pool(pool_)
+		,	inflateQueue(inflateQueue_)
+		,	dataQueue(dataQueue_)
+		,	blockId(0)
+	{}
+
+	void Run();
+
+private:
+	const std::vector<std::string> fileNames;
+	GzStreamState& state;
+	GzBlockPool* pool;
+	GzBlockQueue* inflateQueue;
+	GzBlockQueue* dataQueue;
+	int64 blockId;
+
+	void ReadFile(const std::string& fileName_);
+	void InflateFile(FileStreamReader& stream_, const byte* prefix_, uint32 prefixSize_,
+					 const std::string& fileName_);
+};
+
+
+void GzBlockReader::Run()
+{
+	try
+	{
+		for (uint32 i = 0; i < fileNames.size() && !state.IsCancelled(); ++i)
+			ReadFile(fileNames[i]);
+	}
+	catch (const std::exception& e_)
+	{
+		state.SetError(e_.what());
+	}
+
+	inflateQueue->SetCompleted();
+	dataQueue->SetCompleted();
+}
+
+
+void GzBlockReader::ReadFile(const std::string& fileName_)
+{
+	FileStreamReader stream(fileName_);
+
+	// collect the BGZF members while possible
+	//
+	GzBlock* block = NULL;
+	byte header[bgzf::HeaderSize];
+	uint32 headerSize = 0;
+	uint64 inflatedSize = 0;
+
+	while ((headerSize = stream.Read(header, bgzf::HeaderSize)) == bgzf::HeaderSize)
+	{
+		const uint32 memberSize = bgzf::MemberSize(header);
+		if (memberSize == 0)
+			break;
+
+		if (block != NULL && (block->packed.size + memberSize > block->packed.data.Size()
+							  || inflatedSize + (1 << 16) > block->data.data.Size()))
+		{
+			inflateQueue->Push(blockId++, block);
+			block = NULL;
+		}
+
+		if (block == NULL)
+		{
+			if (state.IsCancelled())
+				return;
+
+			pool->Acquire(block);
+			inflatedSize = 0;
+		}
+
+		byte* member = block->packed.data.Pointer() + block->packed.size;
+		std::copy(header, header + bgzf::HeaderSize, member);
+		if (stream.Read(member + bgzf::HeaderSize, memberSize - bgzf::HeaderSize) != memberSize - bgzf::HeaderSize)
+		{
+			pool->Release(block);
+			throw Exception("Truncated gzip file: " + fileName_);
+		}
+
+		block->packed.size += memberSize;
+		inflatedSize += bgzf::InflatedSize(member, memberSize);
+		headerSize = 0;
+	}
+
+	if (block != NULL)
+		inflateQueue->Push(blockId++, block);
+
+	// the rest of the file does not follow the BGZF layout
+	//
+	if (headerSize > 0)
+		InflateFile(stream, header, headerSize, fileName_);
+}
+
+
+void GzBlockReader::InflateFile(FileStreamReader& stream_, const byte* prefix_, uint32 prefixSize_,
+								const std::string& fileName_)
+{
+	z_stream zs;
+	memset(&zs, 0, sizeof(z_stream));
+	if (inflateInit2(&zs, 15 + 32) != Z_OK)
+		throw Exception("Cannot initialize the gzip decoder.");
+
+	Buffer input(InputBufferSize);
+	std::copy(prefix_, prefix_ + prefixSize_, input.Pointer());
+	zs.next_in = input.Pointer();
+	zs.avail_in = prefixSize_;
+
+	GzBlock* block = NULL;
+	bool memberEnded = false;
+	int r = Z_OK;
+
+	while (!state.IsCancelled())
+	{
+		if (zs.avail_in == 0)
+		{
+			zs.next_in = input.Pointer();
+			zs.avail_in = stream_.Read(input.Pointer(), input.Size());
+			if (zs.avail_in == 0)
+				break;
+		}
+
+		// the data following the last member is ignored, as by gzread()
+		//
+		if (memberEnded && zs.next_in[0] != 0x1f)
+			break;
+		memberEnded = false;
+
+		if (block == NULL)
+			pool->Acquire(block);
+
+		DataChunk& data = block->data;
+		zs.next_out = data.data.Pointer() + data.size;
+		zs.avail_out = data.data.Size() - data.size;
+
+		r = inflate(&zs, Z_NO_FLUSH);
+		data.size = data.data.Size() - zs.avail_out;
+
+		if (r == Z_STREAM_END)
+		{
+			inflateReset(&zs);
+			memberEnded = true;
+		}
+		else if (r != Z_OK && r != Z_BUF_ERROR)
+		{
+			pool->Release(block);
+			inflateEnd(&zs);
+			throw Exception("Corrupted gzip file: " + fileName_);
+		}
+
+		if (data.size == data.data.Size())
+		{
+			dataQueue->Push(blockId++, block);
+			block = NULL;
+		}
+	}
+
+	inflateEnd(&zs);
+
+	if (block != NULL)
+	{
+		if (block->data.size > 0)
+			dataQueue->Push(blockId++, block);
+		else
+			pool->Release(block);
+	}
+
+	if (!memberEnded && !state.IsCancelled())
+		throw Exception("Truncated gzip file: " + fileName_);
+}
+
+
+// inflates the blocks of BGZF members
+//
+class GzBlockInflater : public IOperator
+{
+public:
+	GzBlockInflater(GzStreamState& state_, GzBlockQueue* inflateQueue_, GzBlockQueue* dataQueue_)
+		:	state(state_)
+		,	inflateQueue(inflateQueue_)
+		,	dataQueue(dataQueue_)
+	{}
+
+	void Run();
+
+private:
+	GzStreamState& state;
+	GzBlockQueue* inflateQueue;
+	GzBlockQueue* dataQueue;
+
+	void InflateBlock(z_stream& zs_, GzBlock* block_);
+};
+
+
+void GzBlockInflater::Run()
+{
+	z_stream zs;
+	memset(&zs, 0, sizeof(z_stream));
+	if (inflateInit2(&zs, -15) != Z_OK)
+		state.SetError("Cannot initialize the gzip decoder.");
+
+	int64 partId = 0;
+	GzBlock* block = NULL;
+
+	while (inflateQueue->Pop(partId, block))
+	{
+		if (!state.IsCancelled())
+		{
+			try
+			{
+				InflateBlock(zs, block);
+			}
+			catch (const std::exception& e_)
+			{
+				state.SetError(e_.what());
+			}
+		}
+
+		dataQueue->Push(partId, block);
+	}
+
+	inflateEnd(&zs);
+	dataQueue->SetCompleted();
+}
+
+
+void GzBlockInflater::InflateBlock(z_stream& zs_, GzBlock* block_)
+{
+	const byte* packed = block_->packed.data.Pointer();
+	const uint64 packedSize = block_->packed.size;
+
+	uint64 totalSize = 0;
+	for (uint64 pos = 0; pos < packedSize; pos += bgzf::MemberSize(packed + pos))
+		totalSize += bgzf::InflatedSize(packed + pos, bgzf::MemberSize(packed + pos));
+
+	if (block_->data.data.Size() < totalSize)
+		block_->data.data.Extend(totalSize);
+
+	byte* data = block_->data.data.Pointer();
+	for (uint64 pos = 0; pos < packedSize; )
+	{
+		const uint32 memberSize = bgzf::MemberSize(packed + pos);
+		const uint32 inflatedSize = bgzf::InflatedSize(packed + pos, memberSize);
+
+		inflateReset(&zs_);
+		zs_.next_in = (byte*)packed + pos + bgzf::HeaderSize;
+		zs_.avail_in = memberSize - bgzf::HeaderSize - bgzf::TrailerSize;
+		zs_.next_out = data;
+		zs_.avail_out = inflatedSize;
+
+		if (inflate(&zs_, Z_FINISH) != Z_STREAM_END || zs_.avail_out != 0
+				|| crc32(crc32(0, Z_NULL, 0), data, inflatedSize) != bgzf::Get4Bytes(packed + pos + memberSize - 8))
+			throw Exception("Corrupted BGZF member.");
+
+		data += inflatedSize;
+		pos += memberSize;
+	}
+
+	block_->data.size = totalSize;
+}
+
+
+ParallelGzStreamReader::ParallelGzStreamReader(const std::vector<std::string> &fileNames_, uint32 threadNum_)
+	:	currentBlock(NULL)
+	,	currentPos(0)
+	,	nextBlockId(0)
+{
+	ASSERT(threadNum_ > 0);
+
+	// the blocks are acquired in order, hence the one awaited by the consumer is always
+	// in the pipeline and the reordering cannot stall
+	//
+	const uint32 partNum = threadNum_ * 2 + 2;
+	blockPool = new GzBlockPool(partNum, GzBlock::DefaultBufferSize);
+	inflateQueue = new GzBlockQueue(partNum, 1, GzBlockQueue::UnorderedDelivery);
+	dataQueue = new GzBlockQueue(partNum, threadNum_ + 1);
+
+	reader = new GzBlockReader(fileNames_, state, blockPool, inflateQueue, dataQueue);
+	threads.push_back(new mt::thread(mt::ref(*reader)));
+
+	for (uint32 i = 0; i < threadNum_; ++i)
+	{
+		inflaters.push_back(new GzBlockInflater(state, inflateQueue, dataQueue));
+		threads.push_back(new mt::thread(mt::ref(*inflaters.back())));
+	}
+}
+
+
+ParallelGzStreamReader::~ParallelGzStreamReader()
+{
+	Close();
+}
+
+
+void ParallelGzStreamReader::Close()
+{
+	if (reader == NULL)
+		return;
+
+	// stop the threads and release the blocks still in the pipeline
+	//
+	state.Cancel();
+
+	if (currentBlock != NULL)
+		blockPool->Release(currentBlock);
+	currentBlock = NULL;
+
+	for (std::map<int64, GzBlock*>::iterator i = pendingBlocks.begin(); i != pendingBlocks.end(); ++i)
+		blockPool->Release(i->second);
+	pendingBlocks.clear();
+
+	int64 partId = 0;
+	GzBlock* block = NULL;
+	while (dataQueue->Pop(partId, block))
+		blockPool->Release(block);
+
+	for (uint32 i = 0; i < threads.size(); ++i)
+	{
+		threads[i]->join();
+		delete threads[i];
+	}
+	threads.clear();
+
+	for (uint32 i = 0; i < inflaters.size(); ++i)
+		delete inflaters[i];
+	inflaters.clear();
+
+	TFREE(reader);
+	TFREE(dataQueue);
+	TFREE(inflateQueue);
+	TFREE(blockPool);
+}
+
+
+int64 ParallelGzStreamReader::Read(uchar *mem_, uint64 size_)
+{
+	uint64 n = 0;
+
+	while (n < size_)
+	{
+		if (currentBlock == NULL || currentPos == currentBlock->data.size)
+		{
+			if (!NextBlock())
+				break;
+			continue;
+		}
+
+		const uint64 toCopy = MIN(size_ - n, currentBlock->data.size - currentPos);
+		std::copy(currentBlock->data.data.Pointer() + currentPos,
+				  currentBlock->data.data.Pointer() + currentPos + toCopy,
+				  mem_ + n);
+
+		currentPos += toCopy;
+		n += toCopy;
+	}
+
+	return n;
+}
+
+
+bool ParallelGzStreamReader::NextBlock()
+{
+	if (reader == NULL)
+		return false;
+
+	if (currentBlock != NULL)
+	{
+		blockPool->Release(currentBlock);
+		currentBlock = NULL;
+	}
+
+	// the blocks are inflated out of order, keep them until their turn
+	//
+	std::map<int64, GzBlock*>::iterator i;
+	while ((i = pendingBlocks.find(nextBlockId)) == pendingBlocks.end())
+	{
+		int64 partId = 0;
+		GzBlock* block = NULL;
+		if (!dataQueue->Pop(partId, block))
+		{
+			state.ThrowIfError();
+			ASSERT(pendingBlocks.empty());
+			return false;
+		}
+		pendingBlocks.insert(std::make_pair(partId, block));
+	}
+
+	state.ThrowIfError();
+
+	currentBlock = i->second;
+	currentPos = 0;
+	pendingBlocks.erase(i);
+	nextBlockId++;
+	return true;
+}
+
+#endif // DISABLE_GZ_STREAM
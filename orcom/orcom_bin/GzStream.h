@@ -0,0 +1,145 @@
+/*
+  This file is a part of ORCOM software distributed under GNU GPL 2 licence.
+  Homepage:	http://sun.aei.polsl.pl/orcom
+  Github:	http://github.com/lrog/orcom
+
+  Authors: Sebastian Deorowicz, Szymon Grabowski and Lucas Roguski
+*/
+
+#ifndef H_GZSTREAM
+#define H_GZSTREAM
+
+#include "Globals.h"
+
+#ifndef DISABLE_GZ_STREAM
+
+#include <vector>
+#include <map>
+#include <string>
+
+#include "DataStream.h"
+#include "Buffer.h"
+#include "DataPool.h"
+#include "DataQueue.h"
+#include "Thread.h"
+
+
+// a part of the gzip input -- the compressed BGZF members to inflate and the inflated data
+//
+struct GzBlock
+{
+	static const uint32 DefaultBufferSize = 1 << 22;
+
+	DataChunk packed;
+	DataChunk data;
+
+	GzBlock(uint64 bufferSize_ = DefaultBufferSize)
+		:	packed(bufferSize_ / 4)
+		,	data(bufferSize_)
+	{}
+
+	void Reset()
+	{
+		packed.Reset();
+		data.Reset();
+	}
+};
+
+typedef TDataPool<GzBlock> GzBlockPool;
+typedef TDataQueue<GzBlock> GzBlockQueue;
+
+
+// the state shared by the inflating threads and the consumer
+//
+class GzStreamState
+{
+public:
+	GzStreamState()
+		:	cancelled(false)
+	{}
+
+	void Cancel()
+	{
+		mt::lock_guard<mt::mutex> lock(mutex);
+		cancelled = true;
+	}
+
+	bool IsCancelled()
+	{
+		mt::lock_guard<mt::mutex> lock(mutex);
+		return cancelled;
+	}
+
+	void SetError(const std::string& error_)
+	{
+		mt::lock_guard<mt::mutex> lock(mutex);
+		if (error.empty())
+			error = error_;
+		cancelled = true;
+	}
+
+	void ThrowIfError();
+
+private:
+	bool cancelled;
+	std::string error;
+	mt::mutex mutex;
+};
+
+
+class GzBlockReader;
+class GzBlockInflater;
+
+
+// reads the gzip-compressed files inflating them ahead of the consumer, in separate threads.
+// The BGZF files (series of gzip members storing their compressed size in the header,
+// e.g. produced by bgzip) are split on the member boundaries and inflated in parallel,
+// the other ones (plain or multi-member gzip) are inflated by the reading thread
+//
+class ParallelGzStreamReader : public IDataStreamReader
+{
+public:
+	ParallelGzStreamReader(const std::vector<std::string>& fileNames_, uint32 threadNum_ = 1);
+	~ParallelGzStreamReader();
+
+	void Close();
+
+	int64 Read(uchar* mem_, uint64 size_);
+
+	uint64 Size() const
+	{
+		return 0;
+	}
+
+	uint64 Position() const
+	{
+		return 0;
+	}
+
+	void SetPosition(uint64 )
+	{
+		ASSERT(0);
+	}
+
+private:
+	GzStreamState state;
+
+	GzBlockPool* blockPool;
+	GzBlockQueue* inflateQueue;
+	GzBlockQueue* dataQueue;
+
+	GzBlockReader* reader;
+	std::vector<GzBlockInflater*> inflaters;
+	std::vector<mt::thread*> threads;
+
+	std::map<int64, GzBlock*> pendingBlocks;
+	GzBlock* currentBlock;
+	uint64 currentPos;
+	int64 nextBlockId;
+
+	bool NextBlock();
+};
+
+#endif // DISABLE_GZ_STREAM
+
+#endif // H_GZSTREAM
@@ -0,0 +1,147 @@
+/*
+  This file is a part of ORCOM software distributed under GNU GPL 2 licence.
+  Homepage:	http://sun.aei.polsl.pl/orcom
+  Github:	http://github.com/lrog/orcom
+
+  Authors: Sebastian Deorowicz, Szymon Grabowski and Lucas Roguski
+*/
+
+#ifndef H_LINEINDEXER
+#define H_LINEINDEXER
+
+#include "Globals.h"
+
+#include <vector>
+
+#if defined(__GNUC__) && defined(__SSE2__)
+#	define LINE_INDEXER_SSE2 1
+#	include <emmintrin.h>
+#else
+#	define LINE_INDEXER_SSE2 0
+#endif
+
+
+// finds the line ends in the FASTQ data, '\n', '\r' and "\r\n" terminating a line -- the
+// vectorized (SSE2) scan tests 16 bytes at once. The lines are indexed in batches of
+// MaxLinesNum, which bounds the table size independently of the chunk size
+//
+class LineIndexer
+{
+public:
+	static const uint32 MaxLinesNum = 1 << 16;
+
+	LineIndexer()
+		:	data(NULL)
+		,	size(0)
+		,	scanPos(0)
+		,	lineIdx(0)
+	{
+		lineEnds.reserve(MaxLinesNum + 1);
+	}
+
+	void Start(const byte* data_, uint64 size_)
+	{
+		data = data_;
+		size = size_;
+		scanPos = 0;
+		lineIdx = 0;
+		lineEnds.clear();
+	}
+
+	// returns the position of the terminator of the next line or the data size if the
+	// line is not terminated or there are no more lines
+	//
+	uint64 NextEol()
+	{
+		if (lineIdx == lineEnds.size())
+		{
+			if (scanPos >= size)
+				return size;
+			IndexLines();
+		}
+		return lineEnds[lineIdx++];
+	}
+
+	// returns the position of the first line terminator from pos_ on or size_ if not found
+	//
+	static uint64 FindEol(const byte* data_, uint64 pos_, uint64 size_)
+	{
+#if LINE_INDEXER_SSE2
+		const __m128i lf = _mm_set1_epi8('\n');
+		const __m128i cr = _mm_set1_epi8('\r');
+
+		for ( ; pos_ + 16 <= size_; pos_ += 16)
+		{
+			const __m128i v = _mm_loadu_si128((const __m128i*)(data_ + pos_));
+			const uint32 mask = _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(v, lf), _mm_cmpeq_epi8(v, cr)));
+			if (mask != 0)
+				return pos_ + __builtin_ctz(mask);
+		}
+#endif
+
+		while (pos_ < size_ && data_[pos_] != '\n' && data_[pos_] != '\r')
+			++pos_;
+		return pos_;
+	}
+
+private:
+	const byte* data;
+	uint64 size;
+	uint64 scanPos;				// the beginning of the first line not indexed yet
+	uint32 lineIdx;
+	std::vector<uint64> lineEnds;
+
+	void IndexLines()
+	{
+		lineEnds.clear();
+		lineIdx = 0;
+
+		uint64 i = scanPos;
+
+#if LINE_INDEXER_SSE2
+		const __m128i lf = _mm_set1_epi8('\n');
+		const __m128i cr = _mm_set1_epi8('\r');
+
+		for ( ; i + 16 <= size && lineEnds.size() < MaxLinesNum; i += 16)
+		{
+			const __m128i v = _mm_loadu_si128((const __m128i*)(data + i));
+			uint32 mask = _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(v, lf), _mm_cmpeq_epi8(v, cr)));
+
+			for ( ; mask != 0 && lineEnds.size() < MaxLinesNum; mask &= mask - 1)
+				AddLineEnd(i + __builtin_ctz(mask));
+		}
+
+		if (lineEnds.size() == MaxLinesNum)
+			return;
+#endif
+
+		for ( ; i < size && lineEnds.size() < MaxLinesNum; ++i)
+		{
+			if (data[i] == '\n' || data[i] == '\r')
+				AddLineEnd(i);
+		}
+
+		if (lineEnds.size() == MaxLinesNum)
+			return;
+
+		// the last line is not terminated
+		//
+		if (scanPos < size)
+			lineEnds.push_back(size);
+		scanPos = size;
+	}
+
+	void AddLineEnd(uint64 pos_)
+	{
+		if (pos_ < scanPos)						// LF of the CR LF pair
+			return;
+
+		lineEnds.push_back(pos_);
+		scanPos = pos_ + 1;
+		if (data[pos_] == '\r' && scanPos < size && data[scanPos] == '\n')
+			scanPos++;
+	}
+};
+
+
+#endif // H_LINEINDEXER
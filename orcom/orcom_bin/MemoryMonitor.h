@@ -0,0 +1,102 @@
+/*
+  This file is a part of ORCOM software distributed under GNU GPL 2 licence.
+  Homepage:	http://sun.aei.polsl.pl/orcom
+  Github:	http://github.com/lrog/orcom
+
+  Authors: Sebastian Deorowicz, Szymon Grabowski and Lucas Roguski
+*/
+
+#ifndef H_MEMORYMONITOR
+#define H_MEMORYMONITOR
+
+#include "Globals.h"
+
+#include <stdio.h>
+
+#if defined(__linux__)
+#	include <unistd.h>
+#	include <sys/resource.h>
+#endif
+
+
+// samples the resident memory size of the process, checking it against the memory
+// budget, and the memory available in the system -- supported only on Linux, elsewhere
+// the sizes are always reported as 0
+//
+class MemoryMonitor
+{
+public:
+	MemoryMonitor(uint64 budget_)
+		:	budget(budget_)
+	{}
+
+	uint64 Budget() const
+	{
+		return budget;
+	}
+
+	bool IsOverBudget() const
+	{
+		return budget > 0 && ResidentSize() > budget;
+	}
+
+	static uint64 ResidentSize()
+	{
+#if defined(__linux__)
+		FILE* f = fopen("/proc/self/statm", "r");
+		if (f == NULL)
+			return 0;
+
+		unsigned long long totalPages = 0, residentPages = 0;
+		const int32 n = fscanf(f, "%llu %llu", &totalPages, &residentPages);
+		fclose(f);
+
+		if (n != 2)
+			return 0;
+		return (uint64)residentPages * sysconf(_SC_PAGESIZE);
+#else
+		return 0;
+#endif
+	}
+
+	// the memory available for starting new processes without swapping, as estimated
+	// by the kernel
+	//
+	static uint64 AvailableSize()
+	{
+#if defined(__linux__)
+		FILE* f = fopen("/proc/meminfo", "r");
+		if (f == NULL)
+			return 0;
+
+		char line[256];
+		unsigned long long availableKb = 0;
+		bool found = false;
+		while (!found && fgets(line, sizeof(line), f) != NULL)
+			found = sscanf(line, "MemAvailable: %llu kB", &availableKb) == 1;
+		fclose(f);
+
+		return found ? (uint64)availableKb << 10 : 0;
+#else
+		return 0;
+#endif
+	}
+
+	static uint64 PeakResidentSize()
+	{
+#if defined(__linux__)
+		struct rusage usage;
+		if (getrusage(RUSAGE_SELF, &usage) != 0)
+			return 0;
+		return (uint64)usage.ru_maxrss << 10;		// in kB
+#else
+		return 0;
+#endif
+	}
+
+private:
+	const uint64 budget;
+};
+
+
+#endif // H_MEMORYMONITOR
@@ -0,0 +1,638 @@
+/*
+  This file is a part of ORCOM software distributed under GNU GPL 2 licence.
+  Homepage:	http://sun.aei.polsl.pl/orcom
+  Github:	http://github.com/lrog/orcom
+
+  Authors: Sebastian Deorowicz, Szymon Grabowski and Lucas Roguski
+*/
+
+#include "Globals.h"
+
+#include <algorithm>
+
+#include "MinimizerKernel.h"
+
+#if MINIMIZER_KERNEL_X86
+#	include <immintrin.h>
+#endif
+
+
+MinimizerKernel::MinimizerKernel(const MinimizerParameters& params_, InstructionSet instrSet_)
+	:	signatureLen(params_.signatureLen)
+	,	maxSignatureValue(1 << (2 * params_.signatureLen))
+#if MINIMIZER_KERNEL_X86
+	,	instrSet(instrSet_)
+#else
+	,	instrSet(InstrScalar)
+#endif
+{
+	ASSERT(signatureLen >= 3 && signatureLen <= 15);
+
+	std::fill(symbolIdxTable, symbolIdxTable + SymbolTableSize, (uchar)InvalidSymbolIdx);
+	for (uint32 i = 0; i < 5; ++i)
+		symbolIdxTable[(uchar)params_.dnaSymbolOrder[i]] = i;
+
+	// symbol index of the complementary base -- used by reverse-compliment signatures
+	//
+	std::fill(rcSymbolIdxTable, rcSymbolIdxTable + SymbolTableSize, (uchar)InvalidSymbolIdx);
+	rcSymbolIdxTable[(uchar)'A'] = symbolIdxTable[(uchar)'T'];
+	rcSymbolIdxTable[(uchar)'C'] = symbolIdxTable[(uchar)'G'];
+	rcSymbolIdxTable[(uchar)'G'] = symbolIdxTable[(uchar)'C'];
+	rcSymbolIdxTable[(uchar)'T'] = symbolIdxTable[(uchar)'A'];
+	rcSymbolIdxTable[(uchar)'N'] = symbolIdxTable[(uchar)'N'];
+
+	// the vectorized variants compare the bytes with the 4 bases exactly, any other byte
+	// is translated to 'N' as by the tables
+	//
+	std::copy(params_.dnaSymbolOrder, params_.dnaSymbolOrder + 4, baseSymbols);
+
+	// precompute signature validity -- for longer signatures the bitmap would be too large
+	// and the validity is computed on the fly
+	//
+	if (signatureLen <= MaxValidityTableSignatureLen)
+	{
+		validSignatureTable.resize(MAX(maxSignatureValue / 64, 1), 0);
+		for (uint32 m = 0; m < maxSignatureValue; ++m)
+		{
+			if (ComputeSignatureValidity(m, signatureLen))
+				validSignatureTable[m / 64] |= 1ULL << (m % 64);
+		}
+	}
+
+	for (uint32 i = 0; i < MaxPowersNum; ++i)
+	{
+		std::fill(fwdPowers[i], fwdPowers[i] + BufferSize, 0);
+		std::fill(revPowers[i], revPowers[i] + BufferSize, 0);
+	}
+}
+
+
+MinimizerKernel::InstructionSet MinimizerKernel::DetectInstructionSet()
+{
+#if MINIMIZER_KERNEL_X86
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2"))
+		return InstrAvx2;
+	if (__builtin_cpu_supports("sse4.2"))
+		return InstrSse42;
+	return InstrScalar;
+#else
+	return InstrScalar;
+#endif
+}
+
+
+bool MinimizerKernel::IsSignatureValid(uint32 sig_) const
+{
+	ASSERT(sig_ < maxSignatureValue);
+
+	if (validSignatureTable.size() > 0)
+		return ((validSignatureTable[sig_ / 64] >> (sig_ % 64)) & 1) != 0;
+
+	return ComputeSignatureValidity(sig_, signatureLen);
+}
+
+
+bool MinimizerKernel::ComputeSignatureValidity(uint32 sig_, uint32 sigLen_)
+{
+	ASSERT(sigLen_ >= 3 && sigLen_ <= 16);
+
+	// a signature is invalid if it contains any homopolymer 3-mer: 'AAA', 'CCC', 'GGG' or 'TTT'.
+	// Marks positions where two neighbour symbols differ and checks whether each 3-mer
+	// has at least one such position
+	//
+	const uint64 symbolMask = 0x5555555555555555ULL;
+	const uint64 m = sig_ & ((1ULL << (2*sigLen_)) - 1);
+
+	const uint64 diff = m ^ (m >> 2);
+	const uint64 neighbourDiff = (diff | (diff >> 1)) & symbolMask;
+	const uint64 tripletDiff = neighbourDiff | (neighbourDiff >> 2);
+	const uint64 tripletMask = ((1ULL << (2*(sigLen_ - 2))) - 1) & symbolMask;
+
+	return (tripletDiff & tripletMask) == tripletMask;
+}
+
+
+void MinimizerKernel::FindMinimumSignatures(const char* dna_, uint32 len_,
+											int32 fwdBeg_, int32 fwdEnd_, int32 revBeg_, int32 revEnd_,
+											uint32& minFwd_, uint32& minRev_)
+{
+	ASSERT(len_ <= DnaRecord::MaxDnaLen);
+
+	const bool withRev = revBeg_ <= revEnd_;
+
+	minFwd_ = InvalidSignature;
+	minRev_ = InvalidSignature;
+
+#if MINIMIZER_KERNEL_X86
+	if (instrSet != InstrScalar)
+	{
+		int32 windows = 0;
+		if (instrSet == InstrAvx2)
+		{
+			windows = withRev ? ComputeSignaturesAvx2<true>(dna_, len_, fwdSignatures, revSignatures)
+							  : ComputeSignaturesAvx2<false>(dna_, len_, fwdSignatures, NULL);
+		}
+		else
+		{
+			windows = withRev ? ComputeSignaturesSse42<true>(dna_, len_, fwdSignatures, revSignatures)
+							  : ComputeSignaturesSse42<false>(dna_, len_, fwdSignatures, NULL);
+		}
+
+		const int32 fwdBeg = MAX(fwdBeg_, 0);
+		const int32 fwdEnd = MIN(fwdEnd_, windows - 1);
+		const int32 revBeg = MAX(revBeg_, 0);
+		const int32 revEnd = MIN(revEnd_, windows - 1);
+
+		if (instrSet == InstrAvx2)
+		{
+			minFwd_ = FindMinimumAvx2(fwdSignatures, fwdBeg, fwdEnd);
+			if (withRev)
+				minRev_ = FindMinimumAvx2(revSignatures, revBeg, revEnd);
+		}
+		else
+		{
+			minFwd_ = FindMinimumSse42(fwdSignatures, fwdBeg, fwdEnd);
+			if (withRev)
+				minRev_ = FindMinimumSse42(revSignatures, revBeg, revEnd);
+		}
+		return;
+	}
+#endif
+
+	if (withRev)
+		FindMinimumSignaturesScalar<true>(dna_, len_, fwdBeg_, fwdEnd_, revBeg_, revEnd_, minFwd_, minRev_);
+	else
+		FindMinimumSignaturesScalar<false>(dna_, len_, fwdBeg_, fwdEnd_, revBeg_, revEnd_, minFwd_, minRev_);
+}
+
+
+int32 MinimizerKernel::ComputeSignatures(const char* dna_, uint32 len_, uint32* signatures_)
+{
+	ASSERT(len_ <= DnaRecord::MaxDnaLen);
+
+#if MINIMIZER_KERNEL_X86
+	if (instrSet == InstrAvx2)
+		return ComputeSignaturesAvx2<false>(dna_, len_, signatures_, NULL);
+	if (instrSet == InstrSse42)
+		return ComputeSignaturesSse42<false>(dna_, len_, signatures_, NULL);
+#endif
+
+	return ComputeSignaturesScalar(dna_, len_, signatures_);
+}
+
+
+template <bool _TWithRev>
+void MinimizerKernel::FindMinimumSignaturesScalar(const char* dna_, uint32 len_,
+												  int32 fwdBeg_, int32 fwdEnd_, int32 revBeg_, int32 revEnd_,
+												  uint32& minFwd_, uint32& minRev_)
+{
+	// rolling 2-bit encoding of the window on both strands -- O(1) update per symbol,
+	// 'validFrom' marks the first window end not overlapping any 'N' symbol
+	//
+	const int32 sigLen = signatureLen;
+	const uint32 kmerMask = maxSignatureValue - 1;
+	const uint32 rcShift = 2 * (sigLen - 1);
+
+	const int32 ibeg = _TWithRev ? MIN(fwdBeg_, revBeg_) : fwdBeg_;
+	const int32 iend = MIN((_TWithRev ? MAX(fwdEnd_, revEnd_) : fwdEnd_) + sigLen, (int32)len_);
+
+	uint32 minFwd = InvalidSignature;
+	uint32 minRev = InvalidSignature;
+	uint32 kmerFwd = 0;
+	uint32 kmerRev = 0;
+	int32 validFrom = ibeg + sigLen - 1;
+
+	for (int32 i = ibeg; i < iend; ++i)
+	{
+		const char c = dna_[i];
+		const uint32 s = SymbolIdx(c);
+		ASSERT(s <= 4);
+
+		if (s > 3)
+		{
+			validFrom = i + sigLen;
+			continue;
+		}
+
+		kmerFwd = ((kmerFwd << 2) | s) & kmerMask;
+		if (_TWithRev)
+			kmerRev = (kmerRev >> 2) | (RcSymbolIdx(c) << rcShift);
+
+		if (i < validFrom)
+			continue;
+
+		const int32 pos = i - sigLen + 1;
+
+		if (pos >= fwdBeg_ && pos <= fwdEnd_ && kmerFwd < minFwd && IsSignatureValid(kmerFwd))
+			minFwd = kmerFwd;
+
+		if (_TWithRev && pos >= revBeg_ && pos <= revEnd_ && kmerRev < minRev && IsSignatureValid(kmerRev))
+			minRev = kmerRev;
+	}
+
+	minFwd_ = minFwd;
+	minRev_ = minRev;
+}
+
+
+int32 MinimizerKernel::ComputeSignaturesScalar(const char* dna_, uint32 len_, uint32* signatures_)
+{
+	const int32 sigLen = signatureLen;
+	const uint32 kmerMask = maxSignatureValue - 1;
+
+	uint32 kmer = 0;
+	int32 validFrom = sigLen - 1;
+
+	for (int32 i = 0; i < (int32)len_; ++i)
+	{
+		const uint32 s = SymbolIdx(dna_[i]);
+		ASSERT(s <= 4);
+
+		if (s > 3)
+			validFrom = i + sigLen;
+		else
+			kmer = ((kmer << 2) | s) & kmerMask;
+
+		if (i < sigLen - 1)
+			continue;
+
+		const bool isValid = (i >= validFrom) && IsSignatureValid(kmer);
+		signatures_[i - sigLen + 1] = isValid ? kmer : InvalidSignature;
+	}
+
+	return MAX((int32)len_ - sigLen + 1, 0);
+}
+
+
+void MinimizerKernel::InvalidateNWindows(int32 nCount_, int32 windowsCount_, uint32* fwd_, uint32* rev_)
+{
+	for (int32 i = 0; i < nCount_; ++i)
+	{
+		const int32 beg = MAX(nPositions[i] - (int32)signatureLen + 1, 0);
+		const int32 end = MIN(nPositions[i], windowsCount_ - 1);
+
+		for (int32 j = beg; j <= end; ++j)
+		{
+			fwd_[j] = InvalidSignature;
+			if (rev_ != NULL)
+				rev_[j] = InvalidSignature;
+		}
+	}
+}
+
+
+#if MINIMIZER_KERNEL_X86
+
+// translates 16 symbols to their indices, the bytes other than the 4 bases to the 'N' one
+//
+TARGET_SSE42 static inline __m128i TranslateSymbols(__m128i dna_, const __m128i* bases_, const __m128i* codes_)
+{
+	__m128i s = _mm_set1_epi8(4);
+	for (uint32 k = 0; k < 4; ++k)
+		s = _mm_blendv_epi8(s, codes_[k], _mm_cmpeq_epi8(dna_, bases_[k]));
+	return s;
+}
+
+
+// The vectorized variants translate the read into 32-bit symbol codes and build the
+// signatures of windows of lengths 1, 2, 4, 8 ... by doubling:
+//   fwd[2a](p) = fwd[a](p) << 2a | fwd[a](p + a)
+//   rev[2a](p) = rev[a](p) | rev[a](p + a) << 2a
+// combining them afterwards according to the binary representation of the signature
+// length. The windows containing 'N' symbols are invalidated at the end. All the buffers
+// have enough padding for the loads past the end of the read.
+//
+template <bool _TWithRev>
+int32 MinimizerKernel::ComputeSignaturesSse42(const char* dna_, uint32 len_, uint32* fwd_, uint32* rev_)
+{
+	const int32 sigLen = signatureLen;
+	const int32 len = len_;
+	const int32 windows = len - sigLen + 1;
+
+	if (windows <= 0)
+		return 0;
+
+	// translate symbols
+	//
+	__m128i bases[4], fwdCodes[4], rcCodes[4];
+	for (uint32 k = 0; k < 4; ++k)
+	{
+		bases[k] = _mm_set1_epi8(baseSymbols[k]);
+		fwdCodes[k] = _mm_set1_epi8(SymbolIdx(baseSymbols[k]));
+		rcCodes[k] = _mm_set1_epi8(RcSymbolIdx(baseSymbols[k]));
+	}
+	const __m128i nSymbol = _mm_set1_epi8(InvalidSymbolIdx);
+
+	uint32* f0 = fwdPowers[0];
+	uint32* r0 = revPowers[0];
+	int32 nCount = 0;
+	int32 i = 0;
+
+	for ( ; i + 16 <= len; i += 16)
+	{
+		const __m128i v = _mm_loadu_si128((const __m128i*)(dna_ + i));
+		const __m128i s = TranslateSymbols(v, bases, fwdCodes);
+
+		uint32 nMask = _mm_movemask_epi8(_mm_cmpeq_epi8(s, nSymbol));
+		while (nMask != 0)
+		{
+			nPositions[nCount++] = i + __builtin_ctz(nMask);
+			nMask &= nMask - 1;
+		}
+
+		_mm_storeu_si128((__m128i*)(f0 + i), _mm_cvtepu8_epi32(s));
+		_mm_storeu_si128((__m128i*)(f0 + i + 4), _mm_cvtepu8_epi32(_mm_srli_si128(s, 4)));
+		_mm_storeu_si128((__m128i*)(f0 + i + 8), _mm_cvtepu8_epi32(_mm_srli_si128(s, 8)));
+		_mm_storeu_si128((__m128i*)(f0 + i + 12), _mm_cvtepu8_epi32(_mm_srli_si128(s, 12)));
+
+		if (_TWithRev)
+		{
+			const __m128i r = TranslateSymbols(v, bases, rcCodes);
+			_mm_storeu_si128((__m128i*)(r0 + i), _mm_cvtepu8_epi32(r));
+			_mm_storeu_si128((__m128i*)(r0 + i + 4), _mm_cvtepu8_epi32(_mm_srli_si128(r, 4)));
+			_mm_storeu_si128((__m128i*)(r0 + i + 8), _mm_cvtepu8_epi32(_mm_srli_si128(r, 8)));
+			_mm_storeu_si128((__m128i*)(r0 + i + 12), _mm_cvtepu8_epi32(_mm_srli_si128(r, 12)));
+		}
+	}
+
+	for ( ; i < len; ++i)
+	{
+		const uint32 s = SymbolIdx(dna_[i]);
+		if (s > 3)
+			nPositions[nCount++] = i;
+
+		f0[i] = s;
+		if (_TWithRev)
+			r0[i] = RcSymbolIdx(dna_[i]);
+	}
+
+	// build power-of-2 length windows
+	//
+	int32 topPower = 0;
+	for (int32 a = 1; 2 * a <= sigLen; a <<= 1, ++topPower)
+	{
+		const uint32* fs = fwdPowers[topPower];
+		uint32* fd = fwdPowers[topPower + 1];
+		const uint32* rs = revPowers[topPower];
+		uint32* rd = revPowers[topPower + 1];
+		const __m128i shift = _mm_cvtsi32_si128(2 * a);
+		const int32 count = len - 2 * a + 1;
+
+		for (int32 p = 0; p < count; p += 4)
+		{
+			const __m128i x = _mm_loadu_si128((const __m128i*)(fs + p));
+			const __m128i y = _mm_loadu_si128((const __m128i*)(fs + p + a));
+			_mm_storeu_si128((__m128i*)(fd + p), _mm_or_si128(_mm_sll_epi32(x, shift), y));
+
+			if (_TWithRev)
+			{
+				const __m128i xr = _mm_loadu_si128((const __m128i*)(rs + p));
+				const __m128i yr = _mm_loadu_si128((const __m128i*)(rs + p + a));
+				_mm_storeu_si128((__m128i*)(rd + p), _mm_or_si128(xr, _mm_sll_epi32(yr, shift)));
+			}
+		}
+	}
+
+	// combine the final signatures and mask out the invalid ones
+	//
+	const __m128i symbolMask = _mm_set1_epi32(0x55555555);
+	const __m128i tripletMask = _mm_set1_epi32(((1U << (2*(sigLen - 2))) - 1) & 0x55555555);
+	const __m128i allOnes = _mm_set1_epi32(-1);
+
+	for (int32 p = 0; p < windows; p += 4)
+	{
+		__m128i f = _mm_loadu_si128((const __m128i*)(fwdPowers[topPower] + p));
+		__m128i r = _mm_setzero_si128();
+		if (_TWithRev)
+			r = _mm_loadu_si128((const __m128i*)(revPowers[topPower] + p));
+
+		int32 off = 1 << topPower;
+		for (int32 j = topPower - 1; j >= 0; --j)
+		{
+			if ((sigLen & (1 << j)) == 0)
+				continue;
+
+			const __m128i fp = _mm_loadu_si128((const __m128i*)(fwdPowers[j] + p + off));
+			f = _mm_or_si128(_mm_sll_epi32(f, _mm_cvtsi32_si128(2 << j)), fp);
+
+			if (_TWithRev)
+			{
+				const __m128i rp = _mm_loadu_si128((const __m128i*)(revPowers[j] + p + off));
+				r = _mm_or_si128(r, _mm_sll_epi32(rp, _mm_cvtsi32_si128(2 * off)));
+			}
+			off += 1 << j;
+		}
+
+		{
+			const __m128i d = _mm_xor_si128(f, _mm_srli_epi32(f, 2));
+			const __m128i e = _mm_and_si128(_mm_or_si128(d, _mm_srli_epi32(d, 1)), symbolMask);
+			const __m128i t = _mm_and_si128(_mm_or_si128(e, _mm_srli_epi32(e, 2)), tripletMask);
+			const __m128i valid = _mm_cmpeq_epi32(t, tripletMask);
+			_mm_storeu_si128((__m128i*)(fwd_ + p), _mm_or_si128(f, _mm_andnot_si128(valid, allOnes)));
+		}
+
+		if (_TWithRev)
+		{
+			const __m128i d = _mm_xor_si128(r, _mm_srli_epi32(r, 2));
+			const __m128i e = _mm_and_si128(_mm_or_si128(d, _mm_srli_epi32(d, 1)), symbolMask);
+			const __m128i t = _mm_and_si128(_mm_or_si128(e, _mm_srli_epi32(e, 2)), tripletMask);
+			const __m128i valid = _mm_cmpeq_epi32(t, tripletMask);
+			_mm_storeu_si128((__m128i*)(rev_ + p), _mm_or_si128(r, _mm_andnot_si128(valid, allOnes)));
+		}
+	}
+
+	InvalidateNWindows(nCount, windows, fwd_, _TWithRev ? rev_ : NULL);
+
+	return windows;
+}
+
+
+template <bool _TWithRev>
+int32 MinimizerKernel::ComputeSignaturesAvx2(const char* dna_, uint32 len_, uint32* fwd_, uint32* rev_)
+{
+	const int32 sigLen = signatureLen;
+	const int32 len = len_;
+	const int32 windows = len - sigLen + 1;
+
+	if (windows <= 0)
+		return 0;
+
+	// translate symbols
+	//
+	__m128i bases[4], fwdCodes[4], rcCodes[4];
+	for (uint32 k = 0; k < 4; ++k)
+	{
+		bases[k] = _mm_set1_epi8(baseSymbols[k]);
+		fwdCodes[k] = _mm_set1_epi8(SymbolIdx(baseSymbols[k]));
+		rcCodes[k] = _mm_set1_epi8(RcSymbolIdx(baseSymbols[k]));
+	}
+	const __m128i nSymbol = _mm_set1_epi8(InvalidSymbolIdx);
+
+	uint32* f0 = fwdPowers[0];
+	uint32* r0 = revPowers[0];
+	int32 nCount = 0;
+	int32 i = 0;
+
+	for ( ; i + 16 <= len; i += 16)
+	{
+		const __m128i v = _mm_loadu_si128((const __m128i*)(dna_ + i));
+		const __m128i s = TranslateSymbols(v, bases, fwdCodes);
+
+		uint32 nMask = _mm_movemask_epi8(_mm_cmpeq_epi8(s, nSymbol));
+		while (nMask != 0)
+		{
+			nPositions[nCount++] = i + __builtin_ctz(nMask);
+			nMask &= nMask - 1;
+		}
+
+		_mm256_storeu_si256((__m256i*)(f0 + i), _mm256_cvtepu8_epi32(s));
+		_mm256_storeu_si256((__m256i*)(f0 + i + 8), _mm256_cvtepu8_epi32(_mm_srli_si128(s, 8)));
+
+		if (_TWithRev)
+		{
+			const __m128i r = TranslateSymbols(v, bases, rcCodes);
+			_mm256_storeu_si256((__m256i*)(r0 + i), _mm256_cvtepu8_epi32(r));
+			_mm256_storeu_si256((__m256i*)(r0 + i + 8), _mm256_cvtepu8_epi32(_mm_srli_si128(r, 8)));
+		}
+	}
+
+	for ( ; i < len; ++i)
+	{
+		const uint32 s = SymbolIdx(dna_[i]);
+		if (s > 3)
+			nPositions[nCount++] = i;
+
+		f0[i] = s;
+		if (_TWithRev)
+			r0[i] = RcSymbolIdx(dna_[i]);
+	}
+
+	// build power-of-2 length windows
+	//
+	int32 topPower = 0;
+	for (int32 a = 1; 2 * a <= sigLen; a <<= 1, ++topPower)
+	{
+		const uint32* fs = fwdPowers[topPower];
+		uint32* fd = fwdPowers[topPower + 1];
+		const uint32* rs = revPowers[topPower];
+		uint32* rd = revPowers[topPower + 1];
+		const __m128i shift = _mm_cvtsi32_si128(2 * a);
+		const int32 count = len - 2 * a + 1;
+
+		for (int32 p = 0; p < count; p += 8)
+		{
+			const __m256i x = _mm256_loadu_si256((const __m256i*)(fs + p));
+			const __m256i y = _mm256_loadu_si256((const __m256i*)(fs + p + a));
+			_mm256_storeu_si256((__m256i*)(fd + p), _mm256_or_si256(_mm256_sll_epi32(x, shift), y));
+
+			if (_TWithRev)
+			{
+				const __m256i xr = _mm256_loadu_si256((const __m256i*)(rs + p));
+				const __m256i yr = _mm256_loadu_si256((const __m256i*)(rs + p + a));
+				_mm256_storeu_si256((__m256i*)(rd + p), _mm256_or_si256(xr, _mm256_sll_epi32(yr, shift)));
+			}
+		}
+	}
+
+	// combine the final signatures and mask out the invalid ones
+	//
+	const __m256i symbolMask = _mm256_set1_epi32(0x55555555);
+	const __m256i tripletMask = _mm256_set1_epi32(((1U << (2*(sigLen - 2))) - 1) & 0x55555555);
+	const __m256i allOnes = _mm256_set1_epi32(-1);
+
+	for (int32 p = 0; p < windows; p += 8)
+	{
+		__m256i f = _mm256_loadu_si256((const __m256i*)(fwdPowers[topPower] + p));
+		__m256i r = _mm256_setzero_si256();
+		if (_TWithRev)
+			r = _mm256_loadu_si256((const __m256i*)(revPowers[topPower] + p));
+
+		int32 off = 1 << topPower;
+		for (int32 j = topPower - 1; j >= 0; --j)
+		{
+			if ((sigLen & (1 << j)) == 0)
+				continue;
+
+			const __m256i fp = _mm256_loadu_si256((const __m256i*)(fwdPowers[j] + p + off));
+			f = _mm256_or_si256(_mm256_sll_epi32(f, _mm_cvtsi32_si128(2 << j)), fp);
+
+			if (_TWithRev)
+			{
+				const __m256i rp = _mm256_loadu_si256((const __m256i*)(revPowers[j] + p + off));
+				r = _mm256_or_si256(r, _mm256_sll_epi32(rp, _mm_cvtsi32_si128(2 * off)));
+			}
+			off += 1 << j;
+		}
+
+		{
+			const __m256i d = _mm256_xor_si256(f, _mm256_srli_epi32(f, 2));
+			const __m256i e = _mm256_and_si256(_mm256_or_si256(d, _mm256_srli_epi32(d, 1)), symbolMask);
+			const __m256i t = _mm256_and_si256(_mm256_or_si256(e, _mm256_srli_epi32(e, 2)), tripletMask);
+			const __m256i valid = _mm256_cmpeq_epi32(t, tripletMask);
+			_mm256_storeu_si256((__m256i*)(fwd_ + p), _mm256_or_si256(f, _mm256_andnot_si256(valid, allOnes)));
+		}
+
+		if (_TWithRev)
+		{
+			const __m256i d = _mm256_xor_si256(r, _mm256_srli_epi32(r, 2));
+			const __m256i e = _mm256_and_si256(_mm256_or_si256(d, _mm256_srli_epi32(d, 1)), symbolMask);
+			const __m256i t = _mm256_and_si256(_mm256_or_si256(e, _mm256_srli_epi32(e, 2)), tripletMask);
+			const __m256i valid = _mm256_cmpeq_epi32(t, tripletMask);
+			_mm256_storeu_si256((__m256i*)(rev_ + p), _mm256_or_si256(r, _mm256_andnot_si256(valid, allOnes)));
+		}
+	}
+
+	InvalidateNWindows(nCount, windows, fwd_, _TWithRev ? rev_ : NULL);
+
+	return windows;
+}
+
+
+uint32 MinimizerKernel::FindMinimumSse42(const uint32* sig_, int32 beg_, int32 end_)
+{
+	uint32 minSig = InvalidSignature;
+	int32 p = beg_;
+
+	if (end_ - beg_ + 1 >= 4)
+	{
+		__m128i m = _mm_set1_epi32(-1);
+		for ( ; p + 4 <= end_ + 1; p += 4)
+			m = _mm_min_epu32(m, _mm_loadu_si128((const __m128i*)(sig_ + p)));
+
+		m = _mm_min_epu32(m, _mm_shuffle_epi32(m, _MM_SHUFFLE(1, 0, 3, 2)));
+		m = _mm_min_epu32(m, _mm_shuffle_epi32(m, _MM_SHUFFLE(2, 3, 0, 1)));
+		minSig = (uint32)_mm_cvtsi128_si32(m);
+	}
+
+	for ( ; p <= end_; ++p)
+		minSig = MIN(minSig, sig_[p]);
+
+	return minSig;
+}
+
+
+uint32 MinimizerKernel::FindMinimumAvx2(const uint32* sig_, int32 beg_, int32 end_)
+{
+	uint32 minSig = InvalidSignature;
+	int32 p = beg_;
+
+	if (end_ - beg_ + 1 >= 8)
+	{
+		__m256i m8 = _mm256_set1_epi32(-1);
+		for ( ; p + 8 <= end_ + 1; p += 8)
+			m8 = _mm256_min_epu32(m8, _mm256_loadu_si256((const __m256i*)(sig_ + p)));
+
+		__m128i m = _mm_min_epu32(_mm256_castsi256_si128(m8), _mm256_extracti128_si256(m8, 1));
+		m = _mm_min_epu32(m, _mm_shuffle_epi32(m, _MM_SHUFFLE(1, 0, 3, 2)));
+		m = _mm_min_epu32(m, _mm_shuffle_epi32(m, _MM_SHUFFLE(2, 3, 0, 1)));
+		minSig = (uint32)_mm_cvtsi128_si32(m);
+	}
+
+	for ( ; p <= end_; ++p)
+		minSig = MIN(minSig, sig_[p]);
+
+	return minSig;
+}
+
+#endif
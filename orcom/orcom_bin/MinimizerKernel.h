@@ -0,0 +1,126 @@
+/*
+  This file is a part of ORCOM software distributed under GNU GPL 2 licence.
+  Homepage:	http://sun.aei.polsl.pl/orcom
+  Github:	http://github.com/lrog/orcom
+
+  Authors: Sebastian Deorowicz, Szymon Grabowski and Lucas Roguski
+*/
+
+#ifndef H_MINIMIZERKERNEL
+#define H_MINIMIZERKERNEL
+
+#include "Globals.h"
+
+#include <vector>
+
+#include "DnaRecord.h"
+#include "Params.h"
+
+
+// computes 2-bit encoded signatures of all the windows of a read -- on both strands --
+// and selects the minimal valid ones. The vectorized (SSE4.2 / AVX2) variants are
+// selected at runtime depending on the CPU and give exactly the same results as the
+// scalar rolling one
+//
+class MinimizerKernel
+{
+public:
+	enum InstructionSet
+	{
+		InstrScalar = 0,
+		InstrSse42,
+		InstrAvx2
+	};
+
+	static const uint32 InvalidSignature = (uint32)-1;
+	static const uint32 BufferSize = DnaRecord::MaxDnaLen + 1 + 32;		// including vector padding
+
+	MinimizerKernel(const MinimizerParameters& params_, InstructionSet instrSet_ = DetectInstructionSet());
+
+	static InstructionSet DetectInstructionSet();
+
+	InstructionSet GetInstructionSet() const
+	{
+		return instrSet;
+	}
+
+	// finds the minimal valid signatures of the windows starting at [fwdBeg_, fwdEnd_] on
+	// the forward strand and at [revBeg_, revEnd_] on the reverse-compliment one (positions
+	// are given in forward coordinates), returns InvalidSignature if no valid signature found
+	//
+	void FindMinimumSignatures(const char* dna_, uint32 len_,
+							   int32 fwdBeg_, int32 fwdEnd_, int32 revBeg_, int32 revEnd_,
+							   uint32& minFwd_, uint32& minRev_);
+
+	// computes forward signatures of all the windows in the read, the invalid ones are set
+	// to InvalidSignature -- returns the number of windows
+	//
+	int32 ComputeSignatures(const char* dna_, uint32 len_, uint32* signatures_);
+
+	bool IsSignatureValid(uint32 sig_) const;
+
+	static bool ComputeSignatureValidity(uint32 sig_, uint32 sigLen_);
+
+private:
+	static const uint32 MaxValidityTableSignatureLen = 12;		// 4^12 bits -- 2 MB
+	static const uint32 MaxPowersNum = 5;						// window lengths 1, 2, 4, 8, 16
+
+	const uint32 signatureLen;
+	const uint32 maxSignatureValue;
+	const InstructionSet instrSet;
+
+	static const uint32 SymbolTableSize = 256;
+	static const uchar InvalidSymbolIdx = 4;
+
+	uchar symbolIdxTable[SymbolTableSize];						// any byte other than the 4 bases -- 'N'
+	uchar rcSymbolIdxTable[SymbolTableSize];
+	char baseSymbols[4];										// the symbols of indices 0 - 3
+
+	std::vector<uint64> validSignatureTable;					// bitmap over all 4^signatureLen signatures
+
+	// work buffers for the vectorized variants
+	//
+	uint32 fwdPowers[MaxPowersNum][BufferSize];
+	uint32 revPowers[MaxPowersNum][BufferSize];
+	uint32 fwdSignatures[BufferSize];
+	uint32 revSignatures[BufferSize];
+	int32 nPositions[BufferSize];
+
+	template <bool _TWithRev>
+	void FindMinimumSignaturesScalar(const char* dna_, uint32 len_,
+									 int32 fwdBeg_, int32 fwdEnd_, int32 revBeg_, int32 revEnd_,
+									 uint32& minFwd_, uint32& minRev_);
+	int32 ComputeSignaturesScalar(const char* dna_, uint32 len_, uint32* signatures_);
+
+	void InvalidateNWindows(int32 nCount_, int32 windowsCount_, uint32* fwd_, uint32* rev_);
+
+	uint32 SymbolIdx(char c_) const
+	{
+		return symbolIdxTable[(uchar)c_];
+	}
+
+	uint32 RcSymbolIdx(char c_) const
+	{
+		return rcSymbolIdxTable[(uchar)c_];
+	}
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#	define MINIMIZER_KERNEL_X86 1
+#	define TARGET_SSE42 __attribute__((target("sse4.2")))
+#	define TARGET_AVX2 __attribute__((target("avx2")))
+
+	template <bool _TWithRev>
+	TARGET_SSE42 int32 ComputeSignaturesSse42(const char* dna_, uint32 len_, uint32* fwd_, uint32* rev_);
+
+	template <bool _TWithRev>
+	TARGET_AVX2 int32 ComputeSignaturesAvx2(const char* dna_, uint32 len_, uint32* fwd_, uint32* rev_);
+
+	TARGET_SSE42 static uint32 FindMinimumSse42(const uint32* sig_, int32 beg_, int32 end_);
+	TARGET_AVX2 static uint32 FindMinimumAvx2(const uint32* sig_, int32 beg_, int32 end_);
+#else
+#	define MINIMIZER_KERNEL_X86 0
+#endif
+};
+
+
+#endif // H_MINIMIZERKERNEL
@@ -0,0 +1,323 @@
+/*
+  This file is a part of ORCOM software distributed under GNU GPL 2 licence.
+  Homepage:	http://sun.aei.polsl.pl/orcom
+  Github:	http://github.com/lrog/orcom
+
+  Authors: Sebastian Deorowicz, Szymon Grabowski and Lucas Roguski
+*/
+
+#ifndef H_PACKEDDNA
+#define H_PACKEDDNA
+
+#include "Globals.h"
+
+#include <algorithm>
+
+#include "DnaRecord.h"
+
+
+// 2-bit packed in-memory representation of the records: the symbols are stored MSB-first
+// in 64-bit words ('A' = 0, 'C' = 1, 'G' = 2, 'T' = 3), the record's dna pointer points
+// to the first word. Records containing 'N's (or any other symbols) store them as 'A' and
+// are followed by a bit mask of their positions
+//
+struct PackedDna
+{
+	static const uint32 SymbolsPerWord = 32;
+	static const uint32 MaxRecordWords = (DnaRecord::MaxDnaLen + 31) / 32 + (DnaRecord::MaxDnaLen + 63) / 64;
+	static const uint32 MaxUnpackedLen = (DnaRecord::MaxDnaLen + 31) / 32 * 32;
+
+	static uint32 WordsNum(uint32 len_)
+	{
+		return (len_ + 31) / 32;
+	}
+
+	static uint32 MaskWordsNum(uint32 len_)
+	{
+		return (len_ + 63) / 64;
+	}
+
+	static uint32 RecordWordsNum(const DnaRecord& rec_)
+	{
+		return WordsNum(rec_.len) + (rec_.hasN ? MaskWordsNum(rec_.len) : 0);
+	}
+
+	static const uint64* Words(const DnaRecord& rec_)
+	{
+		return (const uint64*)rec_.dna;
+	}
+
+	static const uint64* NMask(const DnaRecord& rec_)
+	{
+		ASSERT(rec_.hasN);
+		return Words(rec_) + WordsNum(rec_.len);
+	}
+
+	static uint32 Code(const uint64* words_, uint32 i_)
+	{
+		return (words_[i_ / 32] >> (62 - 2 * (i_ % 32))) & 3;
+	}
+
+	static char Symbol(const DnaRecord& rec_, uint32 i_)
+	{
+		ASSERT(i_ < rec_.len);
+
+		if (rec_.hasN && ((NMask(rec_)[i_ / 64] >> (63 - i_ % 64)) & 1))
+			return 'N';
+		return "ACGT"[Code(Words(rec_), i_)];
+	}
+
+	// returns the 32 symbols starting at i_ as a single word, MSB-first -- the symbols past
+	// the end of the record are zeroed
+	//
+	static uint64 SymbolsAt(const DnaRecord& rec_, uint32 i_)
+	{
+		ASSERT(i_ < rec_.len);
+
+		const uint64* words = Words(rec_);
+		const uint32 w = i_ / 32;
+		const uint32 shift = 2 * (i_ % 32);
+
+		uint64 x = words[w] << shift;
+		if (shift != 0 && w + 1 < WordsNum(rec_.len))
+			x |= words[w + 1] >> (64 - shift);
+		return x;
+	}
+
+	// returns the 64 bits of the 'N' mask starting at i_, MSB-first
+	//
+	static uint64 NMaskAt(const DnaRecord& rec_, uint32 i_)
+	{
+		ASSERT(i_ < rec_.len);
+
+		const uint64* mask = NMask(rec_);
+		const uint32 w = i_ / 64;
+		const uint32 shift = i_ % 64;
+
+		uint64 x = mask[w] << shift;
+		if (shift != 0 && w + 1 < MaskWordsNum(rec_.len))
+			x |= mask[w + 1] >> (64 - shift);
+		return x;
+	}
+
+	// compares len_ symbols of both records starting at beg1_ and beg2_, with the same
+	// result sign as memcmp() on the unpacked symbols -- compares 32 symbols at a time,
+	// decoding only the first different symbols
+	//
+	static int32 Compare(const DnaRecord& r1_, uint32 beg1_, const DnaRecord& r2_, uint32 beg2_, uint32 len_)
+	{
+		for (uint32 i = 0; i < len_; i += SymbolsPerWord)
+		{
+			const uint32 n = MIN(len_ - i, SymbolsPerWord);
+			const uint64 symbolsMask = ~0ULL << (64 - 2 * n);
+			const uint64 nMask = ~0ULL << (64 - n);
+
+			uint64 s1 = SymbolsAt(r1_, beg1_ + i) & symbolsMask;
+			uint64 s2 = SymbolsAt(r2_, beg2_ + i) & symbolsMask;
+			uint64 n1 = 0;
+			uint64 n2 = 0;
+
+			// the symbols stored under the 'N's are 'A's or, in the reverse-complimented
+			// records, 'T's -- clear them, so the first difference is either in the symbols
+			// or in the masks
+			//
+			if (r1_.hasN)
+			{
+				n1 = NMaskAt(r1_, beg1_ + i) & nMask;
+				s1 &= ~SpreadBits(n1 >> 32);
+			}
+			if (r2_.hasN)
+			{
+				n2 = NMaskAt(r2_, beg2_ + i) & nMask;
+				s2 &= ~SpreadBits(n2 >> 32);
+			}
+
+			if (s1 == s2 && n1 == n2)
+				continue;
+
+			uint32 p = SymbolsPerWord;
+			if (s1 != s2)
+				p = __builtin_clzll(s1 ^ s2) / 2;
+			if (n1 != n2)
+				p = MIN(p, (uint32)__builtin_clzll(n1 ^ n2));
+
+			return (int32)(uchar)Symbol(r1_, beg1_ + i + p) - (int32)(uchar)Symbol(r2_, beg2_ + i + p);
+		}
+		return 0;
+	}
+
+	// packs the symbols, returns the number of words written
+	//
+	static uint32 Encode(const char* dna_, uint32 len_, uint64* words_, bool& hasN_)
+	{
+		const uint32 wordsNum = WordsNum(len_);
+		uint64* mask = words_ + wordsNum;
+
+		hasN_ = false;
+		for (uint32 w = 0; w < wordsNum; ++w)
+		{
+			const uint32 beg = w * 32;
+			const uint32 end = MIN(beg + 32, len_);
+
+			uint64 word = 0;
+			for (uint32 i = beg; i < end; ++i)
+			{
+				int32 c = SymbolCode(dna_[i]);
+				if (c < 0)
+				{
+					if (!hasN_)
+						std::fill(mask, mask + MaskWordsNum(len_), 0);
+					hasN_ = true;
+					mask[i / 64] |= 1ULL << (63 - i % 64);
+					c = 0;
+				}
+				word = (word << 2) | c;
+			}
+			words_[w] = word << (2 * (beg + 32 - end));
+		}
+
+		return wordsNum + (hasN_ ? MaskWordsNum(len_) : 0);
+	}
+
+	// unpacks the symbols, the output buffer needs to hold at least WordsNum(len) * 32 symbols
+	//
+	static void Decode(const DnaRecord& rec_, char* dna_)
+	{
+		const uint64* words = Words(rec_);
+		for (uint32 w = 0; w < WordsNum(rec_.len); ++w)
+		{
+			uint64 word = words[w];
+			for (uint32 i = 0; i < 32; ++i)
+			{
+				dna_[w * 32 + i] = "ACGT"[word >> 62];
+				word <<= 2;
+			}
+		}
+
+		if (rec_.hasN)
+		{
+			const uint64* mask = NMask(rec_);
+			for (uint32 w = 0; w < MaskWordsNum(rec_.len); ++w)
+			{
+				for (uint64 m = mask[w]; m != 0; m &= m - 1)
+					dna_[w * 64 + 63 - __builtin_ctzll(m)] = 'N';
+			}
+		}
+	}
+
+	// replaces the record with its reverse-compliment, in place
+	//
+	static void ComputeRC(DnaRecord& rec_)
+	{
+		uint64 buf[MaxRecordWords + 1];
+		uint64* words = (uint64*)rec_.dna;
+
+		const uint32 wordsNum = WordsNum(rec_.len);
+		for (uint32 i = 0; i < wordsNum; ++i)
+			buf[i] = ~ReverseSymbols(words[wordsNum - 1 - i]);
+		ShiftLeft(buf, wordsNum, 2 * (wordsNum * 32 - rec_.len), words);
+
+		if (rec_.hasN)
+		{
+			uint64* mask = words + wordsNum;
+			const uint32 maskWordsNum = MaskWordsNum(rec_.len);
+			for (uint32 i = 0; i < maskWordsNum; ++i)
+				buf[i] = ReverseBits(mask[maskWordsNum - 1 - i]);
+			ShiftLeft(buf, maskWordsNum, maskWordsNum * 64 - rec_.len, mask);
+		}
+	}
+
+private:
+	static int32 SymbolCode(char c_)
+	{
+		switch (c_)
+		{
+			case 'A': return 0;
+			case 'C': return 1;
+			case 'G': return 2;
+			case 'T': return 3;
+			default: return -1;
+		}
+	}
+
+	static uint64 ReverseSymbols(uint64 x_)
+	{
+		x_ = ((x_ >> 2) & 0x3333333333333333ULL) | ((x_ & 0x3333333333333333ULL) << 2);
+		x_ = ((x_ >> 4) & 0x0F0F0F0F0F0F0F0FULL) | ((x_ & 0x0F0F0F0F0F0F0F0FULL) << 4);
+		return __builtin_bswap64(x_);
+	}
+
+	static uint64 ReverseBits(uint64 x_)
+	{
+		x_ = ((x_ >> 1) & 0x5555555555555555ULL) | ((x_ & 0x5555555555555555ULL) << 1);
+		return ReverseSymbols(x_);
+	}
+
+	// duplicates every bit of the 32-bit value, making a 2-bit symbol mask of it
+	//
+	static uint64 SpreadBits(uint64 x_)
+	{
+		x_ = (x_ | (x_ << 16)) & 0x0000FFFF0000FFFFULL;
+		x_ = (x_ | (x_ << 8)) & 0x00FF00FF00FF00FFULL;
+		x_ = (x_ | (x_ << 4)) & 0x0F0F0F0F0F0F0F0FULL;
+		x_ = (x_ | (x_ << 2)) & 0x3333333333333333ULL;
+		x_ = (x_ | (x_ << 1)) & 0x5555555555555555ULL;
+		return x_ | (x_ << 1);
+	}
+
+	// shifts the bit string left by shift_ bits clearing the trailing bits
+	//
+	static void ShiftLeft(const uint64* in_, uint32 wordsNum_, uint32 shift_, uint64* out_)
+	{
+		ASSERT(shift_ < 64);
+
+		if (shift_ == 0)
+		{
+			std::copy(in_, in_ + wordsNum_, out_);
+			return;
+		}
+
+		for (uint32 i = 0; i + 1 < wordsNum_; ++i)
+			out_[i] = (in_[i] << shift_) | (in_[i + 1] >> (64 - shift_));
+		out_[wordsNum_ - 1] = in_[wordsNum_ - 1] << shift_;
+	}
+};
+
+
+// DnaRecordComparator for the packed records, working directly on the 2-bit words
+//
+struct PackedDnaRecordComparator
+{
+	PackedDnaRecordComparator(uint32 signatureShift_)
+		:	signatureShift(signatureShift_)
+	{}
+
+	bool operator() (const DnaRecord& r1_, const DnaRecord& r2_) const
+	{
+		const uint32 beg1 = r1_.minimizerPos - signatureShift;
+		const uint32 beg2 = r2_.minimizerPos - signatureShift;
+		const uint32 len1 = r1_.len - beg1;
+		const uint32 len2 = r2_.len - beg2;
+
+		int32 r = PackedDna::Compare(r1_, beg1, r2_, beg2, MIN(len1, len2));
+		if (r != 0)
+			return r < 0;
+		if (len1 != len2)
+			return len1 > len2;
+		if (r1_.minimizerPos != r2_.minimizerPos)
+			return r1_.minimizerPos < r2_.minimizerPos;
+
+		if (r1_.minimizerPos > signatureShift)
+		{
+			r = PackedDna::Compare(r1_, 0, r2_, 0, beg1);
+			if (r != 0)
+				return r < 0;
+		}
+		return r1_.reverse < r2_.reverse;
+	}
+
+	const uint32 signatureShift;
+};
+
+
+#endif // H_PACKEDDNA
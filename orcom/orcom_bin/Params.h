@@ -80,6 +80,7 @@ struct CategorizerParameters
 struct BinModuleConfig
 {
 	static const uint64 DefaultFastqBlockSize = 1 << 28;	// 256 MB
+	static const uint64 MinFastqBlockSize = 1 << 24;		// 16 MB
 
 	uint64 fastqBlockSize;
 	MinimizerParameters minimizer;
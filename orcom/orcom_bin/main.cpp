@@ -58,6 +58,9 @@ void usage()
 	std::cerr << "\t-s<n>\t\t: skip-zone length, default: " << MinimizerParameters::DefaultskipZoneLen << '\n';
 	std::cerr << "\t-b<n>\t\t: FASTQ input buffer size (in MB), default: " << (BinModuleConfig::DefaultFastqBlockSize >> 20) << '\n';
 	std::cerr << "\t-t<n>\t\t: worker threads number, default: " << InputArguments::DefaultThreadNumber << '\n';
+	std::cerr << "\t-j<n>\t\t: bin sorting threads number per worker thread, default: 1\n";
+	std::cerr << "\t-c\t\t: keep the reads 2-bit packed in memory, default: false\n";
+	std::cerr << "\t-M<n>\t\t: memory budget (in GB), lowers the FASTQ buffer size if needed, default: 0 (0 - not limited)\n";
 	std::cerr << "\t-v\t\t: verbose mode, default: false\n";
 
 #if (DEV_TWEAK_MODE)
@@ -76,7 +79,8 @@ int fastq2bin(const InputArguments& args_)
 		BinModule module;
 
 		module.SetModuleConfig(args_.config);
-		module.Fastq2Bin(args_.inputFiles, args_.outputFile, args_.threadsNum, args_.compressedInput, args_.verboseMode);
+		module.Fastq2Bin(args_.inputFiles, args_.outputFile, args_.threadsNum, args_.compressedInput, args_.verboseMode,
+						  args_.sortThreadsNum, args_.packedDna, args_.memoryBudget);
 	}
 	catch (const std::exception& e)
 	{
@@ -135,6 +139,9 @@ bool parse_arguments(int argc_, const char* argv_[], InputArguments& outArgs_)
 			case 'b':	outArgs_.config.fastqBlockSize = (uint64)pval << 20;			break;
 			case 'g':	outArgs_.compressedInput = true;								break;
 			case 't':	outArgs_.threadsNum = pval;										break;
+			case 'j':	outArgs_.sortThreadsNum = pval;									break;
+			case 'c':	outArgs_.packedDna = true;										break;
+			case 'M':	outArgs_.memoryBudget = (uint64)pval << 30;						break;
 			case 'v':	outArgs_.verboseMode = true;									break;
 			case 'f':
 			{
@@ -184,5 +191,11 @@ bool parse_arguments(int argc_, const char* argv_[], InputArguments& outArgs_)
 		return false;
 	}
 
+	if (outArgs_.sortThreadsNum == 0 || outArgs_.sortThreadsNum > 64)
+	{
+		std::cerr << "Error: invalid number of sorting threads specified\n";
+		return false;
+	}
+
 	return true;
 }
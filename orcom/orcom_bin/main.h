@@ -35,6 +35,9 @@ struct InputArguments
 
 	bool compressedInput;
 	uint32 threadsNum;
+	uint32 sortThreadsNum;
+	bool packedDna;
+	uint64 memoryBudget;		// 0 - not limited
 	bool verboseMode;
 
 	std::vector<std::string> inputFiles;
@@ -43,6 +46,9 @@ struct InputArguments
 	InputArguments()
 		:	compressedInput(false)
 		,	threadsNum(DefaultThreadNumber)
+		,	sortThreadsNum(1)
+		,	packedDna(false)
+		,	memoryBudget(0)
 		,	verboseMode(DefaultVerboseMode)
 	{}
 };
@@ -14,8 +14,10 @@ LIBS += -lpthread
 
 SOURCES += main.cpp \
     FileStream.cpp \
+    GzStream.cpp \
     FastqStream.cpp \
     DnaCategorizer.cpp \
+    MinimizerKernel.cpp \
     DnaPacker.cpp \
     DnaParser.cpp \
     BinFile.cpp \
@@ -24,6 +26,7 @@ SOURCES += main.cpp \
 
 HEADERS += \
     FileStream.h \
+    GzStream.h \
     FastqStream.h \
     DataStream.h \
     Globals.h \
@@ -31,6 +34,7 @@ HEADERS += \
     Utils.h \
     BitMemory.h \
     DnaCategorizer.h \
+    MinimizerKernel.h \
     DnaPacker.h \
     DnaParser.h \
     BinFile.h \
@@ -39,11 +43,15 @@ HEADERS += \
     DataPool.h \
     BinOperator.h \
     DnaRecord.h \
+    DnaRecordSorter.h \
+    PackedDna.h \
     Exception.h \
     Collections.h \
     BinBlockData.h \
     DnaBlockData.h \
     Params.h \
     Thread.h \
+    MemoryMonitor.h \
+    LineIndexer.h \
     main.h
 
@@ -0,0 +1,93 @@
+/*
+  This file is a part of ORCOM software distributed under GNU GPL 2 licence.
+  Homepage:	http://sun.aei.polsl.pl/orcom
+  Github:	http://github.com/lrog/orcom
+
+  Authors: Sebastian Deorowicz, Szymon Grabowski and Lucas Roguski
+*/
+
+#include "../orcom_bin/Globals.h"
+
+#include <iostream>
+
+#include "OrcomModule.h"
+
+#include "../orcom_bin/BinModule.h"
+#include "../orcom_bin/BinFile.h"
+#include "../orcom_bin/FileStream.h"
+#include "../orcom_bin/MemoryMonitor.h"
+#include "../orcom_pack/BinFileExtractor.h"
+#include "../orcom_pack/DnarchModule.h"
+
+
+uint64 OrcomModule::DefaultMemoryLimit()
+{
+	const uint64 available = MemoryMonitor::AvailableSize();
+	return (available > 0) ? available / 2 : FallbackMemoryLimit;
+}
+
+
+void OrcomModule::Fastq2Dnarch(const std::vector<std::string> &inFastqFiles_, const std::string &outDnarchFile_,
+							   const CompressorParams &compParams_, uint64 memoryBudget_,
+							   uint32 threadNum_, bool compressedInput_, bool verboseMode_,
+							   uint32 sortThreadNum_, bool packedDna_)
+{
+	const uint64 binMemoryBudget = memoryBudget_ / 2;
+	const uint64 memoryLimit = (memoryBudget_ > 0) ? memoryBudget_ - binMemoryBudget : DefaultMemoryLimit();
+
+	// the dna stream is the larger one -- it gets the most of the memory limit
+	//
+	const uint64 metaMemoryLimit = memoryLimit / 4;
+	SpillStreamWriter* metaStream = new SpillStreamWriter(outDnarchFile_ + ".bmeta.tmp", metaMemoryLimit);
+	SpillStreamWriter* dnaStream = new SpillStreamWriter(outDnarchFile_ + ".bdna.tmp", memoryLimit - metaMemoryLimit);
+	BinFileExtractor* extractor = NULL;
+
+	try
+	{
+		// bin the reads -- every bin gathers the reads from the whole input, hence the
+		// compression can start only when all of them are binned
+		//
+		{
+			BinModule binModule;
+			binModule.SetModuleConfig(config);
+
+			BinFileWriter binFile;
+			binFile.StartCompress(metaStream, dnaStream, config);
+
+			binModule.Fastq2Bin(inFastqFiles_, binFile, threadNum_, compressedInput_, verboseMode_,
+								sortThreadNum_, packedDna_, binMemoryBudget);
+		}
+
+		if (verboseMode_)
+		{
+			std::cout << "Binned meta data: " << metaStream->Size()
+					  << (metaStream->IsSpilled() ? " B (temporary file)\n" : " B (memory)\n");
+			std::cout << "Binned dna data: " << dnaStream->Size()
+					  << (dnaStream->IsSpilled() ? " B (temporary file)\n" : " B (memory)\n");
+			std::cout << std::endl;
+		}
+
+
+		// compress the bins in place
+		//
+		BinModuleConfig binConfig;
+		extractor = new BinFileExtractor(compParams_.minBinSize);
+		extractor->StartDecompress(metaStream->CreateReader(), dnaStream->CreateReader(), binConfig);
+
+		DnarchModule dnarchModule;
+		dnarchModule.Bin2Dnarch(extractor, binConfig, outDnarchFile_, compParams_, threadNum_, verboseMode_);
+	}
+	catch (...)
+	{
+		// remove the temporary files, if any
+		//
+		TFREE(extractor);
+		delete dnaStream;
+		delete metaStream;
+		throw;
+	}
+
+	TFREE(extractor);
+	delete dnaStream;
+	delete metaStream;
+}
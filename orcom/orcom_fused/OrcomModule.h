@@ -0,0 +1,55 @@
+/*
+  This file is a part of ORCOM software distributed under GNU GPL 2 licence.
+  Homepage:	http://sun.aei.polsl.pl/orcom
+  Github:	http://github.com/lrog/orcom
+
+  Authors: Sebastian Deorowicz, Szymon Grabowski and Lucas Roguski
+*/
+
+#ifndef H_ORCOMMODULE
+#define H_ORCOMMODULE
+
+#include "../orcom_bin/Globals.h"
+
+#include <string>
+#include <vector>
+
+#include "../orcom_bin/Params.h"
+#include "../orcom_pack/Params.h"
+
+
+// bins and compresses the reads in a single run -- the binned data is kept in memory
+// and passed straight to the compression stage, being moved to temporary files only
+// when it does not fit within the memory limit. The output is the same as produced
+// by running orcom_bin and orcom_pack in chain
+//
+class OrcomModule
+{
+public:
+	static const uint64 FallbackMemoryLimit = (uint64)1 << 30;
+
+	// the memory limit of the binned data when no budget is given -- half of the memory
+	// available in the system, or the fallback limit where it cannot be read
+	//
+	static uint64 DefaultMemoryLimit();
+
+	// with the memory budget (in bytes, 0 - not limited) given, half of it is left for
+	// the binning stage and half for the binned data, otherwise the binned data is kept
+	// in memory up to the default limit
+	//
+	void Fastq2Dnarch(const std::vector<std::string>& inFastqFiles_, const std::string& outDnarchFile_,
+					  const CompressorParams& compParams_, uint64 memoryBudget_ = 0,
+					  uint32 threadNum_ = 1, bool compressedInput_ = false, bool verboseMode_ = false,
+					  uint32 sortThreadNum_ = 1, bool packedDna_ = false);
+
+	void SetModuleConfig(const BinModuleConfig& config_)
+	{
+		config = config_;
+	}
+
+private:
+	BinModuleConfig config;
+};
+
+
+#endif // H_ORCOMMODULE
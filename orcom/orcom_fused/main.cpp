@@ -0,0 +1,225 @@
+/*
+  This file is a part of ORCOM software distributed under GNU GPL 2 licence.
+  Homepage:	http://sun.aei.polsl.pl/orcom
+  Github:	http://github.com/lrog/orcom
+
+  Authors: Sebastian Deorowicz, Szymon Grabowski and Lucas Roguski
+*/
+
+#include "../orcom_bin/Globals.h"
+
+#include <iostream>
+#include <string.h>
+
+#include "main.h"
+
+#include "../orcom_pack/CompressedBlockData.h"
+#include "../orcom_pack/StreamCodecRegistry.h"
+
+#include "../orcom_bin/Utils.h"
+#include "../orcom_bin/Thread.h"
+
+
+uint32 InputArguments::AvailableCoresNumber = mt::thread::hardware_concurrency();
+uint32 InputArguments::DefaultThreadNumber = MIN(8, InputArguments::AvailableCoresNumber);
+
+
+int main(int argc_, const char* argv_[])
+{
+	if (argc_ < 1 + 3 || argv_[1][0] != 'e')
+	{
+		usage();
+		return -1;
+	}
+
+	InputArguments args;
+	if (!parse_arguments(argc_, argv_, args))
+		return -1;
+
+	return fastq2dnarch(args);
+}
+
+
+void usage()
+{
+	std::cerr << "Overlapping Reads COmpression with Minimizers\n";
+	std::cerr << "orcom - DNA records binning and compression in a single pass\n";
+	std::cerr << "Version: " << APP_VERSION << '\n';
+	std::cerr << "Authors: Sebastian Deorowicz, Szymon Grabowski and Lucas Roguski\n\n";
+
+	std::cerr << "usage:\n\torcom e [options] -i<input_file> -o<output_file>\n";
+	std::cerr << "options:\n";
+
+	std::cerr << "\t-i<file>\t: input file" << '\n';
+	std::cerr << "\t-f\"<f1> <f2> ... <fn>\": input file list" << '\n';
+	std::cerr << "\t-g\t\t: input compressed in .gz format\n";
+	std::cerr << "\t-o<f>\t\t: output files prefix" << '\n';
+
+	std::cerr << "\t-p<n>\t\t: signature length, default: " << MinimizerParameters::DefaultSignatureLen << '\n';
+	std::cerr << "\t-s<n>\t\t: skip-zone length, default: " << MinimizerParameters::DefaultskipZoneLen << '\n';
+	std::cerr << "\t-b<n>\t\t: FASTQ input buffer size (in MB), default: " << (BinModuleConfig::DefaultFastqBlockSize >> 20) << '\n';
+	std::cerr << "\t-j<n>\t\t: bin sorting threads number per worker thread, default: 1\n";
+	std::cerr << "\t-c\t\t: keep the reads 2-bit packed in memory, default: false\n";
+
+	std::cerr << "\t-e<n>\t\t: encode threshold value, default: 0 (0 - auto)\n";
+	std::cerr << "\t-m<n>\t\t: mismatch cost, default: " << CompressorParams::DefaultMismatchCost << '\n';
+	std::cerr << "\t-I<n>\t\t: insert cost, default: " << CompressorParams::DefaultInsertCost << '\n';
+	std::cerr << "\t-l<n>\t\t: max LZ candidates examined per read, default: 0 (0 - all)\n";
+	std::cerr << "\t-x<n>\t\t: split bins larger than n MB into independently compressed segments, default: 0 (0 - disabled)\n";
+	std::cerr << "\t-L<n>\t\t: compression level (1 - fast, 2 - default, 3 - max), presets -l, -C, -H and -T, default: " << DnaCodingParams::DefaultLevel << '\n';
+	std::cerr << "\t-C<n>\t\t: LzId, Shift, Len and Match streams codec (0 - PPMd, 1 - context models, 2 - raw, 3 - LZ), default: " << CompressorParams::DefaultStreamCodec << '\n';
+	std::cerr << "\t-H<n>\t\t: hard reads codec (0 - PPMd, 1 - context models, 2 - raw, 3 - LZ, 4 - 2-bit packing), default: " << CompressorParams::DefaultHardReadsCodec << '\n';
+	std::cerr << "\t-T\t\t: select the streams codecs by trial on the first bins, default: false\n";
+
+	std::cerr << "\t-M<n>\t\t: memory budget (in GB), half of it for the binned data, default: 0 (0 - not limited, "
+			  << "half of the available memory for the binned data)\n";
+	std::cerr << "\t-t<n>\t\t: worker threads number, default: " << InputArguments::DefaultThreadNumber << '\n';
+	std::cerr << "\t-v\t\t: verbose mode, default: false\n";
+}
+
+
+int fastq2dnarch(const InputArguments& args_)
+{
+	try
+	{
+		OrcomModule module;
+
+		module.SetModuleConfig(args_.config);
+		module.Fastq2Dnarch(args_.inputFiles, args_.outputFile, args_.params, args_.memoryBudget,
+							args_.threadsNum, args_.compressedInput, args_.verboseMode,
+							args_.sortThreadsNum, args_.packedDna);
+	}
+	catch (const std::exception& e)
+	{
+		std::cerr << "Error: " << e.what() << std::endl;
+		return -1;
+	}
+
+	return 0;
+}
+
+
+bool parse_arguments(int argc_, const char* argv_[], InputArguments& outArgs_)
+{
+	MinimizerParameters& pars = outArgs_.config.minimizer;
+
+	// the level presets are applied first, the explicit options override them
+	//
+	int level = DnaCodingParams::DefaultLevel;
+	for (int i = 2; i < argc_; ++i)
+	{
+		const char* param = argv_[i];
+		const int len = strlen(param);
+		if (param[0] == '-' && param[1] == 'L')
+			level = (len > 2 && len < 10) ? (int)to_num((const uchar*)param + 2, len - 2) : -1;
+	}
+
+	if (level < (int)DnaCodingParams::FastLevel || level > (int)DnaCodingParams::MaxLevel)
+	{
+		std::cerr << "Error: invalid compression level specified\n";
+		return false;
+	}
+	outArgs_.params.SetLevel(level);
+
+	// parse params
+	//
+	for (int i = 2; i < argc_; ++i)
+	{
+		const char* param = argv_[i];
+		if (param[0] != '-')
+			continue;
+
+		int pval = -1;
+		int len = strlen(param);
+		if (len > 2 && len < 10)
+			pval = to_num((const uchar*)param + 2, len - 2);
+		const char* str = param + 2;
+		const uint32 slen = len - 2;
+
+		switch (param[1])
+		{
+			case 'i':	outArgs_.inputFiles.push_back(std::string(str, str + slen));	break;
+			case 'o':	outArgs_.outputFile.assign(str, str + slen);					break;
+			case 'p':	pars.signatureLen = pval;										break;
+			case 's':	pars.skipZoneLen = pval;										break;
+			case 'b':	outArgs_.config.fastqBlockSize = (uint64)pval << 20;			break;
+			case 'g':	outArgs_.compressedInput = true;								break;
+			case 'j':	outArgs_.sortThreadsNum = pval;									break;
+			case 'c':	outArgs_.packedDna = true;										break;
+
+			case 'e':	outArgs_.params.encodeThresholdValue = pval;					break;
+			case 'm':	outArgs_.params.mismatchCost = pval;							break;
+			case 'I':	outArgs_.params.insertCost = pval;								break;
+			case 'l':	outArgs_.params.lzCandidatesNum = pval;							break;
+			case 'x':	outArgs_.params.splitBinSize = pval;							break;
+			case 'C':	outArgs_.params.streamCodec = pval;								break;
+			case 'H':	outArgs_.params.hardReadsCodec = pval;							break;
+			case 'T':	outArgs_.params.streamCodecsTrial = true;						break;
+
+			case 'M':	outArgs_.memoryBudget = (uint64)pval << 30;						break;
+			case 't':	outArgs_.threadsNum = pval;										break;
+			case 'v':	outArgs_.verboseMode = true;									break;
+			case 'f':
+			{
+				int beg = 2;
+				for (int i = 2; i < len-1; ++i)
+				{
+					if (param[i] == ' ' || param[i] == '\n')
+					{
+						outArgs_.inputFiles.push_back(std::string(param + beg, i - beg));
+						beg = i + 1;
+					}
+				}
+				outArgs_.inputFiles.push_back(std::string(param + beg, len - beg));
+
+				break;
+			}
+		}
+	}
+
+	if (pars.signatureSuffixLen != pars.signatureLen && !DEV_TWEAK_MODE)
+		pars.signatureSuffixLen = pars.signatureLen;
+
+
+	// check params
+	//
+	if (outArgs_.inputFiles.size() == 0)
+	{
+		std::cerr << "Error: no input file(s) specified\n";
+		return false;
+	}
+
+	if (outArgs_.outputFile.length() == 0)
+	{
+		std::cerr << "Error: no output file specified\n";
+		return false;
+	}
+
+	if (outArgs_.threadsNum == 0 || outArgs_.threadsNum > 64)
+	{
+		std::cerr << "Error: invalid number of threads specified\n";
+		return false;
+	}
+
+	if (!StreamCodecRegistry::IsAvailable(outArgs_.params.streamCodec)
+			|| !StreamCodecRegistry::IsApplicable(outArgs_.params.streamCodec, DnaCompressedBin::LzIdBuffer))
+	{
+		std::cerr << "Error: invalid streams codec specified\n";
+		return false;
+	}
+
+	if (!StreamCodecRegistry::IsAvailable(outArgs_.params.hardReadsCodec)
+			|| !StreamCodecRegistry::IsApplicable(outArgs_.params.hardReadsCodec, DnaCompressedBin::HardReadsBuffer))
+	{
+		std::cerr << "Error: invalid hard reads codec specified\n";
+		return false;
+	}
+
+	if (outArgs_.sortThreadsNum == 0 || outArgs_.sortThreadsNum > 64)
+	{
+		std::cerr << "Error: invalid number of sorting threads specified\n";
+		return false;
+	}
+
+	return true;
+}
@@ -0,0 +1,60 @@
+/*
+  This file is a part of ORCOM software distributed under GNU GPL 2 licence.
+  Homepage:	http://sun.aei.polsl.pl/orcom
+  Github:	http://github.com/lrog/orcom
+
+  Authors: Sebastian Deorowicz, Szymon Grabowski and Lucas Roguski
+*/
+
+#ifndef H_MAIN
+#define H_MAIN
+
+#include "../orcom_bin/Globals.h"
+
+#include <string>
+#include <vector>
+
+#include "../orcom_bin/Params.h"
+#include "../orcom_pack/Params.h"
+#include "OrcomModule.h"
+
+
+struct InputArguments
+{
+	static const bool DefaultVerboseMode = false;
+
+	static uint32 AvailableCoresNumber;
+	static uint32 DefaultThreadNumber;
+
+	BinModuleConfig config;
+	CompressorParams params;
+
+	bool compressedInput;
+	uint32 threadsNum;
+	uint32 sortThreadsNum;
+	bool packedDna;
+	uint64 memoryBudget;		// 0 - not limited
+	bool verboseMode;
+
+	std::vector<std::string> inputFiles;
+	std::string outputFile;
+
+	InputArguments()
+		:	compressedInput(false)
+		,	threadsNum(DefaultThreadNumber)
+		,	sortThreadsNum(1)
+		,	packedDna(false)
+		,	memoryBudget(0)
+		,	verboseMode(DefaultVerboseMode)
+	{}
+};
+
+
+void usage();
+int fastq2dnarch(const InputArguments& args_);
+bool parse_arguments(int argc_, const char* argv_[], InputArguments& outArgs_);
+
+int main(int argc_, const char* argv_[]);
+
+
+#endif // H_MAIN
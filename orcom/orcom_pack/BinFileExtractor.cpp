@@ -16,13 +16,16 @@ struct BlockDescriptorComparator
 {
 	bool operator() (const BinFileExtractor::BlockDescriptor& b1_, const BinFileExtractor::BlockDescriptor& b2_)
 	{
-		return b1_.rawDnaSize > b2_.rawDnaSize;
+		return b1_.rawDnaSize > b2_.rawDnaSize
+				|| (b1_.rawDnaSize == b2_.rawDnaSize && b1_.signature < b2_.signature);
 	}
 };
 
 
 BinFileExtractor::BinFileExtractor(uint32 minBinSize_)
 	:	minBinSize(minBinSize_)
+	,	metaMemory(NULL)
+	,	dnaMemory(NULL)
 	,	currentSmallBlockIdx(0)
 	,	currentStdBlockIdx(0)
 	,	stdBlockCount(0)
@@ -34,9 +37,53 @@ void BinFileExtractor::StartDecompress(const std::string &fileName_, BinModuleCo
 	ASSERT(metaStream == NULL);
 	ASSERT(dnaStream == NULL);
 
-	metaStream = new FileStreamReader(fileName_ + ".bmeta");
-	dnaStream = new FileStreamReader(fileName_ + ".bdna");
+	// map the files into memory, so the bins' sub-blocks can be handed out in place without
+	// seeking and copying -- fall back to reading them if mapping fails
+	//
+	try
+	{
+		metaMemory = new MemoryStreamReader(fileName_ + ".bmeta");
+		dnaMemory = new MemoryStreamReader(fileName_ + ".bdna");
+	}
+	catch (const Exception&)
+	{
+		TFREE(metaMemory);
+		TFREE(dnaMemory);
+	}
+
+	if (metaMemory != NULL)
+	{
+		metaStream = metaMemory;
+		dnaStream = dnaMemory;
+	}
+	else
+	{
+		metaStream = new FileStreamReader(fileName_ + ".bmeta");
+		dnaStream = new FileStreamReader(fileName_ + ".bdna");
+	}
+
+	ReadBlockDescriptors(params_);
+}
 
+
+void BinFileExtractor::StartDecompress(MemoryStreamReader* metaMemory_, MemoryStreamReader* dnaMemory_, BinModuleConfig& params_)
+{
+	ASSERT(metaStream == NULL);
+	ASSERT(dnaStream == NULL);
+	ASSERT(metaMemory_ != NULL);
+	ASSERT(dnaMemory_ != NULL);
+
+	metaMemory = metaMemory_;
+	dnaMemory = dnaMemory_;
+	metaStream = metaMemory;
+	dnaStream = dnaMemory;
+
+	ReadBlockDescriptors(params_);
+}
+
+
+void BinFileExtractor::ReadBlockDescriptors(BinModuleConfig& params_)
+{
 	if (metaStream->Size() == 0)
 		throw Exception("Empty file.");
 
@@ -51,6 +98,8 @@ void BinFileExtractor::StartDecompress(const std::string &fileName_, BinModuleCo
 		delete dnaStream;
 		metaStream = NULL;
 		dnaStream = NULL;
+		metaMemory = NULL;
+		dnaMemory = NULL;
 		throw Exception("Corrupted archive header");
 	}
 
@@ -83,8 +132,6 @@ void BinFileExtractor::StartDecompress(const std::string &fileName_, BinModuleCo
 
 	// read block descriptors
 	//
-	uint64 rawDnaStreamSize = 0;
-
 	for (uint64 i = 0; i < fileFooter.metaBinSizes.size(); ++i)
 	{
 		const uint64 metaSize = fileFooter.metaBinSizes[i];
@@ -123,8 +170,6 @@ void BinFileExtractor::StartDecompress(const std::string &fileName_, BinModuleCo
 		fileMetaPos += subDesc.metaSize;
 		fileDnaPos += subDesc.dnaSize;
 
-		rawDnaStreamSize += subDesc.rawDnaSize;
-
 		currentNonEmptyBlockId++;
 	}
 
@@ -140,25 +185,25 @@ void BinFileExtractor::StartDecompress(const std::string &fileName_, BinModuleCo
 	}
 
 
-	// sort descriptors by size
+	// the meta data is small and accessed all over the file, while the dna data is accessed
+	// bin by bin -- each bin's larger sub-blocks are prefetched when extracted
 	//
-	std::sort(blockDescriptors.begin(), blockDescriptors.end(), BlockDescriptorComparator());
+	if (metaMemory != NULL)
+	{
+		metaMemory->Advise(MemoryStreamReader::AdviceWillNeed);
+		dnaMemory->Advise(MemoryStreamReader::AdviceRandom);
+	}
 
 
-	// partition
+	// sort descriptors by size -- the std bins are handed out largest-first, so that the
+	// biggest ones do not end up being compressed last while the other threads are idle
 	//
-	const uint64 dnaThresholdSize = rawDnaStreamSize * 0.8;
-	uint64 dnaCulmSize = 0;
-	uint64 validBins = 0;
-	for ( ; validBins < blockDescriptors.size() && dnaCulmSize < dnaThresholdSize; validBins++)
-	{
-		ASSERT(blockDescriptors[validBins].recordsCount >= minBinSize);
-		dnaCulmSize += blockDescriptors[validBins].rawDnaSize;
-	}
+	std::sort(blockDescriptors.begin(), blockDescriptors.end(), BlockDescriptorComparator());
 
-	std::random_shuffle(blockDescriptors.begin(), blockDescriptors.begin() + validBins);
 
-	for (currentSmallBlockIdx = validBins; currentSmallBlockIdx < blockDescriptors.size(); currentSmallBlockIdx++)
+	// partition
+	//
+	for (currentSmallBlockIdx = 0; currentSmallBlockIdx < blockDescriptors.size(); currentSmallBlockIdx++)
 	{
 		if (blockDescriptors[currentSmallBlockIdx].recordsCount < minBinSize || blockDescriptors[currentSmallBlockIdx].recordsCount == 0)
 			break;
@@ -168,7 +213,7 @@ void BinFileExtractor::StartDecompress(const std::string &fileName_, BinModuleCo
 
 	// remove the empty descriptors
 	//
-	for (validBins = currentSmallBlockIdx; validBins < blockDescriptors.size(); validBins++)
+	for (uint64 validBins = currentSmallBlockIdx; validBins < blockDescriptors.size(); validBins++)
 	{
 		if (blockDescriptors[validBins].recordsCount == 0)
 		{
@@ -179,6 +224,15 @@ void BinFileExtractor::StartDecompress(const std::string &fileName_, BinModuleCo
 }
 
 
+void BinFileExtractor::FinishDecompress()
+{
+	BinFileReader::FinishDecompress();
+
+	metaMemory = NULL;
+	dnaMemory = NULL;
+}
+
+
 bool BinFileExtractor::ExtractNextStdBin(BinaryBinBlock &bin_, uint32 &minimizerId_)
 {
 	bin_.Reset();
@@ -241,6 +295,32 @@ void BinFileExtractor::ExtractNextBin(const BlockDescriptor &desc_, BinaryBinBlo
 {
 	ASSERT(desc_.recordsCount > 0);
 
+	if (metaMemory != NULL)
+	{
+		const byte* metaMemPtr = metaMemory->MemoryBuffer()->Pointer();
+		const byte* dnaMemPtr = dnaMemory->MemoryBuffer()->Pointer();
+
+		for (uint64 i = 0; i < desc_.subBlocks.size(); ++i)
+		{
+			const SubBlockDescriptor& subBlock = desc_.subBlocks[i];
+			ASSERT(subBlock.metaPosition != 0);
+			ASSERT(subBlock.metaSize != 0);
+
+			if (subBlock.dnaSize >= MinPrefetchSize)
+				dnaMemory->Advise(MemoryStreamReader::AdviceWillNeed, subBlock.dnaPosition, subBlock.dnaSize);
+
+			bin_.metaSpans.push_back(metaMemPtr + subBlock.metaPosition);
+			bin_.dnaSpans.push_back(dnaMemPtr + subBlock.dnaPosition);
+
+			bin_.metaSize += subBlock.metaSize;
+			bin_.dnaSize += subBlock.dnaSize;
+			bin_.rawDnaSize += subBlock.rawDnaSize;
+
+			bin_.descriptors.push_back(subBlock);
+		}
+		return;
+	}
+
 	if (bin_.metaData.Size() < desc_.metaSize)
 		bin_.metaData.Extend(desc_.metaSize);
 
@@ -12,6 +12,7 @@
 #include "../orcom_bin/Globals.h"
 #include "../orcom_bin/BinBlockData.h"
 #include "../orcom_bin/BinFile.h"
+#include "../orcom_bin/FileStream.h"
 
 
 class BinFileExtractor : public BinFileReader
@@ -39,12 +40,18 @@ public:
 	};
 
 	static const uint32 DefaultMinimumBinSize = 64;
+	static const uint32 MinPrefetchSize = 1 << 16;
 
 
 	BinFileExtractor(uint32 minBinSize_ = DefaultMinimumBinSize);
 
 	void StartDecompress(const std::string& fileName_, BinModuleConfig& params_);
 
+	// extracts the bins from the memory streams, taking their ownership
+	//
+	void StartDecompress(MemoryStreamReader* metaMemory_, MemoryStreamReader* dnaMemory_, BinModuleConfig& params_);
+	void FinishDecompress();
+
 	bool ExtractNextSmallBin(BinaryBinBlock& bin_, uint32& minimizerId_);
 	bool ExtractNextStdBin(BinaryBinBlock& bin_, uint32& minimizerId_);
 	bool ExtractNBin(BinaryBinBlock& bin_, uint32& minimizerId_);
@@ -95,6 +102,12 @@ private:
 
 	const uint32 minBinSize;
 
+	// the memory-mapped input files (aliasing the base streams), NULL if mapping was not
+	// possible -- then the bins' data is read into the bin buffers
+	//
+	MemoryStreamReader* metaMemory;
+	MemoryStreamReader* dnaMemory;
+
 	uint64 currentSmallBlockIdx;
 	uint64 currentStdBlockIdx;
 	uint64 stdBlockCount;
@@ -102,6 +115,7 @@ private:
 	std::vector<BlockDescriptor> blockDescriptors;
 	BlockDescriptor nBlockDescriptor;
 
+	void ReadBlockDescriptors(BinModuleConfig& params_);
 	void ExtractNextBin(const BlockDescriptor& desc_, BinaryBinBlock &bin_);
 };
 
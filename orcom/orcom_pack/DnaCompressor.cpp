@@ -14,12 +14,93 @@
 #include "CompressedBlockData.h"
 
 #include "../orcom_bin/DnaPacker.h"
+#include "../orcom_bin/DnaRecordSorter.h"
+#include "../orcom_bin/Exception.h"
 #include "../rle/rle.h"
 #include "../ppmd/PPMd.h"
 
 
-DnaStoreBase::DnaStoreBase(const MinimizerParameters &minParams_)
+bool DnaStreamModels::IsTrainingComplete() const
+{
+	if (trainingBinsNum >= MaxTrainingBinsNum)
+		return true;
+
+	for (uint32 i = 0; i < StreamsNum; ++i)
+	{
+		if (trainingData[i].size() < trainingSize)
+			return false;
+	}
+	return true;
+}
+
+
+void DnaStreamModels::Train(uint32 order_, uint32 memorySizeMb_)
+{
+	ASSERT(!trained);
+
+	for (uint32 i = 0; i < StreamsNum; ++i)
+	{
+		if (trainingData[i].size() == 0)
+			continue;
+
+		bool r = models[i].Train(&trainingData[i][0], trainingData[i].size(), order_, memorySizeMb_);
+		ASSERT(r);
+		(void)r;
+
+		byteModels[i].Clear();
+		for (uint64 j = 0; j < trainingData[i].size(); ++j)
+			byteModels[i].Update(trainingData[i][j]);
+
+		std::vector<byte>().swap(trainingData[i]);
+	}
+	trained = true;
+}
+
+
+void DnaStreamModels::SelectCodecs(const CompressorParams& params_, PpmdEncoder* ppmd_)
+{
+	ASSERT(!trained);
+
+	std::vector<byte> out;
+	for (uint32 i = 0; i < StreamsNum; ++i)
+	{
+		const uint32 bufferId = DnaCompressedBin::PPMdStartBuffer + i;
+
+		codecs[i] = (bufferId == DnaCompressedBin::HardReadsBuffer) ? params_.hardReadsCodec : params_.streamCodec;
+		if (trainingData[i].size() == 0)
+			continue;
+
+		// the ties are resolved in favour of the codec of the parameters
+		//
+		const uint32 paramsCodec = codecs[i];
+		const uint64 inSize = trainingData[i].size();
+		out.resize(inSize);
+
+		uint64 bestSize = inSize + 1;
+		for (uint32 codec = 0; codec < CompressorParams::StreamCodecsNum; ++codec)
+		{
+			if (!StreamCodecRegistry::IsAvailable(codec) || !StreamCodecRegistry::IsApplicable(codec, bufferId))
+				continue;
+
+			uint64 outSize = inSize;
+			if (!StreamCodecRegistry::Encode(codec, &trainingData[i][0], inSize, &out[0], outSize, ppmd_))
+				continue;
+
+			if (outSize < bestSize || (outSize == bestSize && codec == paramsCodec))
+			{
+				bestSize = outSize;
+				codecs[i] = codec;
+			}
+		}
+	}
+	codecsSelected = true;
+}
+
+
+DnaStoreBase::DnaStoreBase(const MinimizerParameters &minParams_, const DnaCodingParams& codingParams_)
 	:	minParams(minParams_)
+	,	codingParams(codingParams_)
+	,	streamModels(NULL)
 {
 	std::fill(currentMinimizerBuf, currentMinimizerBuf + MaxSignatureLen, 0);
 
@@ -63,87 +144,198 @@ void DnaStoreBase::PrepareLzBuffer(uint32 size_)
 }
 
 
-DnaCompressorBase::MatchResult DnaCompressorBase::FindBestLzMatch(const DnaRecord &rec_, int32 recMinPos_)
+DnaCompressorBase::MatchResult DnaCompressorBase::FindBestLzMatch(const DnaRecord &rec_, int32 recMinPos_, uint32 recKey_)
 {
-#define ONLY_POS(x)	((x) > 0 ? (x) : 0)
-
 	MatchResult result;
 	result.cost = compParams.maxCostValue;
 
+	// when limited, examine the most recent matches and only those of the older ones sharing
+	// (up to a single mismatch) the symbols following the signature, falling back to the full
+	// scan when none of them matches -- the scan skips the matches already examined, none of
+	// them can match when tested again
+	//
+	uint32 filteredEnd = 0;
+	if (compParams.lzCandidatesNum > 0 && recKey_ != LzMatch::InvalidKey)
+	{
+		uint32 candidatesNum = 0;
+		for ( ; filteredEnd < prevBuffer.size() && candidatesNum < compParams.lzCandidatesNum; ++filteredEnd)
+		{
+			if (!IsLzCandidate(filteredEnd, recKey_))
+				continue;
+
+			TestLzMatch(rec_, recMinPos_, filteredEnd, result);
+			candidatesNum++;
+		}
+
+		if (result.cost < compParams.maxCostValue)
+			return result;
+	}
+
 	for (uint32 i = 0; i < prevBuffer.size(); ++i)
 	{
-		const LzMatch& lz = *prevBuffer[i];
+		if (i < filteredEnd && IsLzCandidate(i, recKey_))
+			continue;
+
+		TestLzMatch(rec_, recMinPos_, i, result);
+	}
+
+	return result;
+}
+
+
+void DnaCompressorBase::TestLzMatch(const DnaRecord& rec_, int32 recMinPos_, uint32 lzId_, MatchResult& result_)
+{
+#define ONLY_POS(x)	((x) > 0 ? (x) : 0)
 
-		// compare
-		int32 shift = lz.minPos - recMinPos_;
+	const LzMatch& lz = *prevBuffer[lzId_];
+
+	// compare
+	int32 shift = lz.minPos - recMinPos_;
 #if EXP_USE_RC_ADV
-		if (ABS(shift) >= lz.seqLen - (rec_.reverse ? 0 : minParams.skipZoneLen) || ABS(shift) > MaxShiftValue)
-			continue;
+	if (ABS(shift) >= lz.seqLen - (rec_.reverse ? 0 : minParams.skipZoneLen) || ABS(shift) > MaxShiftValue)
+		return;
 #else
-		if (ABS(shift) >= lz.seqLen || ABS(shift) > MaxShiftValue)
-			continue;
+	if (ABS(shift) >= lz.seqLen || ABS(shift) > MaxShiftValue)
+		return;
 #endif
 
-		if (shift >= 0)
+	if (shift >= 0)
+	{
+		int32 insertCost = ONLY_POS(rec_.len - (lz.seqLen - shift)) * compParams.insertCost;
+		int32 r = CalculateMismatchesCost(lz.seq + shift,
+										  lz.seqLen - shift,
+										  rec_.dna,
+										  rec_.len,							// TODO:
+										  result_.cost - insertCost);		// here we can use s1+k+MIN_LEN and s2+MIN_LEN
+		bool noMismatches = (r == 0);										// to skip comparison of equal minimizer strings
+		r += insertCost;
+
+		if (r < result_.cost)
 		{
-			int32 insertCost = ONLY_POS(rec_.len - (lz.seqLen - shift)) * compParams.insertCost;
-			int32 r = CalculateMismatchesCost(lz.seq + shift,
-											  lz.seqLen - shift,
-											  rec_.dna,
-											  rec_.len,						// TODO:
-											  result.cost - insertCost);		// here we can use s1+k+MIN_LEN and s2+MIN_LEN
-			bool noMismatches = (r == 0);									// to skip comparison of equal minimizer strings
-			r += insertCost;
-
-			if (r < result.cost)
-			{
-				result.prevId = i;
-				result.cost = r;
-				result.shift = shift;
-				result.noMismatches = noMismatches;
-			}
+			result_.prevId = lzId_;
+			result_.cost = r;
+			result_.shift = shift;
+			result_.noMismatches = noMismatches;
 		}
-		else
+	}
+	else
+	{
+		shift = -shift;
+
+		int32 insertCost = shift + ONLY_POS(rec_.len - shift - lz.seqLen) * compParams.insertCost;
+		int32 r = CalculateMismatchesCost(lz.seq,
+										  lz.seqLen,
+										  rec_.dna + shift,
+										  rec_.len - shift,
+										  result_.cost - insertCost);
+		bool noMismatches = (r == 0);
+		r += insertCost;
+		if (r < result_.cost)
 		{
-			shift = -shift;
-
-			int32 insertCost = shift + ONLY_POS(rec_.len - shift - lz.seqLen) * compParams.insertCost;
-			int32 r = CalculateMismatchesCost(lz.seq,
-											  lz.seqLen,
-											  rec_.dna + shift,
-											  rec_.len - shift,
-											  result.cost - insertCost);
-			bool noMismatches = (r == 0);
-			r += insertCost;
-			if (r < result.cost)
-			{
-				result.prevId = i;
-				result.cost = r;
-				result.shift = -shift;
-				result.noMismatches = noMismatches;
-			}
+			result_.prevId = lzId_;
+			result_.cost = r;
+			result_.shift = -shift;
+			result_.noMismatches = noMismatches;
 		}
 	}
 
-	return result;
-
 #undef ONLY_POS
 }
 
 
-int32 DnaCompressorBase::CalculateMismatchesCost(const char* seq1_, uint32 len1_, const char* seq2_, uint32 len2_, int32 bestValue_)
+uint32 DnaCompressorBase::LzMatchKey(const DnaRecord& rec_, int32 recMinPos_) const
 {
-	uint32 minLen = MIN(len1_, len2_);
-	int32 v = 0;
+	const uint32 pos = recMinPos_ + minParams.signatureSuffixLen;
+	if (pos + LzKeySymbols > rec_.len)
+		return LzMatch::InvalidKey;
 
-	for (uint32 i = 0; i < minLen && v < bestValue_; ++i)
+	uint32 key = 0;
+	for (uint32 i = pos; i < pos + LzKeySymbols; ++i)
 	{
-		v += (seq1_[i] != seq2_[i]);
+		const int32 c = dnaToIdx[(int32)rec_.dna[i]];
+		if (c > 3)
+			return LzMatch::InvalidKey;
+		key = (key << 2) | c;
 	}
+	return key;
+}
+
+
+int32 DnaCompressorBase::CalculateMismatchesCost(const char* seq1_, uint32 len1_, const char* seq2_, uint32 len2_, int32 bestValue_)
+{
+	const uint32 minLen = MIN(len1_, len2_);
+	const int32 v = mismatchKernel.CountMismatches(seq1_, seq2_, minLen, bestValue_);
 	return v * compParams.mismatchCost;
 }
 
 
+void DnaBinSplitter::Split(const DnaBin& dnaBin_, uint32 segmentsNum_, DnaBinCollection& segmentBins_, std::vector<uint64>& segmentSizes_)
+{
+	ASSERT(segmentsNum_ > 0);
+
+	// the records are assigned to the segments by the symbols following the signature, so
+	// every segment covers a contiguous range of the bin's sort order -- the split points
+	// balance the segments' dna size
+	//
+	std::fill(keySizes.begin(), keySizes.end(), 0);
+	recordKeys.resize(dnaBin_.Size());
+
+	uint64 totalSize = 0;
+	for (uint64 i = 0; i < dnaBin_.Size(); ++i)
+	{
+		const DnaRecord& r = dnaBin_[i];
+		recordKeys[i] = SegmentKey(r);
+		keySizes[recordKeys[i]] += r.len;
+		totalSize += r.len;
+	}
+
+	uint64 culmSize = 0;
+	for (uint32 k = 0; k < SegmentKeysNum; ++k)
+	{
+		keySegments[k] = culmSize * segmentsNum_ / totalSize;
+		culmSize += keySizes[k];
+	}
+
+	segmentBins_.Resize(segmentsNum_);
+	segmentSizes_.assign(segmentsNum_, 0);
+	for (uint32 i = 0; i < segmentsNum_; ++i)
+		segmentBins_[i].Clear();
+
+	for (uint64 i = 0; i < dnaBin_.Size(); ++i)
+	{
+		const DnaRecord& r = dnaBin_[i];
+		const uint32 s = keySegments[recordKeys[i]];
+		segmentBins_[s].Insert(r);
+		segmentSizes_[s] += r.len;
+	}
+}
+
+
+uint32 DnaBinSplitter::SegmentKey(const DnaRecord& rec_) const
+{
+	// 'N' shares the rank with 'G' to keep the records' lexicographic order
+	//
+	uint32 key = 0;
+	const uint32 pos = rec_.minimizerPos + signatureLen;
+	for (uint32 i = pos; i < pos + SegmentKeySymbols; ++i)
+	{
+		uint32 rank = 0;
+		if (i < rec_.len)
+		{
+			switch (rec_.dna[i])
+			{
+				case 'C':	rank = 1;	break;
+				case 'G':
+				case 'N':	rank = 2;	break;
+				case 'T':	rank = 3;	break;
+			}
+		}
+		key = (key << 2) | rank;
+	}
+	return key;
+}
+
+
 DnaCompressor::DnaCompressor(const MinimizerParameters &minParams_, const CompressorParams &compParams_)
 	:	DnaCompressorBase(minParams_, compParams_)
 	,	rleEncoder(NULL)
@@ -152,10 +344,16 @@ DnaCompressor::DnaCompressor(const MinimizerParameters &minParams_, const Compre
 	,	lettersCoder(NULL)
 	,	ppmdEncoder(NULL)
 {
+	std::fill(streamEncoders, streamEncoders + DnaCompressedBin::BuffersNum, (StreamByteEncoder*)NULL);
+	std::fill(byteCoders, byteCoders + DnaCompressedBin::BuffersNum, (ByteContextCoder*)NULL);
+
+	for (uint32 i = DnaCompressedBin::PPMdStartBuffer; i <= DnaCompressedBin::PPMdEndBuffer; ++i)
+		byteCoders[i] = new ByteContextCoder();
+
 	// TODO: refactor -- we can initialize all writers and encoders in ctor
 	//
 	ppmdEncoder = new PpmdEncoder();
-	ppmdEncoder->StartCompress(PpmdOrder, PpmdMemorySizeMb);
+	ppmdEncoder->StartCompress(codingParams.ppmdOrder, codingParams.ppmdMemorySizeMb);
 }
 
 
@@ -165,6 +363,9 @@ DnaCompressor::~DnaCompressor()
 
 	ppmdEncoder->FinishCompress();
 	delete ppmdEncoder;
+
+	for (uint32 i = 0; i < DnaCompressedBin::BuffersNum; ++i)
+		TFree(byteCoders[i]);
 }
 
 
@@ -181,7 +382,15 @@ void DnaCompressor::PrepareWriters(DnaCompressedBin& dnaWorkBin_)
 	flagCoder = new FlagEncoder(*writers[DnaCompressedBin::FlagBuffer]);
 	revCoder = new RevEncoder(*writers[DnaCompressedBin::RevBuffer]);
 	lettersCoder = new LettersEncoder(*writers[DnaCompressedBin::LetterXBuffer]);
-	rleEncoder = new BinaryRleEncoder(*writers[DnaCompressedBin::MatchBuffer]);
+
+	flagCoder->coder.SetOrder(codingParams.contextOrder);
+	revCoder->coder.SetOrder(codingParams.contextOrder);
+	lettersCoder->coder.SetOrder(codingParams.contextOrder);
+
+	for (uint32 i = DnaCompressedBin::PPMdStartBuffer; i <= DnaCompressedBin::PPMdEndBuffer; ++i)
+		streamEncoders[i] = new StreamByteEncoder(*writers[i], byteCoders[i], i);
+
+	rleEncoder = new MatchRleEncoder(*streamEncoders[DnaCompressedBin::MatchBuffer]);
 }
 
 
@@ -192,6 +401,9 @@ void DnaCompressor::CleanupWriters()
 	TFree(flagCoder);
 	TFree(rleEncoder);
 
+	for (uint32 i = DnaCompressedBin::PPMdStartBuffer; i <= DnaCompressedBin::PPMdEndBuffer; ++i)
+		TFree(streamEncoders[i]);
+
 	for (uint32 i = 0; i < writers.size(); ++i)
 		delete writers[i];
 
@@ -227,14 +439,28 @@ void DnaCompressor::CompressDna(DnaBin &dnaBin_, uint32 minimizerId_, uint64 raw
 }
 
 
+// the codecs selected on the training bins are used once the models are trained, the
+// training blocks are coded with the codecs of the parameters
+//
+uint32 DnaCompressor::StreamCodec(uint32 bufferId_) const
+{
+	ASSERT(bufferId_ >= DnaCompressedBin::PPMdStartBuffer && bufferId_ <= DnaCompressedBin::PPMdEndBuffer);
+
+	if (streamModels != NULL && streamModels->IsTrained() && streamModels->HasSelectedCodecs())
+		return streamModels->GetSelectedCodec(bufferId_);
+
+	return (bufferId_ == DnaCompressedBin::HardReadsBuffer) ? compParams.hardReadsCodec : compParams.streamCodec;
+}
+
+
 void DnaCompressor::CompressDnaFull(DnaBin &dnaBin_, DnaCompressedBin& dnaWorkBin_, CompressedDnaBlock &compBin_)
 {
 	// sort records for better lz matching
 	//
-	DnaRecordComparator comparator(minParams.signatureLen - minParams.signatureSuffixLen);
-	std::sort(dnaBin_.Begin(), dnaBin_.End(), comparator);
+	DnaRecordSorter sorter(minParams.signatureLen - minParams.signatureSuffixLen);
+	sorter.Sort(dnaBin_.Begin(), dnaBin_.End());
 
-	PrepareLzBuffer(LzBufferSize);
+	PrepareLzBuffer(codingParams.lzBufferSize);
 
 
 	// select appropriate scheme
@@ -247,6 +473,12 @@ void DnaCompressor::CompressDnaFull(DnaBin &dnaBin_, DnaCompressedBin& dnaWorkBi
 	//
 	PrepareWriters(dnaWorkBin_);
 
+	for (uint32 i = DnaCompressedBin::PPMdStartBuffer; i <= DnaCompressedBin::PPMdEndBuffer; ++i)
+	{
+		blockDesc.header.streamCodecs[i] = StreamCodec(i);
+		streamEncoders[i]->Start(StreamCodecRegistry::IsOnTheFly(blockDesc.header.streamCodecs[i]), streamModels);
+	}
+
 	rleEncoder->Start();
 	flagCoder->Start();
 	revCoder->Start();
@@ -262,6 +494,9 @@ void DnaCompressor::CompressDnaFull(DnaBin &dnaBin_, DnaCompressedBin& dnaWorkBi
 	revCoder->End();
 	lettersCoder->End();
 
+	for (uint32 i = DnaCompressedBin::PPMdStartBuffer; i <= DnaCompressedBin::PPMdEndBuffer; ++i)
+		streamEncoders[i]->End();
+
 
 	// flush remaining data
 	//
@@ -282,6 +517,9 @@ void DnaCompressor::CompressDnaFull(DnaBin &dnaBin_, DnaCompressedBin& dnaWorkBi
 			blockDesc.header.workBufferSizes[i] = dnaWorkBin_.buffers[i]->size;
 		}
 
+		for (uint32 i = DnaCompressedBin::PPMdStartBuffer; i <= DnaCompressedBin::PPMdEndBuffer; ++i)
+			blockDesc.header.workBufferSizes[i] = streamEncoders[i]->SymbolsNum();
+
 		// usually the output data is compressed to 1/3-1/4 of the input data, but we want to keep the margin
 		uint64 preallocSize = rawOutSize;
 
@@ -327,7 +565,8 @@ void DnaCompressor::CompressDnaFull(DnaBin &dnaBin_, DnaCompressedBin& dnaWorkBi
 			}
 		}
 
-		// PPMd encoding start
+		// the byte streams encoding start, the range-coded streams are just copied and the
+		// streams not fitting in their raw size are stored raw
 		//
 		for (uint32 i = DnaCompressedBin::PPMdStartBuffer; i <= DnaCompressedBin::PPMdEndBuffer; ++i)
 		{
@@ -345,11 +584,19 @@ void DnaCompressor::CompressDnaFull(DnaBin &dnaBin_, DnaCompressedBin& dnaWorkBi
 				}
 
 				byte* outMem = outMemBegin + outMemPos;
-				unsigned long int outSize = compBin_.dataBuffer.data.Size() - outMemPos;
-
-				bool r = ppmdEncoder->EncodeNextMember(inMem, inSize, outMem, outSize);
+				uint64 outSize = inSize;
 
-				ASSERT(r);
+				if (StreamCodecRegistry::IsOnTheFly(blockDesc.header.streamCodecs[i]))
+				{
+					std::copy(inMem, inMem + inSize, outMem);
+				}
+				else if (!StreamCodecRegistry::Encode(blockDesc.header.streamCodecs[i], inMem, inSize, outMem, outSize,
+													  ppmdEncoder, GetStreamModel(i)))
+				{
+					blockDesc.header.streamCodecs[i] = CompressorParams::RawStreamCodec;
+					std::copy(inMem, inMem + inSize, outMem);
+					outSize = inSize;
+				}
 				ASSERT(outSize > 0);
 
 				outMemPos += outSize;
@@ -362,7 +609,7 @@ void DnaCompressor::CompressDnaFull(DnaBin &dnaBin_, DnaCompressedBin& dnaWorkBi
 			}
 		}
 		//
-		// PPMd end
+		// byte streams end
 
 
 		// write header
@@ -386,6 +633,11 @@ void DnaCompressor::CompressDnaFull(DnaBin &dnaBin_, DnaCompressedBin& dnaWorkBi
 			compBin_.bufferSizes[i] = blockDesc.header.compBufferSizes[i];	// only for debug purposes
 		}
 
+		blockWriter.PutByte(DnaBlockHeader::FormatVersion);
+		for (uint32 i = 0; i < DnaCompressedBin::BuffersNum; ++i)
+			blockWriter.PutByte(blockDesc.header.streamCodecs[i]);
+		ASSERT(blockWriter.Position() == DnaBlockHeader::Size);
+
 		compBin_.dataBuffer.size = outMemPos;
 	}
 
@@ -400,8 +652,8 @@ void DnaCompressor::CompressDnaRaw(DnaBin &dnaBin_, DnaCompressedBin& dnaWorkBin
 {
 	// just sort records for better matching
 	//
-	DnaRecordComparator comparator(0);
-	std::sort(dnaBin_.Begin(), dnaBin_.End(), comparator);
+	DnaRecordSorter sorter(0);
+	sorter.Sort(dnaBin_.Begin(), dnaBin_.End());
 
 
 	// prepare the work and output buffer buffer
@@ -496,13 +748,15 @@ void DnaCompressor::CompressRecordNormal(const DnaRecord &rec_)
 	prevBuffer.pop_back();
 
 	// get the best match
-	MatchResult matchResult = FindBestLzMatch(rec_, minPos);
+	const uint32 key = (compParams.lzCandidatesNum > 0) ? LzMatchKey(rec_, minPos) : LzMatch::InvalidKey;
+	MatchResult matchResult = FindBestLzMatch(rec_, minPos, key);
 	LzMatch* bestLz = prevBuffer[matchResult.prevId];
 
 	// prepare new match
 	newLz->seq = rec_.dna;
 	newLz->seqLen = rec_.len;
 	newLz->minPos = minPos;
+	newLz->key = key;
 
 	bool identicalReads = (matchResult.prevId == 0 && matchResult.cost == 0 && bestLz->seqLen == rec_.len);
 	bool isReadDifficult = (matchResult.cost >= (compParams.encodeThresholdValue != 0 ? compParams.encodeThresholdValue : rec_.len / 2) );
@@ -526,23 +780,23 @@ void DnaCompressor::CompressRecordNormal(const DnaRecord &rec_)
 		flagCoder->coder.EncodeSymbol(flagCoder->rc, ReadDifficult);
 
 		if (!blockDesc.isLenConst)
-			writers[DnaCompressedBin::LenBuffer]->PutByte(newLz->seqLen);
+			streamEncoders[DnaCompressedBin::LenBuffer]->PutByte(newLz->seqLen);
 
 		for (int32 i = 0; i < newLz->seqLen; ++i)
 		{
 			if (i < newLz->minPos || i >= newLz->minPos + minParams.signatureSuffixLen)
-				writers[DnaCompressedBin::HardReadsBuffer]->PutByte(newLz->seq[i]);
+				streamEncoders[DnaCompressedBin::HardReadsBuffer]->PutByte(newLz->seq[i]);
 			else if (i == newLz->minPos)
-				writers[DnaCompressedBin::HardReadsBuffer]->PutByte(MinimizerPositionSymbol);
+				streamEncoders[DnaCompressedBin::HardReadsBuffer]->PutByte(MinimizerPositionSymbol);
 		}
 	}
 	else							// perform dfferential encoding of the read
 	{
 		if (!blockDesc.isLenConst)
-			writers[DnaCompressedBin::LenBuffer]->PutByte(newLz->seqLen);
+			streamEncoders[DnaCompressedBin::LenBuffer]->PutByte(newLz->seqLen);
 
-		writers[DnaCompressedBin::ShiftBuffer]->PutByte((int32)(ShiftOffset + matchResult.shift));
-		writers[DnaCompressedBin::LzIdBuffer]->PutByte(matchResult.prevId);
+		streamEncoders[DnaCompressedBin::ShiftBuffer]->PutByte((int32)(ShiftOffset + matchResult.shift));
+		streamEncoders[DnaCompressedBin::LzIdBuffer]->PutByte(matchResult.prevId);
 
 		const char* bestSeq = bestLz->seq;
 		int32 bestLen = bestLz->seqLen;
@@ -576,11 +830,7 @@ void DnaCompressor::CompressRecordNormal(const DnaRecord &rec_)
 		// check whether the strings differ only at last position
 		bool onlyLastSymDifference = (bestSeq[minLen-1] != newSeq[minLen-1]);		// this might differ from original algorithm
 		if (onlyLastSymDifference)
-		{
-			// TODO: use std::equal / strcmpn
-			for (int32 i = 0; i < minLen - 1; ++i)
-				onlyLastSymDifference &= (bestSeq[i] == newSeq[i]);
-		}
+			onlyLastSymDifference = (mismatchKernel.FindMismatch(bestSeq, newSeq, minLen - 1) == (uint32)(minLen - 1));
 
 		uint32 flag;
 		if (matchResult.noMismatches)
@@ -594,7 +844,9 @@ void DnaCompressor::CompressRecordNormal(const DnaRecord &rec_)
 
 		if (flag == ReadFullEncode)
 		{
-			// TODO: optimize this routine
+			uint64 mismatchMask[MismatchKernel::MaskWordsNum];
+			mismatchKernel.ComputeMismatchMask(bestSeq, newSeq, minLen, mismatchMask);
+
 			for (int32 i = 0; i < minLen; ++i)
 			{
 				if (i == bestPos)
@@ -603,7 +855,7 @@ void DnaCompressor::CompressRecordNormal(const DnaRecord &rec_)
 					continue;
 				}
 
-				if (bestSeq[i] == newSeq[i])
+				if (!MismatchKernel::IsMismatch(mismatchMask, i))
 					rleEncoder->PutSymbol(true);
 				else
 				{
@@ -624,13 +876,24 @@ void DnaCompressor::CompressRecordNormal(const DnaRecord &rec_)
 }
 
 
-DnaDecompressor::DnaDecompressor(const MinimizerParameters &minParams_)
-	:	DnaStoreBase(minParams_)
+DnaDecompressor::DnaDecompressor(const MinimizerParameters &minParams_, const DnaCodingParams& codingParams_)
+	:	DnaStoreBase(minParams_, codingParams_)
+	,	rleDecoder(NULL)
+	,	flagCoder(NULL)
+	,	revCoder(NULL)
+	,	lettersCoder(NULL)
+	,	ppmdDecoder(NULL)
 {
+	std::fill(streamDecoders, streamDecoders + DnaCompressedBin::BuffersNum, (StreamByteDecoder*)NULL);
+	std::fill(byteCoders, byteCoders + DnaCompressedBin::BuffersNum, (ByteContextCoder*)NULL);
+
+	for (uint32 i = DnaCompressedBin::PPMdStartBuffer; i <= DnaCompressedBin::PPMdEndBuffer; ++i)
+		byteCoders[i] = new ByteContextCoder();
+
 	// TODO: refactor -- we can initialize all readers and encoders in ctor
 	//
 	ppmdDecoder = new PpmdDecoder();
-	ppmdDecoder->StartDecompress(PpmdMemorySizeMb);
+	ppmdDecoder->StartDecompress(codingParams.ppmdMemorySizeMb);
 }
 
 
@@ -640,6 +903,9 @@ DnaDecompressor::~DnaDecompressor()
 
 	ppmdDecoder->FinishDecompress();
 	delete ppmdDecoder;
+
+	for (uint32 i = 0; i < DnaCompressedBin::BuffersNum; ++i)
+		TFree(byteCoders[i]);
 }
 
 
@@ -653,7 +919,15 @@ void DnaDecompressor::PrepareReaders(DnaCompressedBin &dnaWorkBin_)
 	flagCoder = new FlagDecoder(*readers[DnaCompressedBin::FlagBuffer]);
 	revCoder = new RevDecoder(*readers[DnaCompressedBin::RevBuffer]);
 	lettersCoder = new LettersDecoder(*readers[DnaCompressedBin::LetterXBuffer]);
-	rleDecoder = new BinaryRleDecoder(*readers[DnaCompressedBin::MatchBuffer]);
+
+	flagCoder->coder.SetOrder(codingParams.contextOrder);
+	revCoder->coder.SetOrder(codingParams.contextOrder);
+	lettersCoder->coder.SetOrder(codingParams.contextOrder);
+
+	for (uint32 i = DnaCompressedBin::PPMdStartBuffer; i <= DnaCompressedBin::PPMdEndBuffer; ++i)
+		streamDecoders[i] = new StreamByteDecoder(*readers[i], byteCoders[i], i);
+
+	rleDecoder = new MatchRleDecoder(*streamDecoders[DnaCompressedBin::MatchBuffer]);
 }
 
 
@@ -664,13 +938,16 @@ void DnaDecompressor::CleanupReaders()
 	TFree(revCoder);
 	TFree(flagCoder);
 
+	for (uint32 i = DnaCompressedBin::PPMdStartBuffer; i <= DnaCompressedBin::PPMdEndBuffer; ++i)
+		TFree(streamDecoders[i]);
+
 	for (uint32 i = 0; i < readers.size(); ++i)
 		delete readers[i];
 	readers.clear();
 }
 
 
-void DnaDecompressor::DecompressDna(CompressedDnaBlock &compBin_, DnaBin &dnaBin_, DnaCompressedBin& dnaWorkBin_, DataChunk& dnaBuffer_)
+void DnaDecompressor::DecompressDna(CompressedDnaBlock &compBin_, DnaBin &dnaBin_, DnaCompressedBin& dnaWorkBin_, DataChunk& outChunk_)
 {
 	// read header
 	//
@@ -691,23 +968,24 @@ void DnaDecompressor::DecompressDna(CompressedDnaBlock &compBin_, DnaBin &dnaBin
 	ASSERT(blockDesc.header.rawDnaStreamSize > 0);
 
 
-	// prepare dna bin
+	// prepare dna bin and the output -- the reads followed by new line symbols
 	//
 	dnaBin_.Resize(blockDesc.header.recordsCount);
 
-	if (dnaBuffer_.data.Size() < blockDesc.header.rawDnaStreamSize)
-		dnaBuffer_.data.Extend(blockDesc.header.rawDnaStreamSize);
+	const uint64 outSize = blockDesc.header.rawDnaStreamSize + blockDesc.header.recordsCount;
+	if (outChunk_.data.Size() < outSize)
+		outChunk_.data.Extend(outSize);
 
 	if (blockDesc.header.minimizerId != minParams.TotalMinimizersCount())
-		DecompressDnaFull(compBin_, dnaWorkBin_, dnaBin_, dnaBuffer_);
+		DecompressDnaFull(compBin_, dnaWorkBin_, dnaBin_, outChunk_);
 	else
-		DecompressDnaRaw(compBin_, dnaWorkBin_, dnaBin_, dnaBuffer_);
+		DecompressDnaRaw(compBin_, dnaWorkBin_, dnaBin_, outChunk_);
 
-	ASSERT(dnaBuffer_.size == blockDesc.header.rawDnaStreamSize);
+	ASSERT(outChunk_.size == outSize);
 }
 
 
-void DnaDecompressor::DecompressDnaFull(CompressedDnaBlock &compBin_, DnaCompressedBin& dnaWorkBin_, DnaBin &dnaBin_, DataChunk& dnaBuffer_)
+void DnaDecompressor::DecompressDnaFull(CompressedDnaBlock &compBin_, DnaCompressedBin& dnaWorkBin_, DnaBin &dnaBin_, DataChunk& outChunk_)
 {
 	BitMemoryReader blockReader(compBin_.dataBuffer.data, compBin_.dataBuffer.size);
 	blockReader.SetPosition(DnaShortBlockHeader::Size);
@@ -719,14 +997,38 @@ void DnaDecompressor::DecompressDnaFull(CompressedDnaBlock &compBin_, DnaCompres
 			blockDesc.header.workBufferSizes[i] = blockReader.Get8Bytes();
 
 		// get compressed buffer sizes
-		uint64 totalSize = DnaBlockHeader::Size;
+		uint64 totalSize = 0;
 		for (uint32 i = 0; i < DnaCompressedBin::BuffersNum; ++i)
 		{
 			blockDesc.header.compBufferSizes[i] = blockReader.Get8Bytes();
 			totalSize += blockDesc.header.compBufferSizes[i];
 		}
 
-		ASSERT(totalSize == compBin_.dataBuffer.size);
+		// the header of the older archives ends with the buffer sizes, otherwise the format
+		// version and the streams codecs follow
+		const uint64 headerSize = compBin_.dataBuffer.size - totalSize;
+		if (headerSize != DnaBlockHeader::LegacySize)
+		{
+			if (headerSize < DnaBlockHeader::LegacySize + sizeof(uint8))
+				throw Exception("Corrupted archive.");
+
+			const uint8 version = blockReader.GetByte();
+			if (version != DnaBlockHeader::FormatVersion || headerSize != DnaBlockHeader::Size)
+				throw Exception("Unsupported block format version.");
+
+			for (uint32 i = 0; i < DnaCompressedBin::BuffersNum; ++i)
+				blockDesc.header.streamCodecs[i] = blockReader.GetByte();
+		}
+
+		for (uint32 i = 0; i < DnaCompressedBin::BuffersNum; ++i)
+		{
+			const uint32 codec = blockDesc.header.streamCodecs[i];
+			if (!StreamCodecRegistry::IsApplicable(codec, i))
+				throw Exception("Invalid streams codec in the archive");
+
+			if (!StreamCodecRegistry::IsAvailable(codec))
+				throw Exception(std::string("Streams codec not available: ") + StreamCodecRegistry::Name(codec));
+		}
 	}
 
 
@@ -735,8 +1037,9 @@ void DnaDecompressor::DecompressDnaFull(CompressedDnaBlock &compBin_, DnaCompres
 	{
 		for (uint32 i = 0; i < DnaCompressedBin::BuffersNum; ++i)
 		{
-			if (dnaWorkBin_.buffers[i]->data.Size() < blockDesc.header.workBufferSizes[i])
-				dnaWorkBin_.buffers[i]->data.Extend(blockDesc.header.workBufferSizes[i] + (blockDesc.header.workBufferSizes[i] / 8));
+			const uint64 size = MAX(blockDesc.header.workBufferSizes[i], blockDesc.header.compBufferSizes[i]);
+			if (dnaWorkBin_.buffers[i]->data.Size() < size)
+				dnaWorkBin_.buffers[i]->data.Extend(size + (size / 8));
 		}
 	}
 
@@ -773,7 +1076,7 @@ void DnaDecompressor::DecompressDnaFull(CompressedDnaBlock &compBin_, DnaCompres
 		}
 
 
-		// PPMd start
+		// the byte streams start, the range-coded streams are just copied
 		//
 		for (uint32 i = DnaCompressedBin::PPMdStartBuffer; i <= DnaCompressedBin::PPMdEndBuffer; ++i)
 		{
@@ -783,15 +1086,23 @@ void DnaDecompressor::DecompressDnaFull(CompressedDnaBlock &compBin_, DnaCompres
 			{
 				byte* inMem = inMemBegin + inMemPos;
 
-				unsigned long int outSize = dnaWorkBin_.buffers[i]->data.Size();
+				uint64 outSize = blockDesc.header.workBufferSizes[i];
 				byte* outMem = dnaWorkBin_.buffers[i]->data.Pointer();
 
-				bool r = ppmdDecoder->DecodeNextMember(inMem, inSize, outMem, outSize);
-				ASSERT(r);
-				ASSERT(outSize > 0);
+				if (StreamCodecRegistry::IsOnTheFly(blockDesc.header.streamCodecs[i]))
+				{
+					std::copy(inMem, inMem + inSize, outMem);
+					outSize = inSize;
+				}
+				else
+				{
+					bool r = StreamCodecRegistry::Decode(blockDesc.header.streamCodecs[i], inMem, inSize, outMem, outSize,
+														 ppmdDecoder, GetStreamModel(i));
+					ASSERT(r);
+					(void)r;
+				}
 				inMemPos += inSize;
 
-				ASSERT(blockDesc.header.workBufferSizes[i] == outSize);
 				dnaWorkBin_.buffers[i]->size = outSize;
 			}
 			else
@@ -800,7 +1111,7 @@ void DnaDecompressor::DecompressDnaFull(CompressedDnaBlock &compBin_, DnaCompres
 			}
 		}
 		//
-		// PPMd end
+		// byte streams end
 	}
 
 	// prepare minimizer config + lz
@@ -808,13 +1119,19 @@ void DnaDecompressor::DecompressDnaFull(CompressedDnaBlock &compBin_, DnaCompres
 	minParams.GenerateMinimizer(blockDesc.header.minimizerId, currentMinimizerBuf);
 	currentMinimizerBuf[minParams.signatureSuffixLen] = 0;
 
-	PrepareLzBuffer(LzBufferSize + 1);
+	PrepareLzBuffer(codingParams.lzBufferSize + 1);
 
 
 	// prepare decoders
 	//
 	PrepareReaders(dnaWorkBin_);
 
+	for (uint32 i = DnaCompressedBin::PPMdStartBuffer; i <= DnaCompressedBin::PPMdEndBuffer; ++i)
+	{
+		streamDecoders[i]->Start(StreamCodecRegistry::IsOnTheFly(blockDesc.header.streamCodecs[i]),
+								 blockDesc.header.workBufferSizes[i], streamModels);
+	}
+
 	rleDecoder->Start();
 	flagCoder->Start();
 	revCoder->Start();
@@ -823,37 +1140,50 @@ void DnaDecompressor::DecompressDnaFull(CompressedDnaBlock &compBin_, DnaCompres
 
 	// decode records
 	//
-	char* dnaBufferPtr = (char*)dnaBuffer_.data.Pointer();
-	uint64 dnaBuferPos = 0;
+	char* outPtr = (char*)outChunk_.data.Pointer();
+	uint64 outPos = 0;
 
 	for (uint32 i = 0; i < dnaBin_.Size(); ++i)
 	{
 		DnaRecord& rec = dnaBin_[i];
-		rec.dna = dnaBufferPtr + dnaBuferPos;
+		rec.dna = outPtr + outPos;
 		DecompressRecordNormal(rec);
 
-		dnaBuferPos += rec.len;
-
-		ASSERT(dnaBuferPos <= dnaBuffer_.data.Size());
+		outPos += rec.len;
+		ASSERT(outPos < outChunk_.data.Size());
+		outPtr[outPos++] = '\n';
 	}
 
 	// finish decoding
 	//
-	dnaBuffer_.size = dnaBuferPos;
+	outChunk_.size = outPos;
 
 	rleDecoder->End();
 	flagCoder->End();
 	revCoder->End();
 	lettersCoder->End();
 
+	for (uint32 i = DnaCompressedBin::PPMdStartBuffer; i <= DnaCompressedBin::PPMdEndBuffer; ++i)
+		streamDecoders[i]->End();
+
 
 	// cleanup
 	//
 	CleanupReaders();
+
+
+	// restore the original orientation of the reads -- as the LZ matches refer to the
+	// previous records, this can be done only after the whole block is decoded
+	//
+	for (uint32 i = 0; i < dnaBin_.Size(); ++i)
+	{
+		if (dnaBin_[i].reverse)
+			dnaBin_[i].ComputeRCInPlace();
+	}
 }
 
 
-void DnaDecompressor::DecompressDnaRaw(CompressedDnaBlock &compBin_, DnaCompressedBin& /*dnaWorkBin_*/, DnaBin &dnaBin_, DataChunk& dnaBuffer_)
+void DnaDecompressor::DecompressDnaRaw(CompressedDnaBlock &compBin_, DnaCompressedBin& /*dnaWorkBin_*/, DnaBin &dnaBin_, DataChunk& outChunk_)
 {
 	BitMemoryReader blockReader(compBin_.dataBuffer.data, compBin_.dataBuffer.size);
 	blockReader.SetPosition(DnaShortBlockHeader::Size);
@@ -884,13 +1214,15 @@ void DnaDecompressor::DecompressDnaRaw(CompressedDnaBlock &compBin_, DnaCompress
 	const uint64 dnaDataOffset = blockReader.Position();
 
 
-	// PPMD decompress
+	// PPMD decompress -- at the end of the output chunk, leaving the space for the new line
+	// symbols to be inserted in front
 	//
+	const uint64 dnaBufferOffset = dnaBin_.Size();
 	{
 		uint64 inSize = ppmdBufferSize;
 		byte* inMem = compBin_.dataBuffer.data.Pointer() + dnaDataOffset;
 		unsigned long int outSize = dnaBufferSize;
-		byte* outMem = dnaBuffer_.data.Pointer();
+		byte* outMem = outChunk_.data.Pointer() + dnaBufferOffset;
 
 		bool r = ppmdDecoder->DecodeNextMember(inMem, inSize, outMem, outSize);
 		ASSERT(r);
@@ -898,10 +1230,12 @@ void DnaDecompressor::DecompressDnaRaw(CompressedDnaBlock &compBin_, DnaCompress
 		ASSERT(dnaBufferSize == outSize);
 	}
 
-	// decode records
+	// decode records -- moving them towards the beginning of the chunk, the destination
+	// never overtakes the not yet moved data
 	//
-	char* dnaBufferPtr = (char*)dnaBuffer_.data.Pointer();
+	char* outPtr = (char*)outChunk_.data.Pointer();
 	uint64 bufferPos = 0;
+	uint64 outPos = 0;
 	for (uint32 i = 0; i < dnaBin_.Size(); ++i)
 	{
 		DnaRecord& r = dnaBin_[i];
@@ -912,12 +1246,17 @@ void DnaDecompressor::DecompressDnaRaw(CompressedDnaBlock &compBin_, DnaCompress
 			r.len = blockDesc.header.recMinLen;
 		ASSERT(bufferPos + r.len <= dnaBufferSize);
 
-		r.dna = dnaBufferPtr + bufferPos;
+		const char* src = outPtr + dnaBufferOffset + bufferPos;
+		std::copy(src, src + r.len, outPtr + outPos);
+
+		r.dna = outPtr + outPos;
 		bufferPos += r.len;
+		outPos += r.len;
+		outPtr[outPos++] = '\n';
 	}
 
 	ASSERT(bufferPos == dnaBufferSize);
-	dnaBuffer_.size = bufferPos;
+	outChunk_.size = outPos;
 }
 
 
@@ -944,7 +1283,7 @@ void DnaDecompressor::DecompressRecordNormal(DnaRecord &rec_)
 	else if (flag == ReadDifficult)			// reads are too different - full encoding
 	{
 		if (!blockDesc.isLenConst)
-			rec_.len = readers[DnaCompressedBin::LenBuffer]->GetByte();
+			rec_.len = streamDecoders[DnaCompressedBin::LenBuffer]->GetByte();
 		else
 			rec_.len = blockDesc.header.recMinLen;
 		ASSERT(rec_.len > 0);
@@ -953,7 +1292,7 @@ void DnaDecompressor::DecompressRecordNormal(DnaRecord &rec_)
 		rec_.minimizerPos = 0;
 		for (int32 i = 0; i < rec_.len; ++i)
 		{
-			int32 c = readers[DnaCompressedBin::HardReadsBuffer]->GetByte();
+			int32 c = streamDecoders[DnaCompressedBin::HardReadsBuffer]->GetByte();
 			if (c != MinimizerPositionSymbol)
 			{
 				ASSERT(c == 'A' || c == 'C' || c == 'G' || c == 'T' || c == 'N');
@@ -975,7 +1314,7 @@ void DnaDecompressor::DecompressRecordNormal(DnaRecord &rec_)
 	else									// reads are similar - mismatch coding
 	{
 		if (!blockDesc.isLenConst)
-			rec_.len = readers[DnaCompressedBin::LenBuffer]->GetByte();
+			rec_.len = streamDecoders[DnaCompressedBin::LenBuffer]->GetByte();
 		else
 			rec_.len = blockDesc.header.recMinLen;
 
@@ -984,10 +1323,10 @@ void DnaDecompressor::DecompressRecordNormal(DnaRecord &rec_)
 
 		int32 recLen = rec_.len;
 		char* recStr = rec_.dna;
-		int32 shift = (int32)(readers[DnaCompressedBin::ShiftBuffer]->GetByte()) - ShiftOffset;
+		int32 shift = (int32)(streamDecoders[DnaCompressedBin::ShiftBuffer]->GetByte()) - ShiftOffset;
 		ASSERT(shift < recLen - minParams.signatureSuffixLen);
 
-		int32 prevId = readers[DnaCompressedBin::LzIdBuffer]->GetByte();
+		int32 prevId = streamDecoders[DnaCompressedBin::LzIdBuffer]->GetByte();
 
 		LzMatch* bestLz = prevBuffer[prevId];
 		const char* bestSeq = bestLz->seq;
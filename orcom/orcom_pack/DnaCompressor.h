@@ -12,10 +12,13 @@
 #include "../orcom_bin/Globals.h"
 
 #include <string>
+#include <vector>
 #include <deque>
 
 #include "Params.h"
 #include "CompressedBlockData.h"
+#include "StreamCodecRegistry.h"
+#include "MismatchKernel.h"
 
 #include "../orcom_bin/BitMemory.h"
 #include "../orcom_bin/Params.h"
@@ -24,12 +27,292 @@
 #include "../ppmd/PPMd.h"
 
 
+// the models of the streams (PPMd and the binary context ones), trained on the streams of the
+// first blocks of the archive (the training blocks, coded with the fresh models) -- every
+// following block starts with the trained statistics, hence it can be decoded independently
+// once the models are known
+//
+class DnaStreamModels
+{
+public:
+	static const uint32 StreamsNum = DnaCompressedBin::PPMdEndBuffer - DnaCompressedBin::PPMdStartBuffer + 1;
+	static const uint32 DefaultTrainingSizeLog = 14;
+	static const uint32 MaxTrainingBinsNum = 64;
+
+	DnaStreamModels(uint32 trainingSizeLog_ = DefaultTrainingSizeLog)
+		:	trainingSizeLog(trainingSizeLog_)
+		,	trainingSize(1ULL << trainingSizeLog_)
+		,	trainingBinsNum(0)
+		,	trained(false)
+		,	codecsSelected(false)
+	{
+		std::fill(codecs, codecs + StreamsNum, (uint32)CompressorParams::PpmdStreamCodec);
+	}
+
+	void AddTrainingSymbol(uint32 bufferId_, uint32 sym_)
+	{
+		ASSERT(!trained);
+		ASSERT(bufferId_ >= DnaCompressedBin::PPMdStartBuffer && bufferId_ <= DnaCompressedBin::PPMdEndBuffer);
+
+		std::vector<byte>& data = trainingData[bufferId_ - DnaCompressedBin::PPMdStartBuffer];
+		if (data.size() < trainingSize)
+			data.push_back(sym_);
+	}
+
+	void NextTrainingBin()
+	{
+		trainingBinsNum++;
+	}
+
+	// the bins are added to the training set until all the streams collect the training
+	// size or the limit of the training bins is reached
+	//
+	bool IsTrainingComplete() const;
+	void Train(uint32 order_, uint32 memorySizeMb_);
+
+	// selects the codecs of the streams by coding their training data with all the available
+	// codecs (the fresh ones), the streams without the data keep the codecs of the parameters
+	// -- has to precede the training
+	//
+	void SelectCodecs(const CompressorParams& params_, PpmdEncoder* ppmd_);
+
+	bool IsTrained() const
+	{
+		return trained;
+	}
+
+	uint32 TrainingSizeLog() const
+	{
+		return trainingSizeLog;
+	}
+
+	// returns NULL if the stream had no training data
+	//
+	const PpmdModel* GetModel(uint32 bufferId_) const
+	{
+		ASSERT(bufferId_ >= DnaCompressedBin::PPMdStartBuffer && bufferId_ <= DnaCompressedBin::PPMdEndBuffer);
+		const PpmdModel& m = models[bufferId_ - DnaCompressedBin::PPMdStartBuffer];
+		return (trained && m.IsTrained()) ? &m : NULL;
+	}
+
+	bool HasSelectedCodecs() const
+	{
+		return codecsSelected;
+	}
+
+	uint32 GetSelectedCodec(uint32 bufferId_) const
+	{
+		ASSERT(codecsSelected);
+		ASSERT(bufferId_ >= DnaCompressedBin::PPMdStartBuffer && bufferId_ <= DnaCompressedBin::PPMdEndBuffer);
+		return codecs[bufferId_ - DnaCompressedBin::PPMdStartBuffer];
+	}
+
+	const ByteContextCoder* GetByteModel(uint32 bufferId_) const
+	{
+		ASSERT(bufferId_ >= DnaCompressedBin::PPMdStartBuffer && bufferId_ <= DnaCompressedBin::PPMdEndBuffer);
+		const uint32 i = bufferId_ - DnaCompressedBin::PPMdStartBuffer;
+		return (trained && models[i].IsTrained()) ? &byteModels[i] : NULL;
+	}
+
+private:
+	const uint32 trainingSizeLog;
+	const uint64 trainingSize;
+	uint32 trainingBinsNum;
+	bool trained;
+	bool codecsSelected;
+
+	std::vector<byte> trainingData[StreamsNum];
+	uint32 codecs[StreamsNum];
+	PpmdModel models[StreamsNum];
+	ByteContextCoder byteModels[StreamsNum];
+};
+
+
+// the byte stream of the block -- either stored as is, to be compressed as a whole after the
+// block is coded (see StreamCodecRegistry), or range-coded on the fly with the coder kept
+// between the blocks (its models are large). While the stream models are trained, the symbols
+// are collected as their training data
+//
+class StreamByteEncoder
+{
+public:
+	StreamByteEncoder(BitMemoryWriter& writer_, ByteContextCoder* coder_, uint32 bufferId_)
+		:	writer(writer_)
+		,	rc(writer_)
+		,	coder(coder_)
+		,	bufferId(bufferId_)
+		,	rangeCoded(false)
+		,	trainingModels(NULL)
+		,	symbolsNum(0)
+	{}
+
+	void Start(bool rangeCoded_, DnaStreamModels* models_)
+	{
+		rangeCoded = rangeCoded_;
+		trainingModels = (models_ != NULL && !models_->IsTrained()) ? models_ : NULL;
+		symbolsNum = 0;
+
+		if (rangeCoded)
+		{
+			ASSERT(coder != NULL);
+
+			const ByteContextCoder* model = (models_ != NULL) ? models_->GetByteModel(bufferId) : NULL;
+			if (model != NULL)
+				*coder = *model;
+			else
+				coder->Clear();
+
+			rc.Start();
+		}
+	}
+
+	// the empty streams are not flushed, left empty
+	//
+	void End()
+	{
+		if (rangeCoded && symbolsNum > 0)
+			rc.End();
+	}
+
+	void PutByte(uint32 sym_)
+	{
+		if (rangeCoded)
+			coder->EncodeSymbol(rc, sym_);
+		else
+			writer.PutByte(sym_);
+
+		if (trainingModels != NULL)
+			trainingModels->AddTrainingSymbol(bufferId, sym_);
+		symbolsNum++;
+	}
+
+	uint64 SymbolsNum() const
+	{
+		return symbolsNum;
+	}
+
+private:
+	BitMemoryWriter& writer;
+	RangeEncoder rc;
+	ByteContextCoder* coder;						// NULL if the stream is never range-coded
+
+	const uint32 bufferId;
+	bool rangeCoded;
+	DnaStreamModels* trainingModels;
+	uint64 symbolsNum;
+};
+
+
+class StreamByteDecoder
+{
+public:
+	StreamByteDecoder(BitMemoryReader& reader_, ByteContextCoder* coder_, uint32 bufferId_)
+		:	reader(reader_)
+		,	rc(reader_)
+		,	coder(coder_)
+		,	bufferId(bufferId_)
+		,	rangeCoded(false)
+		,	trainingModels(NULL)
+		,	symbolsNum(0)
+		,	position(0)
+	{}
+
+	void Start(bool rangeCoded_, uint64 symbolsNum_, DnaStreamModels* models_)
+	{
+		rangeCoded = rangeCoded_;
+		trainingModels = (models_ != NULL && !models_->IsTrained()) ? models_ : NULL;
+		symbolsNum = symbolsNum_;
+		position = 0;
+
+		if (rangeCoded && symbolsNum > 0)
+		{
+			ASSERT(coder != NULL);
+
+			const ByteContextCoder* model = (models_ != NULL) ? models_->GetByteModel(bufferId) : NULL;
+			if (model != NULL)
+				*coder = *model;
+			else
+				coder->Clear();
+
+			rc.Start();
+		}
+	}
+
+	// the symbols left unread are decoded to keep the training data equal to the encoder's one
+	//
+	void End()
+	{
+		if (trainingModels != NULL)
+		{
+			while (position < symbolsNum)
+				GetByte();
+		}
+	}
+
+	uint32 GetByte()
+	{
+		ASSERT(position < symbolsNum);
+
+		uint32 sym;
+		if (rangeCoded)
+			sym = coder->DecodeSymbol(rc);
+		else
+			sym = reader.GetByte();
+
+		if (trainingModels != NULL)
+			trainingModels->AddTrainingSymbol(bufferId, sym);
+		position++;
+		return sym;
+	}
+
+	uint64 Position() const
+	{
+		return position;
+	}
+
+	uint64 Size() const
+	{
+		return symbolsNum;
+	}
+
+private:
+	BitMemoryReader& reader;
+	RangeDecoder rc;
+	ByteContextCoder* coder;						// NULL if the stream is never range-coded
+
+	const uint32 bufferId;
+	bool rangeCoded;
+	DnaStreamModels* trainingModels;
+	uint64 symbolsNum;
+	uint64 position;
+};
+
+
 class DnaStoreBase
 {
 public:
-	DnaStoreBase(const MinimizerParameters& minParams_);
+	DnaStoreBase(const MinimizerParameters& minParams_, const DnaCodingParams& codingParams_);
 	~DnaStoreBase();
 
+	// with the models set, the streams of the blocks are collected as the training data
+	// until the models are trained, and then used for coding
+	//
+	void SetStreamModels(DnaStreamModels* models_)
+	{
+		streamModels = models_;
+	}
+
+	DnaStreamModels* GetStreamModels() const
+	{
+		return streamModels;
+	}
+
+	void TrainStreamModels()
+	{
+		ASSERT(streamModels != NULL);
+		streamModels->Train(codingParams.ppmdOrder, codingParams.ppmdMemorySizeMb);
+	}
+
 protected:
 	enum ReadFlags
 	{
@@ -42,14 +325,18 @@ protected:
 
 	struct LzMatch
 	{
+		static const uint32 InvalidKey = (uint32)-1;
+
 		char* seq;
 		int32 seqLen;
 		int32 minPos;
+		uint32 key;
 
 		LzMatch()
 			:	seq(NULL)
 			,	seqLen(0)
 			,	minPos(0)
+			,	key(InvalidKey)
 		{}
 	};
 
@@ -83,13 +370,20 @@ protected:
 		}
 	};
 
+	// the blocks of the older archives end the header after the buffer sizes and lack the
+	// streams codecs, all PPMd -- the current blocks follow the sizes with the format
+	// version and the streams codecs
+	//
 	struct DnaBlockHeader : public DnaShortBlockHeader
 	{
 		static const uint32 BuffersCount = DnaCompressedBin::BuffersNum;
-		static const uint32 Size = DnaShortBlockHeader::Size + 2*BuffersCount*sizeof(uint64);
+		static const uint32 LegacySize = DnaShortBlockHeader::Size + 2*BuffersCount*sizeof(uint64);
+		static const uint32 Size = LegacySize + sizeof(uint8) + BuffersCount*sizeof(uint8);
+		static const uint8 FormatVersion = 1;
 
-		uint64 workBufferSizes[BuffersCount];
+		uint64 workBufferSizes[BuffersCount];			// the range-coded streams -- symbols number
 		uint64 compBufferSizes[BuffersCount];
+		uint8 streamCodecs[BuffersCount];
 
 		DnaBlockHeader()
 		{
@@ -101,6 +395,9 @@ protected:
 			DnaShortBlockHeader::Clear();
 			std::fill(workBufferSizes, workBufferSizes + BuffersCount, 0);
 			std::fill(compBufferSizes, compBufferSizes + BuffersCount, 0);
+
+			std::fill(streamCodecs, streamCodecs + DnaCompressedBin::PPMdStartBuffer, (uint8)CompressorParams::ContextStreamCodec);
+			std::fill(streamCodecs + DnaCompressedBin::PPMdStartBuffer, streamCodecs + BuffersCount, (uint8)CompressorParams::PpmdStreamCodec);
 		}
 	};
 
@@ -129,24 +426,18 @@ protected:
 	typedef TAdvancedContextCoder<8, 4> LettersContextCoder;
 
 
-	// predefined constants
+	// predefined constants, the LZ buffer size is set by the coding parameters
 	//
-	static const uint32 LzBufferSize = 255;
 	static const int32 ShiftOffset = 128;
 	static const uint32 InitialSeqLen = DnaRecord::MaxDnaLen;
 	static const uint32 MaxSignatureLen = 255;
 	static const uint32 MinimizerPositionSymbol = '.';
 
 
-	// ppmd configuration
-	//
-	static const uint32 PpmdMemorySizeMb = 16;
-	static const uint32 PpmdOrder = 4;
-
-
 	//  members
 	//
 	const MinimizerParameters minParams;
+	const DnaCodingParams codingParams;
 
 	char dnaToIdx[128];
 	char idxToDna[5];
@@ -156,10 +447,17 @@ protected:
 	std::deque<LzMatch*> prevBuffer;
 	char currentMinimizerBuf[MaxSignatureLen];
 
+	DnaStreamModels* streamModels;
+
 
 	// methods
 	//
 	void PrepareLzBuffer(uint32 size_);
+
+	const PpmdModel* GetStreamModel(uint32 bufferId_) const
+	{
+		return (streamModels != NULL) ? streamModels->GetModel(bufferId_) : NULL;
+	}
 };
 
 
@@ -167,7 +465,7 @@ class DnaCompressorBase: public DnaStoreBase
 {
 public:
 	DnaCompressorBase(const MinimizerParameters& minParams_, const CompressorParams& compParams_)
-		:	DnaStoreBase(minParams_)
+		:	DnaStoreBase(minParams_, compParams_.coding)
 		,	compParams(compParams_)
 	{}
 
@@ -188,14 +486,65 @@ protected:
 	};
 
 	static const int32 MaxShiftValue = ShiftOffset-1;
+	static const uint32 LzKeySymbols = 8;
+	static const uint32 LzRecentCandidates = 8;
 
 	const CompressorParams compParams;
+	const MismatchKernel mismatchKernel;
+
+	MatchResult FindBestLzMatch(const DnaRecord& rec_, int32 recMinPos_, uint32 recKey_);
+	void TestLzMatch(const DnaRecord& rec_, int32 recMinPos_, uint32 lzId_, MatchResult& result_);
+	uint32 LzMatchKey(const DnaRecord& rec_, int32 recMinPos_) const;
+
+	static bool IsLzKeySimilar(uint32 key1_, uint32 key2_)
+	{
+		if (key1_ == LzMatch::InvalidKey)
+			return false;
+
+		const uint32 diff = key1_ ^ key2_;
+		const uint32 symbolsDiff = (diff | (diff >> 1)) & 0x55555555;
+		return (symbolsDiff & (symbolsDiff - 1)) == 0;
+	}
+
+	// the match examined by the limited search: the recent one or the one of a similar key
+	//
+	bool IsLzCandidate(uint32 lzId_, uint32 recKey_) const
+	{
+		return lzId_ < LzRecentCandidates || IsLzKeySimilar(prevBuffer[lzId_]->key, recKey_);
+	}
 
-	MatchResult FindBestLzMatch(const DnaRecord& rec_, int32 recMinPos_);
 	int32 CalculateMismatchesCost(const char* seq1_, uint32 len1_, const char* seq2_, uint32 len2_, int32 bestValue_);
 };
 
 
+// splits the giant bins into the segments compressed independently
+//
+class DnaBinSplitter
+{
+public:
+	DnaBinSplitter(const MinimizerParameters& minParams_)
+		:	signatureLen(minParams_.signatureLen)
+		,	keySizes(SegmentKeysNum)
+		,	keySegments(SegmentKeysNum)
+	{}
+
+	// distributes the records into segmentsNum_ bins, returns their dna sizes in segmentSizes_
+	//
+	void Split(const DnaBin& dnaBin_, uint32 segmentsNum_, DnaBinCollection& segmentBins_, std::vector<uint64>& segmentSizes_);
+
+private:
+	static const uint32 SegmentKeySymbols = 6;
+	static const uint32 SegmentKeysNum = 1 << (2 * SegmentKeySymbols);
+
+	const uint32 signatureLen;
+	std::vector<uint64> keySizes;
+	std::vector<uint32> keySegments;
+	std::vector<uint16> recordKeys;
+
+	uint32 SegmentKey(const DnaRecord& rec_) const;
+};
+
+
 class DnaCompressor : public DnaCompressorBase
 {
 public:
@@ -204,18 +553,28 @@ public:
 
 	void CompressDna(DnaBin& dnaBin_, uint32 minimizerId_, uint64 rawDnaStreamSize_, DnaCompressedBin& dnaWorkBin, CompressedDnaBlock& compBin_);
 
+	void SelectStreamCodecs()
+	{
+		ASSERT(streamModels != NULL);
+		streamModels->SelectCodecs(compParams, ppmdEncoder);
+	}
+
 private:
 	typedef TEncoder<FlagContextCoder> FlagEncoder;
 	typedef TEncoder<RevContextCoder> RevEncoder;
 	typedef TEncoder<LettersContextCoder> LettersEncoder;
 
-	BinaryRleEncoder* rleEncoder;
+	typedef TBinaryRleEncoder<StreamByteEncoder> MatchRleEncoder;
+
+	MatchRleEncoder* rleEncoder;
 	FlagEncoder* flagCoder;
 	RevEncoder* revCoder;
 	LettersEncoder* lettersCoder;
 	PpmdEncoder* ppmdEncoder;
 
 	std::vector<BitMemoryWriter*> writers;
+	StreamByteEncoder* streamEncoders[DnaCompressedBin::BuffersNum];		// only the PPMd range
+	ByteContextCoder* byteCoders[DnaCompressedBin::BuffersNum];
 
 	void PrepareWriters(DnaCompressedBin& dnaWorkBin_);
 	void CleanupWriters();
@@ -224,35 +583,44 @@ private:
 	void CompressDnaRaw(DnaBin& dnaBin_, DnaCompressedBin& dnaWorkBin_, CompressedDnaBlock& compBin_);
 
 	void CompressRecordNormal(const DnaRecord& rec_);
+
+	uint32 StreamCodec(uint32 bufferId_) const;
 };
 
 
 class DnaDecompressor : public DnaStoreBase
 {
 public:
-	DnaDecompressor(const MinimizerParameters& minParams_);
+	DnaDecompressor(const MinimizerParameters& minParams_, const DnaCodingParams& codingParams_);
 	~DnaDecompressor();
 
-	void DecompressDna(CompressedDnaBlock& compBin_, DnaBin& dnaBin_, DnaCompressedBin& dnaWorkBin_, DataChunk& dnaBuffer_);
+	// decompresses the block straight into the output chunk as newline-terminated reads
+	// in their original orientation, the records of dnaBin_ point into the chunk
+	//
+	void DecompressDna(CompressedDnaBlock& compBin_, DnaBin& dnaBin_, DnaCompressedBin& dnaWorkBin_, DataChunk& outChunk_);
 
 private:
 	typedef TDecoder<FlagContextCoder> FlagDecoder;
 	typedef TDecoder<RevContextCoder> RevDecoder;
 	typedef TDecoder<LettersContextCoder> LettersDecoder;
 
-	BinaryRleDecoder* rleDecoder;
+	typedef TBinaryRleDecoder<StreamByteDecoder> MatchRleDecoder;
+
+	MatchRleDecoder* rleDecoder;
 	FlagDecoder* flagCoder;
 	RevDecoder* revCoder;
 	LettersDecoder* lettersCoder;
 	PpmdDecoder* ppmdDecoder;
 
 	std::vector<BitMemoryReader*> readers;
+	StreamByteDecoder* streamDecoders[DnaCompressedBin::BuffersNum];		// only the PPMd range
+	ByteContextCoder* byteCoders[DnaCompressedBin::BuffersNum];
 
 	void PrepareReaders(DnaCompressedBin& dnaWorkBin_);
 	void CleanupReaders();
 
-	void DecompressDnaFull(CompressedDnaBlock& compBin_, DnaCompressedBin& dnaWorkBin_, DnaBin& dnaBin_, DataChunk& dnaBuffer_);
-	void DecompressDnaRaw(CompressedDnaBlock& compBin_, DnaCompressedBin& dnaWorkBin_, DnaBin& dnaBin_, DataChunk& dnaBuffer_);
+	void DecompressDnaFull(CompressedDnaBlock& compBin_, DnaCompressedBin& dnaWorkBin_, DnaBin& dnaBin_, DataChunk& outChunk_);
+	void DecompressDnaRaw(CompressedDnaBlock& compBin_, DnaCompressedBin& dnaWorkBin_, DnaBin& dnaBin_, DataChunk& outChunk_);
 
 	void DecompressRecordNormal(DnaRecord& rec_);
 };
@@ -12,6 +12,7 @@
 
 #include "DnarchFile.h"
 #include "CompressedBlockData.h"
+#include "../orcom_bin/BitMemory.h"
 #include "../orcom_bin/Exception.h"
 
 
@@ -50,26 +51,52 @@ void DnarchFileWriter::StartCompress(const std::string &fileName_, const Minimiz
 	compParams = compParams_;
 
 	fileFooter.blockSizes.clear();
+	fileFooter.blockIndex.clear();
 
 
-	// skip header pos
+	// skip header pos and write the coding parameters
 	//
-	metaStream->SetPosition(DnarchFileHeader::HeaderSize);
+	codingParams = compParams_.coding;
+	STATIC_ASSERT(sizeof(DnaCodingParams) == DnaCodingParams::StoredSize);
+
+	metaStream->SetPosition(CodingParamsOffset);
+	metaStream->Write((byte*)&codingParams, DnaCodingParams::StoredSize);
 }
 
 
 void DnarchFileWriter::WriteNextBin(const CompressedDnaBlock *bin_)
 {
-	ASSERT(bin_->dataBuffer.size > 0);
+	WriteNextBin(bin_->dataBuffer, bin_->bufferSizes);
+}
+
+
+void DnarchFileWriter::WriteNextBin(const DataChunk& data_, const uint64* bufferSizes_)
+{
+	ASSERT(data_.size > 0);
 
 	for (uint32 i = 0; i < DnaCompressedBin::BuffersNum; ++i)
 	{
-		streamSizes[i] += bin_->bufferSizes[i];
+		streamSizes[i] += bufferSizes_[i];
 	}
 
-	fileFooter.blockSizes.push_back(bin_->dataBuffer.size);
+	// index the block using its header: signature, records count, min and max record
+	// length and raw dna size
+	//
+	BitMemoryReader headerReader(data_.data, data_.size);
+
+	BlockIndexEntry entry;
+	entry.offset = dataStream->Position();
+	entry.size = data_.size;
+	entry.signature = headerReader.Get4Bytes();
+	entry.recordsCount = headerReader.Get8Bytes();
+	headerReader.GetByte();
+	headerReader.GetByte();
+	entry.rawDnaSize = headerReader.Get8Bytes();
+
+	fileFooter.blockSizes.push_back(data_.size);
+	fileFooter.blockIndex.push_back(entry);
 
-	dataStream->Write(bin_->dataBuffer.data.Pointer(), bin_->dataBuffer.size);
+	dataStream->Write(data_.data.Pointer(), data_.size);
 }
 
 
@@ -116,6 +143,14 @@ void DnarchFileWriter::WriteFileFooter()
 	uint32 blockCount = fileFooter.blockSizes.size();
 	metaStream->Write((byte*)&blockCount, sizeof(uint32));
 	metaStream->Write((byte*)fileFooter.blockSizes.data(), fileFooter.blockSizes.size() * sizeof(uint64));
+
+	for (uint32 i = 0; i < fileFooter.blockIndex.size(); ++i)
+	{
+		const BlockIndexEntry& entry = fileFooter.blockIndex[i];
+		metaStream->Write((byte*)&entry.signature, sizeof(uint32));
+		metaStream->Write((byte*)&entry.recordsCount, sizeof(uint64));
+		metaStream->Write((byte*)&entry.rawDnaSize, sizeof(uint64));
+	}
 }
 
 
@@ -136,7 +171,7 @@ DnarchFileReader::~DnarchFileReader()
 }
 
 
-void DnarchFileReader::StartDecompress(const std::string &fileName_, MinimizerParameters &minParams_)
+void DnarchFileReader::StartDecompress(const std::string &fileName_, MinimizerParameters &minParams_, DnaCodingParams& codingParams_)
 {
 	ASSERT(metaStream == NULL);
 
@@ -145,7 +180,9 @@ void DnarchFileReader::StartDecompress(const std::string &fileName_, MinimizerPa
 
 	dataStream = new FileStreamReader(fileName_ + ".cdna");
 
-	if (metaStream->Size() == 0 || dataStream->Size() == 0)
+	// the data of an archive without blocks is empty
+	//
+	if (metaStream->Size() == 0)
 		throw Exception("Empty archive.");
 
 	// Read file header
@@ -160,16 +197,35 @@ void DnarchFileReader::StartDecompress(const std::string &fileName_, MinimizerPa
 		throw Exception("Corrupted archive.");
 	}
 
+	// read the coding parameters if present
+	//
+	codingParams = DnaCodingParams();
+	if (fileHeader.footerOffset >= CodingParamsOffset + DnaCodingParams::StoredSize)
+	{
+		metaStream->SetPosition(CodingParamsOffset);
+		metaStream->Read((byte*)&codingParams, DnaCodingParams::StoredSize);
+
+		if (!codingParams.IsValid())
+			throw Exception("Corrupted archive.");
+	}
+
 	// clean footer
 	//
 	fileFooter.blockSizes.clear();
+	fileFooter.blockIndex.clear();
+	fileFooter.hasBlockIndex = false;
 
 	metaStream->SetPosition(fileHeader.footerOffset);
 	ReadFileFooter();
 
+	if (fileHeader.trainingSizeLog != 0 && (fileHeader.trainingSizeLog > 30 || fileHeader.trainingBlocksNum == 0
+											|| fileHeader.trainingBlocksNum > fileFooter.blockSizes.size()))
+		throw Exception("Corrupted archive.");
+
 	metaStream->SetPosition(DnarchFileHeader::HeaderSize);
 
 	minParams_ = fileHeader.minParams;
+	codingParams_ = codingParams;
 }
 
 
@@ -183,10 +239,34 @@ void DnarchFileReader::ReadFileFooter()
 {
 	uint32 blockCount = 0;
 	metaStream->Read((byte*)&blockCount, sizeof(uint32));
-	ASSERT(blockCount > 0);
 	fileFooter.blockSizes.resize(blockCount);
 
 	metaStream->Read((byte*)fileFooter.blockSizes.data(), fileFooter.blockSizes.size() * sizeof(uint64));
+
+	// read the block index if present
+	//
+	const uint64 footerEnd = fileHeader.footerOffset + fileHeader.footerSize;
+	if (metaStream->Position() + (uint64)blockCount * BlockIndexEntry::StoredSize > footerEnd)
+		return;
+
+	fileFooter.blockIndex.resize(blockCount);
+	fileFooter.hasBlockIndex = true;
+
+	uint64 offset = 0;
+	for (uint32 i = 0; i < blockCount; ++i)
+	{
+		BlockIndexEntry& entry = fileFooter.blockIndex[i];
+		metaStream->Read((byte*)&entry.signature, sizeof(uint32));
+		metaStream->Read((byte*)&entry.recordsCount, sizeof(uint64));
+		metaStream->Read((byte*)&entry.rawDnaSize, sizeof(uint64));
+
+		entry.offset = offset;
+		entry.size = fileFooter.blockSizes[i];
+		offset += entry.size;
+	}
+
+	if (offset != dataStream->Size())
+		throw Exception("Corrupted archive.");
 }
 
 
@@ -195,6 +275,30 @@ bool DnarchFileReader::ReadNextBin(CompressedDnaBlock *bin_)
 	if (blockIdx >= fileFooter.blockSizes.size())
 		return false;
 
+	ReadBlock(bin_);
+	return true;
+}
+
+
+bool DnarchFileReader::ReadBin(uint32 signature_, CompressedDnaBlock *bin_)
+{
+	if (!HasBlockIndex())
+		throw Exception("Archive does not contain the block index.");
+
+	while (blockIdx < fileFooter.blockIndex.size() && fileFooter.blockIndex[blockIdx].signature != signature_)
+		blockIdx++;
+
+	if (blockIdx >= fileFooter.blockIndex.size())
+		return false;
+
+	dataStream->SetPosition(fileFooter.blockIndex[blockIdx].offset);
+	ReadBlock(bin_);
+	return true;
+}
+
+
+void DnarchFileReader::ReadBlock(CompressedDnaBlock *bin_)
+{
 	const uint64 bs = fileFooter.blockSizes[blockIdx];
 	if (bin_->dataBuffer.data.Size() < bs)
 		bin_->dataBuffer.data.Extend(bs + (bs / 8));
@@ -203,7 +307,6 @@ bool DnarchFileReader::ReadNextBin(CompressedDnaBlock *bin_)
 	bin_->dataBuffer.size = bs;
 
 	blockIdx++;
-	return true;
 }
 
 
@@ -21,18 +21,44 @@
 class DnarchFileBase
 {
 public:
+	// index entry of a compressed block -- the offset and the size are derived from the
+	// block sizes, only the remaining fields are stored
+	//
+	struct BlockIndexEntry
+	{
+		static const uint32 StoredSize = sizeof(uint32) + 2*sizeof(uint64);
+
+		uint64 offset;
+		uint64 size;
+		uint64 recordsCount;
+		uint64 rawDnaSize;
+		uint32 signature;
+
+		BlockIndexEntry()
+			:	offset(0)
+			,	size(0)
+			,	recordsCount(0)
+			,	rawDnaSize(0)
+			,	signature(0)
+		{}
+	};
+
 	virtual ~DnarchFileBase() {}
 
 protected:
 	struct DnarchFileHeader
 	{
-		static const uint32 ReservedBytes = 3;
-		static const uint32 HeaderSize = 8 + 4 + ReservedBytes + 9;
+		static const uint32 HeaderSize = 8 + 4 + 2 + 1 + 9;
 
 		uint64 footerOffset;
 		uint32 footerSize;
 
-		uchar reserved[ReservedBytes];
+		// the stream models are trained on the first trainingBlocksNum blocks, using at
+		// most 2^trainingSizeLog bytes of each stream -- 0 if there are no models (the
+		// field was reserved in the older archives)
+		//
+		uint16 trainingBlocksNum;
+		uchar trainingSizeLog;
 
 		MinimizerParameters minParams;
 
@@ -42,12 +68,27 @@ protected:
 		}
 	};
 
+	// the coding parameters follow the header and are absent in the older archives, where
+	// the footer follows the header
+	//
+	static const uint32 CodingParamsOffset = DnarchFileHeader::HeaderSize;
+
+	// the block index follows the block sizes and is absent in the older archives -- an
+	// archive without blocks has an empty, but valid, index
+	//
 	struct DnarchFileFooter
 	{
 		std::vector<uint64> blockSizes;
+		std::vector<BlockIndexEntry> blockIndex;
+		bool hasBlockIndex;
+
+		DnarchFileFooter()
+			:	hasBlockIndex(false)
+		{}
 	};
 
 	DnarchFileHeader fileHeader;
+	DnaCodingParams codingParams;
 	DnarchFileFooter fileFooter;
 };
 
@@ -60,6 +101,7 @@ public:
 
 	void StartCompress(const std::string& fileName_, const MinimizerParameters& minParams_, const CompressorParams& compParams_);
 	void WriteNextBin(const CompressedDnaBlock* bin_);
+	void WriteNextBin(const DataChunk& data_, const uint64* bufferSizes_);
 	void FinishCompress();
 
 	const std::vector<uint64> GetStreamSizes() const
@@ -67,6 +109,20 @@ public:
 		return streamSizes;
 	}
 
+	// marks the blocks written so far as the training blocks of the stream models
+	//
+	void SetTrainingBlocks(uint32 trainingSizeLog_)
+	{
+		ASSERT(fileFooter.blockSizes.size() <= (uint16)-1);
+		fileHeader.trainingBlocksNum = fileFooter.blockSizes.size();
+		fileHeader.trainingSizeLog = trainingSizeLog_;
+	}
+
+	uint32 TrainingBlocksNum() const
+	{
+		return fileHeader.trainingBlocksNum;
+	}
+
 protected:
 	FileStreamWriter* metaStream;
 	FileStreamWriter* dataStream;
@@ -86,10 +142,41 @@ public:
 	DnarchFileReader();
 	~DnarchFileReader();
 
-	void StartDecompress(const std::string& fileName_, MinimizerParameters& minParams_);
+	void StartDecompress(const std::string& fileName_, MinimizerParameters& minParams_, DnaCodingParams& codingParams_);
 	bool ReadNextBin(CompressedDnaBlock *bin_);
 	void FinishDecompress();
 
+	// reads the next block of the given signature -- a bin split into segments spans
+	// several blocks, while the small bins are stored together with the N bin under the
+	// N signature. Requires the block index
+	//
+	bool ReadBin(uint32 signature_, CompressedDnaBlock *bin_);
+
+	bool HasBlockIndex() const
+	{
+		return fileFooter.hasBlockIndex;
+	}
+
+	const std::vector<BlockIndexEntry>& GetBlockIndex() const
+	{
+		return fileFooter.blockIndex;
+	}
+
+	bool HasStreamModels() const
+	{
+		return fileHeader.trainingSizeLog != 0;
+	}
+
+	uint32 TrainingBlocksNum() const
+	{
+		return fileHeader.trainingBlocksNum;
+	}
+
+	uint32 TrainingSizeLog() const
+	{
+		return fileHeader.trainingSizeLog;
+	}
+
 protected:
 	FileStreamReader* metaStream;
 	FileStreamReader* dataStream;
@@ -98,6 +185,7 @@ protected:
 
 	void ReadFileHeader();
 	void ReadFileFooter();
+	void ReadBlock(CompressedDnaBlock *bin_);
 };
 
 
@@ -16,10 +16,11 @@
 #include "DnaCompressor.h"
 #include "DnarchOperator.h"
 #include "Params.h"
+#include "StreamCodecRegistry.h"
 
 #include "../orcom_bin/DnaPacker.h"
-#include "../orcom_bin/DnaParser.h"
 #include "../orcom_bin/Thread.h"
+#include "../orcom_bin/Exception.h"
 
 
 void DnarchModule::Bin2Dnarch(const std::string &inBinFile_, const std::string &outDnarchFile_, const CompressorParams& params_,
@@ -30,8 +31,19 @@ void DnarchModule::Bin2Dnarch(const std::string &inBinFile_, const std::string &
 
 	extractor->StartDecompress(inBinFile_, conf);
 
+	Bin2Dnarch(extractor, conf, outDnarchFile_, params_, threadsNum_, verboseMode_);
+
+	delete extractor;
+}
+
+
+void DnarchModule::Bin2Dnarch(BinFileExtractor* extractor_, const BinModuleConfig& binConfig_, const std::string &outDnarchFile_,
+							  const CompressorParams& params_, uint32 threadsNum_, bool verboseMode_)
+{
 	DnarchFileWriter* dnarch = new DnarchFileWriter();
-	dnarch->StartCompress(outDnarchFile_, conf.minimizer, params_);
+	dnarch->StartCompress(outDnarchFile_, binConfig_.minimizer, params_);
+
+	DnaStreamModels models;
 
 	if (threadsNum_ > 1)
 	{
@@ -40,27 +52,27 @@ void DnarchModule::Bin2Dnarch(const std::string &inBinFile_, const std::string &
 		const uint64 outBufferSize = 1 << 20;
 
 		MinimizerPartsPool* inPool = new MinimizerPartsPool(partNum, dnaBufferSize);
-		MinimizerPartsQueue* inQueue = new MinimizerPartsQueue(partNum, 1);
+		MinimizerPartsQueue* inQueue = new MinimizerPartsQueue(partNum, 1, MinimizerPartsQueue::UnorderedDelivery);
 
 		CompressedDnaPartsPool* outPool = new CompressedDnaPartsPool(partNum, outBufferSize);
 		CompressedDnaPartsQueue* outQueue = new CompressedDnaPartsQueue(partNum, threadsNum_);
 
-		BinPartsExtractor* inReader = new BinPartsExtractor(extractor, inQueue, inPool);
+		BinPartsExtractor* inReader = new BinPartsExtractor(binConfig_.minimizer, params_, extractor_, inQueue, inPool);
 		DnarchPartsWriter* outWriter = new DnarchPartsWriter(dnarch, outQueue, outPool);
 
 
 		// preprocess small bins and N bin <-- this should be done internally
 		//
 		{
-			DnaCompressor compressor(conf.minimizer, params_);
-			DnaPacker packer(conf.minimizer);
+			DnaCompressor compressor(binConfig_.minimizer, params_);
+			DnaPacker packer(binConfig_.minimizer);
 
 			uint32 signatureId = 0;
 
 			CompressedDnaBlock compBin;
 			BinaryBinBlock binBin;
 
-			std::vector<const BinFileExtractor::BlockDescriptor*> descriptors = extractor->GetSmallBlockDescriptors();
+			std::vector<const BinFileExtractor::BlockDescriptor*> descriptors = extractor_->GetSmallBlockDescriptors();
 
 			uint64 totalDnaBufferSize = 0;
 			uint64 totalRecords = 0;
@@ -69,7 +81,7 @@ void DnarchModule::Bin2Dnarch(const std::string &inBinFile_, const std::string &
 				totalDnaBufferSize += descriptors[i]->rawDnaSize;
 				totalRecords += descriptors[i]->recordsCount;
 			}
-			const BinFileExtractor::BlockDescriptor* nd = extractor->GetNBlockDescriptor();
+			const BinFileExtractor::BlockDescriptor* nd = extractor_->GetNBlockDescriptor();
 			totalDnaBufferSize += nd->rawDnaSize;
 			totalRecords += nd->recordsCount;
 
@@ -79,14 +91,14 @@ void DnarchModule::Bin2Dnarch(const std::string &inBinFile_, const std::string &
 
 			// extract and unpack small bins
 			//
-			while (extractor->ExtractNextSmallBin(binBin, signatureId))
+			while (extractor_->ExtractNextSmallBin(binBin, signatureId))
 			{
 				ASSERT(binBin.metaSize != 0);
 
 				packer.UnpackFromBin(binBin, compBin.workBuffers.dnaBin, signatureId, compBin.workBuffers.dnaBuffer, true);
 			}
 
-			if (extractor->ExtractNBin(binBin, signatureId) && binBin.metaSize > 0)
+			if (extractor_->ExtractNBin(binBin, signatureId) && binBin.metaSize > 0)
 				packer.UnpackFromBin(binBin, compBin.workBuffers.dnaBin, signatureId, compBin.workBuffers.dnaBuffer, true);
 
 
@@ -113,12 +125,18 @@ void DnarchModule::Bin2Dnarch(const std::string &inBinFile_, const std::string &
 
 			// compress all bins together
 			//
-			const uint32 nSignature = conf.minimizer.TotalMinimizersCount();
+			const uint32 nSignature = binConfig_.minimizer.TotalMinimizersCount();
 			compressor.CompressDna(compBin.workBuffers.dnaBin, nSignature, totalDnaBufferSize, compBin.workBuffers.dnaWorkBin, compBin);
 
 			dnarch->WriteNextBin(&compBin);
+
+			// compress the training bins and train the stream models used by the workers
+			//
+			compressor.SetStreamModels(&models);
+			CompressStdBins(extractor_, binConfig_.minimizer, params_, compressor, dnarch, true);
 		}
 
+		DnaStreamModels* workerModels = models.IsTrained() ? &models : NULL;
 
 
 		// launch stuff
@@ -133,9 +151,9 @@ void DnarchModule::Bin2Dnarch(const std::string &inBinFile_, const std::string &
 
 		for (uint32 i = 0; i < threadsNum_; ++i)
 		{
-			operators[i] = new BinPartsCompressor(conf.minimizer, params_, 
+			operators[i] = new BinPartsCompressor(binConfig_.minimizer, params_, 
 												  inQueue, inPool,
-												  outQueue, outPool);
+												  outQueue, outPool, workerModels);
 			opThreadGroup.create_thread(mt::ref(*operators[i]));
 		}
 
@@ -150,9 +168,9 @@ void DnarchModule::Bin2Dnarch(const std::string &inBinFile_, const std::string &
 
 		for (uint32 i = 0; i < threadsNum_; ++i)
 		{
-			operators[i] = new BinPartsCompressor(conf.minimizer, params_,
+			operators[i] = new BinPartsCompressor(binConfig_.minimizer, params_,
 												  inQueue, inPool,
-												  outQueue, outPool);
+												  outQueue, outPool, workerModels);
 			opThreadGroup.push_back(mt::thread(mt::ref(*operators[i])));
 		}
 
@@ -182,8 +200,8 @@ void DnarchModule::Bin2Dnarch(const std::string &inBinFile_, const std::string &
 	}
 	else
 	{
-		DnaCompressor compressor(conf.minimizer, params_);
-		DnaPacker packer(conf.minimizer);
+		DnaCompressor compressor(binConfig_.minimizer, params_);
+		DnaPacker packer(binConfig_.minimizer);
 
 		uint32 minId = 0;
 
@@ -193,7 +211,7 @@ void DnarchModule::Bin2Dnarch(const std::string &inBinFile_, const std::string &
 		// preprocess small bins and N bin <--- this should be done internally
 		//
 		{
-			std::vector<const BinFileExtractor::BlockDescriptor*> descriptors = extractor->GetSmallBlockDescriptors();
+			std::vector<const BinFileExtractor::BlockDescriptor*> descriptors = extractor_->GetSmallBlockDescriptors();
 
 			uint64 totalDnaBufferSize = 0;
 			uint64 totalRecords = 0;
@@ -202,7 +220,7 @@ void DnarchModule::Bin2Dnarch(const std::string &inBinFile_, const std::string &
 				totalDnaBufferSize += descriptors[i]->rawDnaSize;
 				totalRecords += descriptors[i]->recordsCount;
 			}
-			const BinFileExtractor::BlockDescriptor* nd = extractor->GetNBlockDescriptor();
+			const BinFileExtractor::BlockDescriptor* nd = extractor_->GetNBlockDescriptor();
 			totalDnaBufferSize += nd->rawDnaSize;
 			totalRecords += nd->recordsCount;
 
@@ -211,7 +229,7 @@ void DnarchModule::Bin2Dnarch(const std::string &inBinFile_, const std::string &
 
 			// extract and unpack small bins
 			//
-			while (extractor->ExtractNextSmallBin(binBin, minId))
+			while (extractor_->ExtractNextSmallBin(binBin, minId))
 			{
 				if (binBin.metaSize == 0)
 					continue;
@@ -243,7 +261,7 @@ void DnarchModule::Bin2Dnarch(const std::string &inBinFile_, const std::string &
 			// extract and unpack the last one
 			//
 			uint32 nSignature = 0;
-			if (extractor->ExtractNBin(binBin, nSignature) && binBin.metaSize > 0)
+			if (extractor_->ExtractNBin(binBin, nSignature) && binBin.metaSize > 0)
 				packer.UnpackFromBin(binBin, compBin.workBuffers.dnaBin, nSignature, compBin.workBuffers.dnaBuffer, true);
 
 			// compress them all together
@@ -255,21 +273,11 @@ void DnarchModule::Bin2Dnarch(const std::string &inBinFile_, const std::string &
 
 		// process std bins
 		//
-		while (extractor->ExtractNextStdBin(binBin, minId))
-		{
-			if (binBin.metaSize == 0)
-				continue;
-
-			packer.UnpackFromBin(binBin, compBin.workBuffers.dnaBin, minId, compBin.workBuffers.dnaBuffer);
-
-			ASSERT(binBin.rawDnaSize > 0);
-			compressor.CompressDna(compBin.workBuffers.dnaBin, minId, binBin.rawDnaSize, compBin.workBuffers.dnaWorkBin, compBin);
-
-			dnarch->WriteNextBin(&compBin);
-		}
+		compressor.SetStreamModels(&models);
+		CompressStdBins(extractor_, binConfig_.minimizer, params_, compressor, dnarch, false);
 	}
 
-	extractor->FinishDecompress();
+	extractor_->FinishDecompress();
 	dnarch->FinishCompress();
 
 	if (verboseMode_)
@@ -282,11 +290,81 @@ void DnarchModule::Bin2Dnarch(const std::string &inBinFile_, const std::string &
 		std::cout << "Stream sizes:\n";
 		for (uint32 i = 0; i < ss.size(); ++i)
 			std::cout << streamNames[i] << " : " << ss[i] << '\n';
+		std::cout << "Training blocks : " << dnarch->TrainingBlocksNum() << '\n';
+
+		if (models.HasSelectedCodecs())
+		{
+			std::cout << "Selected codecs:\n";
+			for (uint32 i = DnaCompressedBin::PPMdStartBuffer; i <= DnaCompressedBin::PPMdEndBuffer; ++i)
+				std::cout << streamNames[i] << " : " << StreamCodecRegistry::Name(models.GetSelectedCodec(i)) << '\n';
+		}
 		std::cout << std::endl;
 	}
 
 	delete dnarch;
-	delete extractor;
+}
+
+
+void DnarchModule::CompressStdBins(BinFileExtractor* extractor_, const MinimizerParameters& minParams_, const CompressorParams& params_,
+								   DnaCompressor& compressor_, DnarchFileWriter* dnarch_, bool untilTrained_)
+{
+	DnaPacker packer(minParams_);
+	DnaStreamModels* models = compressor_.GetStreamModels();
+	ASSERT(models != NULL);
+
+	uint32 minId = 0;
+
+	CompressedDnaBlock compBin;
+	BinaryBinBlock binBin;
+
+	DnaBinSplitter splitter(minParams_);
+	DnaBinCollection segmentBins;
+	std::vector<uint64> segmentSizes;
+
+	while (!(untilTrained_ && models->IsTrained()) && extractor_->ExtractNextStdBin(binBin, minId))
+	{
+		if (binBin.metaSize == 0)
+			continue;
+
+		packer.UnpackFromBin(binBin, compBin.workBuffers.dnaBin, minId, compBin.workBuffers.dnaBuffer);
+
+		ASSERT(binBin.rawDnaSize > 0);
+		const uint32 segmentsNum = params_.BinSegmentsNum(binBin.rawDnaSize);
+		if (segmentsNum == 1)
+		{
+			compressor_.CompressDna(compBin.workBuffers.dnaBin, minId, binBin.rawDnaSize, compBin.workBuffers.dnaWorkBin, compBin);
+
+			dnarch_->WriteNextBin(&compBin);
+		}
+		else
+		{
+			splitter.Split(compBin.workBuffers.dnaBin, segmentsNum, segmentBins, segmentSizes);
+
+			for (uint32 i = 0; i < segmentsNum; ++i)
+			{
+				if (segmentSizes[i] == 0)
+					continue;
+
+				compressor_.CompressDna(segmentBins[i], minId, segmentSizes[i], compBin.workBuffers.dnaWorkBin, compBin);
+
+				dnarch_->WriteNextBin(&compBin);
+			}
+		}
+
+		// the blocks written so far become the training blocks
+		//
+		if (!models->IsTrained())
+		{
+			models->NextTrainingBin();
+			if (models->IsTrainingComplete())
+			{
+				if (params_.streamCodecsTrial)
+					compressor_.SelectStreamCodecs();
+				compressor_.TrainStreamModels();
+				dnarch_->SetTrainingBlocks(models->TrainingSizeLog());
+			}
+		}
+	}
 }
 
 
@@ -295,18 +373,33 @@ void DnarchModule::Dnarch2Dna(const std::string &inDnarchFile_, const std::strin
 {
 	DnarchFileReader* dnarch = new DnarchFileReader();
 	MinimizerParameters minParams;
+	DnaCodingParams codingParams;
 
-	dnarch->StartDecompress(inDnarchFile_, minParams);
+	dnarch->StartDecompress(inDnarchFile_, minParams, codingParams);
 	FileStreamWriter* dnaFile = new FileStreamWriter(outDnaFile_);
 
+	DnaStreamModels models(dnarch->TrainingSizeLog());
+
 	if (threadsNum_ > 1)
 	{
+		// decompress the training blocks and train the stream models used by the workers
+		//
+		if (dnarch->HasStreamModels())
+		{
+			DnaDecompressor compressor(minParams, codingParams);
+			compressor.SetStreamModels(&models);
+
+			DecompressBlocks(dnarch, compressor, dnaFile, dnarch->TrainingBlocksNum());
+		}
+
+		DnaStreamModels* workerModels = models.IsTrained() ? &models : NULL;
+
 		const uint32 partNum = threadsNum_ * 2;
 		const uint64 inBufferSize = 1 << 25;
 		const uint64 outBufferSize = 1 << 23;
 
 		CompressedDnaPartsPool* inPool = new CompressedDnaPartsPool(partNum, inBufferSize);
-		CompressedDnaPartsQueue* inQueue = new CompressedDnaPartsQueue(partNum, 1);
+		CompressedDnaPartsQueue* inQueue = new CompressedDnaPartsQueue(partNum, 1, CompressedDnaPartsQueue::UnorderedDelivery);
 
 		RawDnaPartsPool* outPool = new RawDnaPartsPool(partNum, outBufferSize);
 		RawDnaPartsQueue* outQueue = new RawDnaPartsQueue(partNum, threadsNum_);
@@ -326,9 +419,9 @@ void DnarchModule::Dnarch2Dna(const std::string &inDnarchFile_, const std::strin
 
 		for (uint32 i = 0; i < threadsNum_; ++i)
 		{
-			operators[i] = new DnaPartsDecompressor(minParams,
+			operators[i] = new DnaPartsDecompressor(minParams, codingParams,
 													inQueue, inPool,
-													outQueue, outPool);
+													outQueue, outPool, workerModels);
 			opThreadGroup.create_thread(mt::ref(*operators[i]));
 		}
 
@@ -342,9 +435,9 @@ void DnarchModule::Dnarch2Dna(const std::string &inDnarchFile_, const std::strin
 
 		for (uint32 i = 0; i < threadsNum_; ++i)
 		{
-			operators[i] = new DnaPartsDecompressor(minParams,
+			operators[i] = new DnaPartsDecompressor(minParams, codingParams,
 												  inQueue, inPool,
-												  outQueue, outPool);
+												  outQueue, outPool, workerModels);
 			opThreadGroup.push_back(mt::thread(mt::ref(*operators[i])));
 		}
 
@@ -375,20 +468,135 @@ void DnarchModule::Dnarch2Dna(const std::string &inDnarchFile_, const std::strin
 	else
 	{
 
-		DnaDecompressor compressor(minParams);
-		CompressedDnaBlock compBlock;
-		DnaParser parser;
+		DnaDecompressor compressor(minParams, codingParams);
+		if (dnarch->HasStreamModels())
+			compressor.SetStreamModels(&models);
 
-		DataChunk dnaChunk;
+		DecompressBlocks(dnarch, compressor, dnaFile, (uint64)-1);
+	}
+
+	dnarch->FinishDecompress();
+	dnaFile->Close();
+
+	delete dnaFile;
+	delete dnarch;
+}
+
+
+void DnarchModule::DecompressBlocks(DnarchFileReader* dnarch_, DnaDecompressor& compressor_, FileStreamWriter* dnaFile_,
+									uint64 blocksNum_)
+{
+	CompressedDnaBlock compBlock;
+	DataChunk dnaChunk;
+
+	DnaStreamModels* models = compressor_.GetStreamModels();
+	uint64 blockIdx = 0;
+
+	while (blockIdx < blocksNum_ && dnarch_->ReadNextBin(&compBlock))
+	{
+		compressor_.DecompressDna(compBlock, compBlock.workBuffers.dnaBin,
+								  compBlock.workBuffers.dnaWorkBin, dnaChunk);
+
+		dnaFile_->Write(dnaChunk.data.Pointer(), dnaChunk.size);
+		blockIdx++;
+
+		// train the stream models after the last training block
+		//
+		if (models != NULL && blockIdx == dnarch_->TrainingBlocksNum())
+			compressor_.TrainStreamModels();
+	}
+}
+
+
+void DnarchModule::ExtractDna(const std::string &inDnarchFile_, const std::string &outDnaFile_,
+							  int64 signature_, uint64 recordsNum_, bool verboseMode_)
+{
+	DnarchFileReader* dnarch = new DnarchFileReader();
+	MinimizerParameters minParams;
+	DnaCodingParams codingParams;
+
+	dnarch->StartDecompress(inDnarchFile_, minParams, codingParams);
+
+	if (signature_ != AllSignatures && !dnarch->HasBlockIndex())
+	{
+		dnarch->FinishDecompress();
+		delete dnarch;
+		throw Exception("Archive does not contain the block index.");
+	}
 
-		while (dnarch->ReadNextBin(&compBlock))
+	if (signature_ != AllSignatures && signature_ > (int64)minParams.TotalMinimizersCount())
+	{
+		dnarch->FinishDecompress();
+		delete dnarch;
+		throw Exception("Invalid signature.");
+	}
+
+	if (verboseMode_ && dnarch->HasBlockIndex())
+	{
+		const std::vector<DnarchFileReader::BlockIndexEntry>& index = dnarch->GetBlockIndex();
+
+		std::cout << "Blocks (signature : records, raw size, compressed size):\n";
+		for (uint32 i = 0; i < index.size(); ++i)
 		{
-			compressor.DecompressDna(compBlock, compBlock.workBuffers.dnaBin,
-									 compBlock.workBuffers.dnaWorkBin, compBlock.workBuffers.dnaBuffer);
-			parser.ParseTo(compBlock.workBuffers.dnaBin, dnaChunk);
+			if (signature_ == AllSignatures || index[i].signature == signature_)
+				std::cout << index[i].signature << " : " << index[i].recordsCount << ", "
+						  << index[i].rawDnaSize << ", " << index[i].size << '\n';
+		}
+	}
 
-			dnaFile->Write(dnaChunk.data.Pointer(), dnaChunk.size);
+	FileStreamWriter* dnaFile = new FileStreamWriter(outDnaFile_);
+
+	DnaDecompressor compressor(minParams, codingParams);
+	CompressedDnaBlock compBlock;
+	DataChunk dnaChunk;
+
+	DnaStreamModels models(dnarch->TrainingSizeLog());
+	if (dnarch->HasStreamModels())
+		compressor.SetStreamModels(&models);
+
+	const uint32 trainingBlocksNum = dnarch->HasStreamModels() ? dnarch->TrainingBlocksNum() : 0;
+	uint64 blockIdx = 0;
+
+	uint64 recordsLeft = (recordsNum_ != 0) ? recordsNum_ : (uint64)-1;
+	while (recordsLeft > 0)
+	{
+		// the training blocks are decompressed regardless of their signature
+		//
+		const bool isTrainingBlock = blockIdx < trainingBlocksNum;
+		const bool hasBlock = (signature_ == AllSignatures || isTrainingBlock) ? dnarch->ReadNextBin(&compBlock)
+																			   : dnarch->ReadBin((uint32)signature_, &compBlock);
+		if (!hasBlock)
+			break;
+
+		compressor.DecompressDna(compBlock, compBlock.workBuffers.dnaBin,
+								 compBlock.workBuffers.dnaWorkBin, dnaChunk);
+
+		if (isTrainingBlock)
+		{
+			const uint32 signature = dnarch->HasBlockIndex() ? dnarch->GetBlockIndex()[blockIdx].signature : 0;
+
+			if (++blockIdx == trainingBlocksNum)
+				compressor.TrainStreamModels();
+
+			if (signature_ != AllSignatures && signature != signature_)
+				continue;
 		}
+
+		// the reads are stored one after another, hence the output can be just cut
+		//
+		const DnaBin& dnaBin = compBlock.workBuffers.dnaBin;
+		if (dnaBin.Size() > recordsLeft)
+		{
+			const DnaRecord& last = dnaBin[recordsLeft - 1];
+			dnaChunk.size = (last.dna + last.len + 1) - (char*)dnaChunk.data.Pointer();
+			recordsLeft = 0;
+		}
+		else
+		{
+			recordsLeft -= dnaBin.Size();
+		}
+
+		dnaFile->Write(dnaChunk.data.Pointer(), dnaChunk.size);
 	}
 
 	dnarch->FinishDecompress();
@@ -14,14 +14,48 @@
 #include <string>
 
 #include "Params.h"
+#include "../orcom_bin/Params.h"
 
 
+class BinFileExtractor;
+class DnaCompressor;
+class DnaDecompressor;
+class DnarchFileWriter;
+class DnarchFileReader;
+class FileStreamWriter;
+
 class DnarchModule
 {
 public:
 	void Bin2Dnarch(const std::string& inBinFile_, const std::string& outDnarchFile_,
 					const CompressorParams& params_, uint32 threadsNum_ = 1, bool verboseMode_ = false);
+
+	// compresses the bins of an already started extractor, finishing it
+	//
+	void Bin2Dnarch(BinFileExtractor* extractor_, const BinModuleConfig& binConfig_, const std::string& outDnarchFile_,
+					const CompressorParams& params_, uint32 threadsNum_ = 1, bool verboseMode_ = false);
 	void Dnarch2Dna(const std::string& inDnarchFile_, const std::string& outDnaFile_, uint32 threadsNum_ = 1);
+
+	// decompresses only the blocks of the selected signature (all if AllSignatures) and at
+	// most recordsNum_ reads (all if 0) -- uses the archive block index
+	//
+	static const int64 AllSignatures = -1;
+
+	void ExtractDna(const std::string& inDnarchFile_, const std::string& outDnaFile_,
+					int64 signature_ = AllSignatures, uint64 recordsNum_ = 0, bool verboseMode_ = false);
+
+private:
+	// compresses the std bins until the compressor's stream models are trained if
+	// untilTrained_ is set, all of them otherwise
+	//
+	void CompressStdBins(BinFileExtractor* extractor_, const MinimizerParameters& minParams_, const CompressorParams& params_,
+						 DnaCompressor& compressor_, DnarchFileWriter* dnarch_, bool untilTrained_);
+
+	// decompresses at most blocksNum_ next blocks, training the decompressor's stream models
+	// after the last training block
+	//
+	void DecompressBlocks(DnarchFileReader* dnarch_, DnaDecompressor& compressor_, FileStreamWriter* dnaFile_,
+						  uint64 blocksNum_);
 };
 
 
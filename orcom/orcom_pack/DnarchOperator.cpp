@@ -8,18 +8,26 @@
 
 #include "../orcom_bin/Globals.h"
 
+#include <map>
+
 #include "DnarchOperator.h"
 #include "BinFileExtractor.h"
 #include "DnarchFile.h"
 #include "DnaCompressor.h"
 #include "../orcom_bin/DnaPacker.h"
-#include "../orcom_bin/DnaParser.h"
 
 
 void BinPartsExtractor::Run()
 {
 	int64 partId = 0;
 
+	DnaPacker packer(minimizer);
+	DnaBinSplitter splitter(minimizer);
+	DnaBin dnaBin;
+	DataChunk dnaBuffer;
+	DnaBinCollection segmentBins;
+	std::vector<uint64> segmentSizes;
+
 	uint32 minId = 0;
 	MinimizerBinPart* part = NULL;
 	partsPool->Acquire(part);
@@ -30,10 +38,35 @@ void BinPartsExtractor::Run()
 			continue;
 
 		part->minimizer = minId;
-		partsQueue->Push(partId++, part);
 
-		part = NULL;
-		partsPool->Acquire(part);
+		const uint32 segmentsNum = params.BinSegmentsNum(part->rawDnaSize);
+		if (segmentsNum == 1)
+		{
+			partsQueue->Push(partId++, part);
+
+			part = NULL;
+			partsPool->Acquire(part);
+			continue;
+		}
+
+		// the giant bins are unpacked and split into segments here, once -- every segment is
+		// passed with only its own records and compressed by a separate worker
+		//
+		packer.UnpackFromBin(*part, dnaBin, minId, dnaBuffer);
+		splitter.Split(dnaBin, segmentsNum, segmentBins, segmentSizes);
+
+		for (uint32 i = 0; i < segmentsNum; ++i)
+		{
+			if (segmentSizes[i] == 0)
+				continue;
+
+			MinimizerBinPart* segPart = NULL;
+			partsPool->Acquire(segPart);
+
+			segPart->minimizer = minId;
+			segPart->StoreSegment(segmentBins[i], segmentSizes[i]);
+			partsQueue->Push(partId++, segPart);
+		}
 	}
 	partsPool->Release(part);
 
@@ -47,31 +80,50 @@ void BinPartsCompressor::Run()
 
 	DnaPacker packer(minimizer);
 	DnaCompressor compressor(minimizer, params);
+	compressor.SetStreamModels(streamModels);
 
+	// the output part is acquired before taking the next input part -- the writer can hold
+	// the pool parts completed ahead of their turn, but the part it waits for, popped
+	// earlier, has always got its output part then
+	//
 	MinimizerBinPart* inPart = NULL;
+	CompressedDnaBlock* outPart = NULL;
+	outPartsPool->Acquire(outPart);
+
 	while (inPartsQueue->Pop(partId, inPart))
 	{
-		ASSERT(inPart->metaSize > 0);
-		ASSERT(inPart->dnaSize > 0);
 		ASSERT(inPart->rawDnaSize > 0);
 
 		const uint32 minimizer = inPart->minimizer;
+		const uint64 rawDnaSize = inPart->rawDnaSize;
 
-		CompressedDnaBlock* outPart = NULL;
-		outPartsPool->Acquire(outPart);
+		if (inPart->IsSegment())
+		{
+			compressor.CompressDna(inPart->segmentBin, minimizer, rawDnaSize, outPart->workBuffers.dnaWorkBin, *outPart);
 
-		outPart->workBuffers.dnaBin.Reset();
+			inPartsPool->Release(inPart);
+			inPart = NULL;
+		}
+		else
+		{
+			ASSERT(inPart->metaSize > 0);
+			ASSERT(inPart->dnaSize > 0);
 
-		packer.UnpackFromBin(*inPart, outPart->workBuffers.dnaBin, minimizer, outPart->workBuffers.dnaBuffer);
+			outPart->workBuffers.dnaBin.Reset();
+			packer.UnpackFromBin(*inPart, outPart->workBuffers.dnaBin, minimizer, outPart->workBuffers.dnaBuffer);
 
-		const uint64 rawDnaSize = inPart->rawDnaSize;
-		inPartsPool->Release(inPart);
-		inPart = NULL;
+			inPartsPool->Release(inPart);
+			inPart = NULL;
 
-		compressor.CompressDna(outPart->workBuffers.dnaBin, minimizer, rawDnaSize, outPart->workBuffers.dnaWorkBin, *outPart);
+			compressor.CompressDna(outPart->workBuffers.dnaBin, minimizer, rawDnaSize, outPart->workBuffers.dnaWorkBin, *outPart);
+		}
 
 		outPartsQueue->Push(partId, outPart);
+
+		outPart = NULL;
+		outPartsPool->Acquire(outPart);
 	}
+	outPartsPool->Release(outPart);
 
 	outPartsQueue->SetCompleted();
 }
@@ -80,15 +132,67 @@ void BinPartsCompressor::Run()
 void DnarchPartsWriter::Run()
 {
 	int64 partId = 0;
+	int64 nextPartId = 0;
+	uint64 pendingSize = 0;
 	CompressedDnaBlock* part = NULL;
+	std::map<int64, PendingPart*> pendingParts;
 
 	while (partsQueue->Pop(partId, part))
 	{
-		partsStream->WriteNextBin(part);
+		if (partId != nextPartId)
+		{
+			ASSERT(partId > nextPartId);
+
+			if (pendingSize + part->dataBuffer.size <= maxPendingSize)
+			{
+				pendingParts[partId] = new PendingPart(*part);
+				pendingSize += part->dataBuffer.size;
+
+				partsPool->Release(part);
+			}
+			else
+			{
+				pendingParts[partId] = new PendingPart(part);
+			}
+			part = NULL;
+			continue;
+		}
 
+		partsStream->WriteNextBin(part);
 		partsPool->Release(part);
 		part = NULL;
+		nextPartId++;
+
+		// flush the parts which are now in order
+		//
+		std::map<int64, PendingPart*>::iterator i = pendingParts.begin();
+		while (i != pendingParts.end() && i->first == nextPartId)
+		{
+			if (i->second->dataBuffer != NULL)
+				pendingSize -= i->second->dataBuffer->size;
+			WritePart(i->second);
+
+			pendingParts.erase(i++);
+			nextPartId++;
+		}
+	}
+
+	ASSERT(pendingParts.empty());
+}
+
+
+void DnarchPartsWriter::WritePart(PendingPart* part_)
+{
+	if (part_->part != NULL)
+	{
+		partsStream->WriteNextBin(part_->part);
+		partsPool->Release(part_->part);
 	}
+	else
+	{
+		partsStream->WriteNextBin(*part_->dataBuffer, part_->bufferSizes);
+	}
+	delete part_;
 }
 
 
@@ -115,8 +219,8 @@ void DnarchPartsReader::Run()
 
 void DnaPartsDecompressor::Run()
 {
-	DnaDecompressor compressor(minimizer);
-	DnaParser parser;
+	DnaDecompressor compressor(minimizer, codingParams);
+	compressor.SetStreamModels(streamModels);
 
 	int64 partId = 0;
 	InPartType* inPart = NULL;
@@ -126,9 +230,7 @@ void DnaPartsDecompressor::Run()
 		OutPartType* outPart = NULL;
 		outPartsPool->Acquire(outPart);
 
-		compressor.DecompressDna(*inPart, inPart->workBuffers.dnaBin, inPart->workBuffers.dnaWorkBin, inPart->workBuffers.dnaBuffer);
-
-		parser.ParseTo(inPart->workBuffers.dnaBin, *outPart);		// TODO: refactor, skip this step
+		compressor.DecompressDna(*inPart, inPart->workBuffers.dnaBin, inPart->workBuffers.dnaWorkBin, *outPart);
 		outPartsQueue->Push(partId, outPart);
 
 		inPartsPool->Release(inPart);
@@ -19,15 +19,25 @@
 #include "DnarchFile.h"
 
 
+class DnaStreamModels;
+
+
 // operators for multi threaded processing
 //
 struct MinimizerBinPart : public BinaryBinBlock
 {
 	uint32 minimizer;
 
+	// a segment of a split bin is passed already unpacked, holding only its own records,
+	// the binary data is empty then
+	//
+	DnaBin segmentBin;
+	DataChunk segmentDna;
+
 	MinimizerBinPart(uint64 dnaBufferSize_ = 1 << 20, uint64 metaBufferSize_ = 1 << 16)
 		:	BinaryBinBlock(dnaBufferSize_, metaBufferSize_)
 		,	minimizer(0)
+		,	segmentDna(BinaryBinBlock::DefaultDnaBufferSize)
 	{}
 
 	void Reset()
@@ -36,6 +46,40 @@ struct MinimizerBinPart : public BinaryBinBlock
 
 		metaSize = 0;
 		dnaSize = 0;
+
+		segmentBin.Clear();
+		segmentDna.size = 0;
+	}
+
+	bool IsSegment() const
+	{
+		return segmentBin.Size() > 0;
+	}
+
+	// stores a copy of the segment's records
+	//
+	void StoreSegment(const DnaBin& segmentBin_, uint64 segmentSize_)
+	{
+		BinaryBinBlock::Reset();
+		descriptors.clear();
+
+		if (segmentDna.data.Size() < segmentSize_)
+			segmentDna.data.Extend(segmentSize_);
+
+		char* dna = (char*)segmentDna.data.Pointer();
+		segmentBin.Clear();
+		for (uint64 i = 0; i < segmentBin_.Size(); ++i)
+		{
+			DnaRecord r = segmentBin_[i];
+			std::copy(r.dna, r.dna + r.len, dna);
+			r.dna = dna;
+			dna += r.len;
+
+			segmentBin.Insert(r);
+		}
+
+		segmentDna.size = segmentSize_;
+		rawDnaSize = segmentSize_;
 	}
 };
 
@@ -53,8 +97,11 @@ typedef TDataQueue<RawDnaPart> RawDnaPartsQueue;
 class BinPartsExtractor : public IOperator
 {
 public:
-	BinPartsExtractor(BinFileExtractor* partsStream_, MinimizerPartsQueue* partsQueue_, MinimizerPartsPool* partsPool_)
-		:	partsStream(partsStream_)
+	BinPartsExtractor(const MinimizerParameters& minimizer_, const CompressorParams& params_,
+					  BinFileExtractor* partsStream_, MinimizerPartsQueue* partsQueue_, MinimizerPartsPool* partsPool_)
+		:	minimizer(minimizer_)
+		,	params(params_)
+		,	partsStream(partsStream_)
 		,	partsQueue(partsQueue_)
 		,	partsPool(partsPool_)
 	{}
@@ -62,6 +109,9 @@ public:
 	void Run();
 
 private:
+	const MinimizerParameters minimizer;
+	const CompressorParams params;
+
 	BinFileExtractor* partsStream;
 	MinimizerPartsQueue* partsQueue;
 	MinimizerPartsPool* partsPool;
@@ -73,13 +123,15 @@ class BinPartsCompressor : public IOperator
 public:
 	BinPartsCompressor(const MinimizerParameters& minimizer_, const CompressorParams& params_,
 					   MinimizerPartsQueue* inPartsQueue_, MinimizerPartsPool* inPartsPool_,
-					   CompressedDnaPartsQueue* outPartsQueue_, CompressedDnaPartsPool* outPartsPool_)
+					   CompressedDnaPartsQueue* outPartsQueue_, CompressedDnaPartsPool* outPartsPool_,
+					   DnaStreamModels* streamModels_ = NULL)
 		:	minimizer(minimizer_)
 		,	params(params_)
 		,	inPartsQueue(inPartsQueue_)
 		,	inPartsPool(inPartsPool_)
 		,	outPartsQueue(outPartsQueue_)
 		,	outPartsPool(outPartsPool_)
+		,	streamModels(streamModels_)
 	{}
 
 	void Run();
@@ -92,24 +144,65 @@ protected:
 	MinimizerPartsPool* inPartsPool;
 	CompressedDnaPartsQueue* outPartsQueue;
 	CompressedDnaPartsPool* outPartsPool;
+
+	DnaStreamModels* streamModels;			// trained, shared by the workers
 };
 
 
+// writes the compressed parts in the order of their ids -- the parts completed ahead of
+// their turn are copied aside and returned to the pool immediately, as long as the copies
+// fit within maxPendingSize. Above it the pool parts themselves are kept until written,
+// so the workers wait for the free parts and the reordering window stays bounded
+//
 class DnarchPartsWriter : public IOperator
 {
 public:
-	DnarchPartsWriter(DnarchFileWriter* partsStream_, CompressedDnaPartsQueue* partsQueue_, CompressedDnaPartsPool* partsPool_)
+	static const uint64 DefaultMaxPendingSize = 64 << 20;
+
+	DnarchPartsWriter(DnarchFileWriter* partsStream_, CompressedDnaPartsQueue* partsQueue_, CompressedDnaPartsPool* partsPool_,
+					  uint64 maxPendingSize_ = DefaultMaxPendingSize)
 		:	partsStream(partsStream_)
 		,	partsQueue(partsQueue_)
 		,	partsPool(partsPool_)
+		,	maxPendingSize(maxPendingSize_)
 	{}
 
 	void Run();
 
 private:
+	struct PendingPart
+	{
+		CompressedDnaBlock* part;			// the kept pool part, or NULL if copied
+		DataChunk* dataBuffer;
+		uint64 bufferSizes[CompressedDnaBlock::BuffersCount];
+
+		PendingPart(CompressedDnaBlock* part_)
+			:	part(part_)
+			,	dataBuffer(NULL)
+		{}
+
+		PendingPart(const CompressedDnaBlock& part_)
+			:	part(NULL)
+			,	dataBuffer(new DataChunk(part_.dataBuffer.size))
+		{
+			std::copy(part_.dataBuffer.data.Pointer(), part_.dataBuffer.data.Pointer() + part_.dataBuffer.size,
+					  dataBuffer->data.Pointer());
+			dataBuffer->size = part_.dataBuffer.size;
+			std::copy(part_.bufferSizes, part_.bufferSizes + CompressedDnaBlock::BuffersCount, bufferSizes);
+		}
+
+		~PendingPart()
+		{
+			TFREE(dataBuffer);
+		}
+	};
+
 	DnarchFileWriter* partsStream;
 	CompressedDnaPartsQueue* partsQueue;
 	CompressedDnaPartsPool* partsPool;
+	const uint64 maxPendingSize;
+
+	void WritePart(PendingPart* part_);
 };
 
 
@@ -136,14 +229,17 @@ private:
 class DnaPartsDecompressor : public IOperator
 {
 public:
-	DnaPartsDecompressor(const MinimizerParameters& minimizer_,
+	DnaPartsDecompressor(const MinimizerParameters& minimizer_, const DnaCodingParams& codingParams_,
 						 CompressedDnaPartsQueue* inPartsQueue_, CompressedDnaPartsPool* inPartsPool_,
-						 RawDnaPartsQueue* outPartsQueue_, RawDnaPartsPool* outPartsPool_)
+						 RawDnaPartsQueue* outPartsQueue_, RawDnaPartsPool* outPartsPool_,
+						 DnaStreamModels* streamModels_ = NULL)
 		:	minimizer(minimizer_)
+		,	codingParams(codingParams_)
 		,	inPartsQueue(inPartsQueue_)
 		,	inPartsPool(inPartsPool_)
 		,	outPartsQueue(outPartsQueue_)
 		,	outPartsPool(outPartsPool_)
+		,	streamModels(streamModels_)
 	{}
 
 	void Run();
@@ -153,11 +249,14 @@ protected:
 	typedef RawDnaPart OutPartType;
 
 	const MinimizerParameters minimizer;
+	const DnaCodingParams codingParams;
 
 	CompressedDnaPartsQueue* inPartsQueue;
 	CompressedDnaPartsPool* inPartsPool;
 	RawDnaPartsQueue* outPartsQueue;
 	RawDnaPartsPool* outPartsPool;
+
+	DnaStreamModels* streamModels;			// trained, shared by the workers
 };
 
 
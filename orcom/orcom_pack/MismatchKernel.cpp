@@ -0,0 +1,225 @@
+/*
+  This file is a part of ORCOM software distributed under GNU GPL 2 licence.
+  Homepage:	http://sun.aei.polsl.pl/orcom
+  Github:	http://github.com/lrog/orcom
+
+  Authors: Sebastian Deorowicz, Szymon Grabowski and Lucas Roguski
+*/
+
+#include "../orcom_bin/Globals.h"
+
+#include <algorithm>
+
+#include "MismatchKernel.h"
+
+#if MISMATCH_KERNEL_X86
+#	include <immintrin.h>
+#endif
+
+
+MismatchKernel::MismatchKernel(InstructionSet instrSet_)
+#if MISMATCH_KERNEL_X86
+	:	instrSet(instrSet_)
+#else
+	:	instrSet(InstrScalar)
+#endif
+{}
+
+
+MismatchKernel::InstructionSet MismatchKernel::DetectInstructionSet()
+{
+#if MISMATCH_KERNEL_X86
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("popcnt"))
+		return InstrAvx2;
+	if (__builtin_cpu_supports("sse2"))
+		return InstrSse2;
+	return InstrScalar;
+#else
+	return InstrScalar;
+#endif
+}
+
+
+uint32 MismatchKernel::CountMismatches(const char* seq1_, const char* seq2_, uint32 len_, int32 limit_) const
+{
+	if (limit_ <= 0)
+		return 0;
+
+#if MISMATCH_KERNEL_X86
+	if (instrSet == InstrAvx2)
+		return CountMismatchesAvx2(seq1_, seq2_, len_, limit_);
+	if (instrSet == InstrSse2)
+		return CountMismatchesSse2(seq1_, seq2_, len_, limit_);
+#endif
+
+	return CountMismatchesScalar(seq1_, seq2_, len_, limit_);
+}
+
+
+uint32 MismatchKernel::FindMismatch(const char* seq1_, const char* seq2_, uint32 len_) const
+{
+#if MISMATCH_KERNEL_X86
+	if (instrSet == InstrAvx2)
+		return FindMismatchAvx2(seq1_, seq2_, len_);
+	if (instrSet == InstrSse2)
+		return FindMismatchSse2(seq1_, seq2_, len_);
+#endif
+
+	uint32 i = 0;
+	while (i < len_ && seq1_[i] == seq2_[i])
+		i++;
+	return i;
+}
+
+
+void MismatchKernel::ComputeMismatchMask(const char* seq1_, const char* seq2_, uint32 len_, uint64* mask_) const
+{
+	ASSERT(len_ <= DnaRecord::MaxDnaLen);
+
+#if MISMATCH_KERNEL_X86
+	if (instrSet == InstrAvx2)
+	{
+		ComputeMismatchMaskAvx2(seq1_, seq2_, len_, mask_);
+		return;
+	}
+	if (instrSet == InstrSse2)
+	{
+		ComputeMismatchMaskSse2(seq1_, seq2_, len_, mask_);
+		return;
+	}
+#endif
+
+	std::fill(mask_, mask_ + (len_ + 63) / 64, 0);
+	for (uint32 i = 0; i < len_; ++i)
+		mask_[i / 64] |= (uint64)(seq1_[i] != seq2_[i]) << (i % 64);
+}
+
+
+uint32 MismatchKernel::CountMismatchesScalar(const char* seq1_, const char* seq2_, uint32 len_, uint32 limit_)
+{
+	uint32 v = 0;
+	for (uint32 i = 0; i < len_ && v < limit_; ++i)
+		v += (seq1_[i] != seq2_[i]);
+	return v;
+}
+
+
+#if MISMATCH_KERNEL_X86
+
+// The vectorized variants compare whole vectors of symbols, turning the result into a bit
+// mask of the mismatching positions -- the cutoff is checked once per vector, hence the
+// final count is clamped to the limit. The remaining tail is processed by the scalar code.
+//
+uint32 MismatchKernel::CountMismatchesSse2(const char* seq1_, const char* seq2_, uint32 len_, uint32 limit_)
+{
+	uint32 v = 0;
+	uint32 i = 0;
+
+	for ( ; i + 16 <= len_ && v < limit_; i += 16)
+	{
+		const __m128i s1 = _mm_loadu_si128((const __m128i*)(seq1_ + i));
+		const __m128i s2 = _mm_loadu_si128((const __m128i*)(seq2_ + i));
+		const uint32 mask = ~_mm_movemask_epi8(_mm_cmpeq_epi8(s1, s2)) & 0xFFFF;
+		v += __builtin_popcount(mask);
+	}
+
+	if (v >= limit_)
+		return limit_;
+
+	return v + CountMismatchesScalar(seq1_ + i, seq2_ + i, len_ - i, limit_ - v);
+}
+
+
+uint32 MismatchKernel::FindMismatchSse2(const char* seq1_, const char* seq2_, uint32 len_)
+{
+	uint32 i = 0;
+	for ( ; i + 16 <= len_; i += 16)
+	{
+		const __m128i s1 = _mm_loadu_si128((const __m128i*)(seq1_ + i));
+		const __m128i s2 = _mm_loadu_si128((const __m128i*)(seq2_ + i));
+		const uint32 mask = ~_mm_movemask_epi8(_mm_cmpeq_epi8(s1, s2)) & 0xFFFF;
+		if (mask != 0)
+			return i + __builtin_ctz(mask);
+	}
+
+	while (i < len_ && seq1_[i] == seq2_[i])
+		i++;
+	return i;
+}
+
+
+void MismatchKernel::ComputeMismatchMaskSse2(const char* seq1_, const char* seq2_, uint32 len_, uint64* mask_)
+{
+	std::fill(mask_, mask_ + (len_ + 63) / 64, 0);
+
+	uint32 i = 0;
+	for ( ; i + 16 <= len_; i += 16)
+	{
+		const __m128i s1 = _mm_loadu_si128((const __m128i*)(seq1_ + i));
+		const __m128i s2 = _mm_loadu_si128((const __m128i*)(seq2_ + i));
+		const uint64 mask = ~_mm_movemask_epi8(_mm_cmpeq_epi8(s1, s2)) & 0xFFFF;
+		mask_[i / 64] |= mask << (i % 64);
+	}
+
+	for ( ; i < len_; ++i)
+		mask_[i / 64] |= (uint64)(seq1_[i] != seq2_[i]) << (i % 64);
+}
+
+
+uint32 MismatchKernel::CountMismatchesAvx2(const char* seq1_, const char* seq2_, uint32 len_, uint32 limit_)
+{
+	uint32 v = 0;
+	uint32 i = 0;
+
+	for ( ; i + 32 <= len_ && v < limit_; i += 32)
+	{
+		const __m256i s1 = _mm256_loadu_si256((const __m256i*)(seq1_ + i));
+		const __m256i s2 = _mm256_loadu_si256((const __m256i*)(seq2_ + i));
+		const uint32 mask = ~(uint32)_mm256_movemask_epi8(_mm256_cmpeq_epi8(s1, s2));
+		v += __builtin_popcount(mask);
+	}
+
+	if (v >= limit_)
+		return limit_;
+
+	return v + CountMismatchesScalar(seq1_ + i, seq2_ + i, len_ - i, limit_ - v);
+}
+
+
+uint32 MismatchKernel::FindMismatchAvx2(const char* seq1_, const char* seq2_, uint32 len_)
+{
+	uint32 i = 0;
+	for ( ; i + 32 <= len_; i += 32)
+	{
+		const __m256i s1 = _mm256_loadu_si256((const __m256i*)(seq1_ + i));
+		const __m256i s2 = _mm256_loadu_si256((const __m256i*)(seq2_ + i));
+		const uint32 mask = ~(uint32)_mm256_movemask_epi8(_mm256_cmpeq_epi8(s1, s2));
+		if (mask != 0)
+			return i + __builtin_ctz(mask);
+	}
+
+	while (i < len_ && seq1_[i] == seq2_[i])
+		i++;
+	return i;
+}
+
+
+void MismatchKernel::ComputeMismatchMaskAvx2(const char* seq1_, const char* seq2_, uint32 len_, uint64* mask_)
+{
+	std::fill(mask_, mask_ + (len_ + 63) / 64, 0);
+
+	uint32 i = 0;
+	for ( ; i + 32 <= len_; i += 32)
+	{
+		const __m256i s1 = _mm256_loadu_si256((const __m256i*)(seq1_ + i));
+		const __m256i s2 = _mm256_loadu_si256((const __m256i*)(seq2_ + i));
+		const uint64 mask = ~(uint32)_mm256_movemask_epi8(_mm256_cmpeq_epi8(s1, s2));
+		mask_[i / 64] |= mask << (i % 64);
+	}
+
+	for ( ; i < len_; ++i)
+		mask_[i / 64] |= (uint64)(seq1_[i] != seq2_[i]) << (i % 64);
+}
+
+#endif
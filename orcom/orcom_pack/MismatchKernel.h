@@ -0,0 +1,88 @@
+/*
+  This file is a part of ORCOM software distributed under GNU GPL 2 licence.
+  Homepage:	http://sun.aei.polsl.pl/orcom
+  Github:	http://github.com/lrog/orcom
+
+  Authors: Sebastian Deorowicz, Szymon Grabowski and Lucas Roguski
+*/
+
+#ifndef H_MISMATCHKERNEL
+#define H_MISMATCHKERNEL
+
+#include "../orcom_bin/Globals.h"
+
+#include "../orcom_bin/DnaRecord.h"
+
+
+// compares two reads symbol by symbol -- the vectorized (SSE2 / AVX2) variants process
+// 16 / 32 symbols at once and are selected at runtime depending on the CPU, giving exactly
+// the same results as the scalar ones
+//
+class MismatchKernel
+{
+public:
+	enum InstructionSet
+	{
+		InstrScalar = 0,
+		InstrSse2,
+		InstrAvx2
+	};
+
+	static const uint32 MaskWordsNum = (DnaRecord::MaxDnaLen + 63) / 64;
+
+	MismatchKernel(InstructionSet instrSet_ = DetectInstructionSet());
+
+	static InstructionSet DetectInstructionSet();
+
+	InstructionSet GetInstructionSet() const
+	{
+		return instrSet;
+	}
+
+	// counts the mismatches on the first len_ positions, stopping as soon as limit_ of them
+	// are found -- the result is never greater than limit_ (and is 0 for a non-positive one)
+	//
+	uint32 CountMismatches(const char* seq1_, const char* seq2_, uint32 len_, int32 limit_) const;
+
+	// returns the position of the first mismatch or len_ if the sequences are equal
+	//
+	uint32 FindMismatch(const char* seq1_, const char* seq2_, uint32 len_) const;
+
+	// sets the i-th bit (LSB-first in 64-bit words) of mask_ if the sequences differ at i-th
+	// position, the mask needs to hold at least (len_ + 63) / 64 words
+	//
+	void ComputeMismatchMask(const char* seq1_, const char* seq2_, uint32 len_, uint64* mask_) const;
+
+	static bool IsMismatch(const uint64* mask_, uint32 i_)
+	{
+		return ((mask_[i_ / 64] >> (i_ % 64)) & 1) != 0;
+	}
+
+private:
+	const InstructionSet instrSet;
+
+	static uint32 CountMismatchesScalar(const char* seq1_, const char* seq2_, uint32 len_, uint32 limit_);
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#	define MISMATCH_KERNEL_X86 1
+
+	__attribute__((target("sse2")))
+	static uint32 CountMismatchesSse2(const char* seq1_, const char* seq2_, uint32 len_, uint32 limit_);
+	__attribute__((target("sse2")))
+	static uint32 FindMismatchSse2(const char* seq1_, const char* seq2_, uint32 len_);
+	__attribute__((target("sse2")))
+	static void ComputeMismatchMaskSse2(const char* seq1_, const char* seq2_, uint32 len_, uint64* mask_);
+
+	__attribute__((target("avx2,popcnt")))
+	static uint32 CountMismatchesAvx2(const char* seq1_, const char* seq2_, uint32 len_, uint32 limit_);
+	__attribute__((target("avx2,popcnt")))
+	static uint32 FindMismatchAvx2(const char* seq1_, const char* seq2_, uint32 len_);
+	__attribute__((target("avx2,popcnt")))
+	static void ComputeMismatchMaskAvx2(const char* seq1_, const char* seq2_, uint32 len_, uint64* mask_);
+#else
+#	define MISMATCH_KERNEL_X86 0
+#endif
+};
+
+
+#endif // H_MISMATCHKERNEL
@@ -12,19 +12,103 @@
 #include "../orcom_bin/Globals.h"
 
 
+// the parameters of the streams coding the decompressor has to use as well, set by the
+// compression level and stored in the archive
+//
+struct DnaCodingParams
+{
+	enum Levels
+	{
+		FastLevel = 1,
+		DefaultLevel,
+		MaxLevel
+	};
+
+	static const uint32 StoredSize = 5;
+	static const uint32 MaxLzBufferSize = 255;			// the LZ ids are coded as bytes
+	static const uint32 MinPpmdOrder = 2;
+	static const uint32 MaxPpmdOrder = 9;
+	static const uint32 MaxContextOrder = 4;			// the order the context coders are built for
+
+	uint8 level;
+	uint8 lzBufferSize;
+	uint8 ppmdOrder;
+	uint8 ppmdMemorySizeMb;
+	uint8 contextOrder;
+
+	DnaCodingParams()
+	{
+		SetLevel(DefaultLevel);
+	}
+
+	void SetLevel(uint32 level_)
+	{
+		static const uint8 presets[][4] = {
+		//	lzBuf	ppmdOrd	ppmdMb	ctxOrd
+			{64,	3,		8,		4},						// fast
+			{255,	4,		16,		4},						// default
+			{255,	4,		16,		4}						// max
+		};
+
+		ASSERT(level_ >= FastLevel && level_ <= MaxLevel);
+		const uint8* p = presets[level_ - FastLevel];
+
+		level = level_;
+		lzBufferSize = p[0];
+		ppmdOrder = p[1];
+		ppmdMemorySizeMb = p[2];
+		contextOrder = p[3];
+	}
+
+	bool IsValid() const
+	{
+		return level >= FastLevel && level <= MaxLevel
+				&& lzBufferSize > 0 && lzBufferSize <= MaxLzBufferSize
+				&& ppmdOrder >= MinPpmdOrder && ppmdOrder <= MaxPpmdOrder
+				&& ppmdMemorySizeMb > 0
+				&& contextOrder > 0 && contextOrder <= MaxContextOrder;
+	}
+};
+
+
 struct CompressorParams
 {
+	// the codecs of the byte streams (see StreamCodecRegistry), recorded per stream in the
+	// block header -- the ids are stored in the archives, hence only appended
+	//
+	enum StreamCodecs
+	{
+		PpmdStreamCodec = 0,			// the streams gathered and compressed with PPMd
+		ContextStreamCodec,				// range-coded on the fly with the binary context models
+		RawStreamCodec,					// stored as is
+		LzStreamCodec,					// deflate, if available in the build
+		PackedDnaStreamCodec,			// 2-bit packed bases, the hard reads only
+		StreamCodecsNum
+	};
+
 	static const int32 DefaultMaxCostValue = (uint16)-1;
 	static const int32 DefaultEncodeThresholdValue = 0;
 	static const int32 DefaultMismatchCost = 2;
 	static const int32 DefaultInsertCost = 1;
 	static const uint32 DefaultMinimumBinSize = 64;
+	static const uint32 DefaultSplitBinSize = 0;
+	static const uint32 MaxBinSegmentsNum = 64;
+	static const uint32 DefaultLzCandidatesNum = 0;
+	static const uint32 DefaultStreamCodec = ContextStreamCodec;
+	static const uint32 DefaultHardReadsCodec = PpmdStreamCodec;
+	static const bool DefaultStreamCodecsTrial = false;
 
 	int32 maxCostValue;
 	int32 encodeThresholdValue;
 	int32 mismatchCost;
 	int32 insertCost;
 	uint32 minBinSize;
+	uint32 splitBinSize;				// in MB, 0 - disabled
+	uint32 lzCandidatesNum;				// 0 - examine all
+	uint32 streamCodec;					// LzId, Shift, Len and Match streams
+	uint32 hardReadsCodec;
+	bool streamCodecsTrial;				// select the codecs on the training bins
+	DnaCodingParams coding;
 
 	CompressorParams()
 		:	maxCostValue(DefaultMaxCostValue)
@@ -32,7 +116,45 @@ struct CompressorParams
 		,	mismatchCost(DefaultMismatchCost)
 		,	insertCost(DefaultInsertCost)
 		,	minBinSize(DefaultMinimumBinSize)
+		,	splitBinSize(DefaultSplitBinSize)
+		,	lzCandidatesNum(DefaultLzCandidatesNum)
+		,	streamCodec(DefaultStreamCodec)
+		,	hardReadsCodec(DefaultHardReadsCodec)
+		,	streamCodecsTrial(DefaultStreamCodecsTrial)
 	{}
+
+	// sets the level presets, the explicit options are applied afterwards -- the effort
+	// grows with the level: the fast one examines fewer LZ candidates in a shorter buffer
+	// with the lower PPMd order, the max one adds the trial selection of the codecs
+	//
+	void SetLevel(uint32 level_)
+	{
+		static const uint32 presets[][4] = {
+		//	lzCand	stream					hardReads				trial
+			{8,		ContextStreamCodec,		PackedDnaStreamCodec,	false},		// fast
+			{0,		ContextStreamCodec,		PpmdStreamCodec,		false},		// default
+			{0,		ContextStreamCodec,		PpmdStreamCodec,		true}		// max
+		};
+
+		coding.SetLevel(level_);
+
+		const uint32* p = presets[level_ - DnaCodingParams::FastLevel];
+		lzCandidatesNum = p[0];
+		streamCodec = p[1];
+		hardReadsCodec = p[2];
+		streamCodecsTrial = p[3] != 0;
+	}
+
+	// number of independently compressed segments the bin will be split into
+	//
+	uint32 BinSegmentsNum(uint64 rawDnaSize_) const
+	{
+		if (splitBinSize == 0)
+			return 1;
+
+		const uint64 segmentSize = (uint64)splitBinSize << 20;
+		return (uint32)MIN((rawDnaSize_ + segmentSize - 1) / segmentSize, (uint64)MaxBinSegmentsNum);
+	}
 };
 
 
@@ -0,0 +1,327 @@
+/*
+  This file is a part of ORCOM software distributed under GNU GPL 2 licence.
+  Homepage:	http://sun.aei.polsl.pl/orcom
+  Github:	http://github.com/lrog/orcom
+
+  Authors: Sebastian Deorowicz, Szymon Grabowski and Lucas Roguski
+*/
+
+#include "../orcom_bin/Globals.h"
+
+#include "StreamCodecRegistry.h"
+#include "CompressedBlockData.h"
+
+#include "../orcom_bin/BitMemory.h"
+#include "../rc/ContextEncoder.h"
+#include "../ppmd/PPMd.h"
+
+#if LZ_STREAM_CODEC
+#	include <zlib.h>
+#endif
+
+
+bool StreamCodecRegistry::IsAvailable(uint32 codec_)
+{
+	if (codec_ == CompressorParams::LzStreamCodec)
+		return LZ_STREAM_CODEC != 0;
+	return codec_ < CompressorParams::StreamCodecsNum;
+}
+
+
+bool StreamCodecRegistry::IsApplicable(uint32 codec_, uint32 bufferId_)
+{
+	ASSERT(bufferId_ < DnaCompressedBin::BuffersNum);
+
+	if (bufferId_ < DnaCompressedBin::PPMdStartBuffer)
+		return codec_ == CompressorParams::ContextStreamCodec;
+
+	if (codec_ == CompressorParams::PackedDnaStreamCodec)
+		return bufferId_ == DnaCompressedBin::HardReadsBuffer;
+
+	return codec_ < CompressorParams::StreamCodecsNum;
+}
+
+
+const char* StreamCodecRegistry::Name(uint32 codec_)
+{
+	const char* names[] = {"PPMd", "context models", "raw", "LZ", "2-bit packing"};
+
+	ASSERT(codec_ < CompressorParams::StreamCodecsNum);
+	return names[codec_];
+}
+
+
+bool StreamCodecRegistry::Encode(uint32 codec_, const byte* in_, uint64 inSize_, byte* out_, uint64& outSize_,
+								 PpmdEncoder* ppmd_, const PpmdModel* ppmdModel_)
+{
+	ASSERT(IsAvailable(codec_));
+
+	switch (codec_)
+	{
+		case CompressorParams::PpmdStreamCodec:
+		{
+			ASSERT(ppmd_ != NULL);
+
+			// PPMd stops writing at the output limit, the full output is treated as not fitting
+			uint64_t size = outSize_;
+			if (!ppmd_->EncodeNextMember((byte*)in_, inSize_, out_, size, ppmdModel_) || size >= outSize_)
+				return false;
+			outSize_ = size;
+			return true;
+		}
+
+		case CompressorParams::ContextStreamCodec:
+			return EncodeContext(in_, inSize_, out_, outSize_);
+
+		case CompressorParams::RawStreamCodec:
+		{
+			if (inSize_ > outSize_)
+				return false;
+
+			std::copy(in_, in_ + inSize_, out_);
+			outSize_ = inSize_;
+			return true;
+		}
+
+		case CompressorParams::LzStreamCodec:
+			return EncodeLz(in_, inSize_, out_, outSize_);
+
+		case CompressorParams::PackedDnaStreamCodec:
+			return EncodePackedDna(in_, inSize_, out_, outSize_);
+	}
+	return false;
+}
+
+
+bool StreamCodecRegistry::Decode(uint32 codec_, const byte* in_, uint64 inSize_, byte* out_, uint64 outSize_,
+								 PpmdDecoder* ppmd_, const PpmdModel* ppmdModel_)
+{
+	ASSERT(!IsOnTheFly(codec_));
+
+	if (!IsAvailable(codec_))
+		return false;
+
+	switch (codec_)
+	{
+		case CompressorParams::PpmdStreamCodec:
+		{
+			ASSERT(ppmd_ != NULL);
+
+			uint64_t size = MAX(outSize_, inSize_);
+			if (!ppmd_->DecodeNextMember((byte*)in_, inSize_, out_, size, ppmdModel_))
+				return false;
+			return size == outSize_;
+		}
+
+		case CompressorParams::RawStreamCodec:
+		{
+			if (inSize_ != outSize_)
+				return false;
+
+			std::copy(in_, in_ + inSize_, out_);
+			return true;
+		}
+
+		case CompressorParams::LzStreamCodec:
+			return DecodeLz(in_, inSize_, out_, outSize_);
+
+		case CompressorParams::PackedDnaStreamCodec:
+			return DecodePackedDna(in_, inSize_, out_, outSize_);
+	}
+	return false;
+}
+
+
+// the context codec codes the streams on the fly, here only the whole streams are coded to
+// compare the codecs
+//
+bool StreamCodecRegistry::EncodeContext(const byte* in_, uint64 inSize_, byte* out_, uint64& outSize_)
+{
+	Buffer buffer(inSize_ + 64);
+	BitMemoryWriter writer(buffer);
+	RangeEncoder rc(writer);
+	ByteContextCoder* coder = new ByteContextCoder();
+
+	rc.Start();
+	for (uint64 i = 0; i < inSize_; ++i)
+		coder->EncodeSymbol(rc, in_[i]);
+	rc.End();
+
+	delete coder;
+
+	if (writer.Position() > outSize_)
+		return false;
+
+	std::copy(writer.Pointer(), writer.Pointer() + writer.Position(), out_);
+	outSize_ = writer.Position();
+	return true;
+}
+
+
+#if LZ_STREAM_CODEC
+
+bool StreamCodecRegistry::EncodeLz(const byte* in_, uint64 inSize_, byte* out_, uint64& outSize_)
+{
+	uLongf size = outSize_;
+	if (compress2(out_, &size, in_, inSize_, Z_BEST_COMPRESSION) != Z_OK)
+		return false;
+
+	outSize_ = size;
+	return true;
+}
+
+
+bool StreamCodecRegistry::DecodeLz(const byte* in_, uint64 inSize_, byte* out_, uint64 outSize_)
+{
+	uLongf size = outSize_;
+	return uncompress(out_, &size, in_, inSize_) == Z_OK && size == outSize_;
+}
+
+#else
+
+bool StreamCodecRegistry::EncodeLz(const byte* , uint64 , byte* , uint64& )
+{
+	return false;
+}
+
+
+bool StreamCodecRegistry::DecodeLz(const byte* , uint64 , byte* , uint64 )
+{
+	return false;
+}
+
+#endif
+
+
+// the 2-bit packed stream -- the number of the exceptions (the symbols other than ACGT, with
+// the gaps from the previous ones), followed by the bases packed 4 per byte, the exceptions
+// replaced by 'A'
+//
+static int32 PackedBaseCode(byte c_)
+{
+	switch (c_)
+	{
+		case 'A':	return 0;
+		case 'C':	return 1;
+		case 'G':	return 2;
+		case 'T':	return 3;
+	}
+	return -1;
+}
+
+
+static bool PutVarInt(uint64 value_, byte* out_, uint64& pos_, uint64 size_)
+{
+	do
+	{
+		if (pos_ >= size_)
+			return false;
+
+		out_[pos_++] = (byte)((value_ & 0x7F) | ((value_ > 0x7F) ? 0x80 : 0));
+		value_ >>= 7;
+	}
+	while (value_ != 0);
+	return true;
+}
+
+
+static bool GetVarInt(const byte* in_, uint64& pos_, uint64 size_, uint64& value_)
+{
+	value_ = 0;
+	for (uint32 shift = 0; shift < 64; shift += 7)
+	{
+		if (pos_ >= size_)
+			return false;
+
+		const byte b = in_[pos_++];
+		value_ |= (uint64)(b & 0x7F) << shift;
+		if ((b & 0x80) == 0)
+			return true;
+	}
+	return false;
+}
+
+
+bool StreamCodecRegistry::EncodePackedDna(const byte* in_, uint64 inSize_, byte* out_, uint64& outSize_)
+{
+	uint64 exceptionsNum = 0;
+	for (uint64 i = 0; i < inSize_; ++i)
+		exceptionsNum += (PackedBaseCode(in_[i]) < 0);
+
+	uint64 pos = 0;
+	if (!PutVarInt(exceptionsNum, out_, pos, outSize_))
+		return false;
+
+	uint64 prevPos = 0;
+	for (uint64 i = 0; i < inSize_; ++i)
+	{
+		if (PackedBaseCode(in_[i]) >= 0)
+			continue;
+
+		if (!PutVarInt(i - prevPos, out_, pos, outSize_) || pos >= outSize_)
+			return false;
+		out_[pos++] = in_[i];
+		prevPos = i;
+	}
+
+	if (pos + (inSize_ + 3) / 4 > outSize_)
+		return false;
+
+	for (uint64 i = 0; i < inSize_; i += 4)
+	{
+		byte b = 0;
+		for (uint64 j = i; j < i + 4; ++j)
+		{
+			const int32 code = (j < inSize_) ? PackedBaseCode(in_[j]) : 0;
+			b = (b << 2) | (code > 0 ? code : 0);
+		}
+		out_[pos++] = b;
+	}
+
+	outSize_ = pos;
+	return true;
+}
+
+
+bool StreamCodecRegistry::DecodePackedDna(const byte* in_, uint64 inSize_, byte* out_, uint64 outSize_)
+{
+	static const byte bases[4] = {'A', 'C', 'G', 'T'};
+
+	uint64 pos = 0;
+	uint64 exceptionsNum = 0;
+	if (!GetVarInt(in_, pos, inSize_, exceptionsNum))
+		return false;
+
+	// skip the exceptions to get to the bases
+	//
+	const uint64 exceptionsPos = pos;
+	for (uint64 i = 0; i < exceptionsNum; ++i)
+	{
+		uint64 gap;
+		if (!GetVarInt(in_, pos, inSize_, gap) || pos >= inSize_)
+			return false;
+		pos++;
+	}
+
+	if (inSize_ - pos != (outSize_ + 3) / 4)
+		return false;
+
+	for (uint64 i = 0; i < outSize_; ++i)
+		out_[i] = bases[(in_[pos + i / 4] >> (6 - 2 * (i % 4))) & 3];
+
+	// restore the exceptions
+	//
+	pos = exceptionsPos;
+	uint64 symbolPos = 0;
+	for (uint64 i = 0; i < exceptionsNum; ++i)
+	{
+		uint64 gap;
+		GetVarInt(in_, pos, inSize_, gap);
+		symbolPos += gap;
+		if (symbolPos >= outSize_)
+			return false;
+
+		out_[symbolPos] = in_[pos++];
+	}
+	return true;
+}
@@ -0,0 +1,69 @@
+/*
+  This file is a part of ORCOM software distributed under GNU GPL 2 licence.
+  Homepage:	http://sun.aei.polsl.pl/orcom
+  Github:	http://github.com/lrog/orcom
+
+  Authors: Sebastian Deorowicz, Szymon Grabowski and Lucas Roguski
+*/
+
+#ifndef H_STREAMCODECREGISTRY
+#define H_STREAMCODECREGISTRY
+
+#include "../orcom_bin/Globals.h"
+
+#include <stddef.h>
+
+#include "Params.h"
+
+#ifndef DISABLE_LZ_STREAM_CODEC
+#	define LZ_STREAM_CODEC 1
+#else
+#	define LZ_STREAM_CODEC 0
+#endif
+
+
+class PpmdEncoder;
+class PpmdDecoder;
+class PpmdModel;
+
+
+// the codecs of the block streams, the id of the codec used is stored per stream in the
+// block header (see CompressorParams::StreamCodecs). The flags, the reverse-complement flags
+// and the letters are always range-coded with their context models, the byte streams can be
+// coded with any of the available codecs, except the 2-bit packing which is dedicated to the
+// hard reads. The context codec codes the stream on the fly, while the stream is produced,
+// the other ones code the whole stream after the block is coded
+//
+class StreamCodecRegistry
+{
+public:
+	static bool IsAvailable(uint32 codec_);
+	static bool IsApplicable(uint32 codec_, uint32 bufferId_);
+	static const char* Name(uint32 codec_);
+
+	static bool IsOnTheFly(uint32 codec_)
+	{
+		return codec_ == CompressorParams::ContextStreamCodec;
+	}
+
+	// code the whole stream, returning false if the output does not fit in outSize_ bytes --
+	// the PPMd coder is used by the PPMd codec only, the model can be NULL. The decoded stream
+	// is outSize_ bytes long, the output buffer has to hold MAX(inSize_, outSize_) bytes
+	//
+	static bool Encode(uint32 codec_, const byte* in_, uint64 inSize_, byte* out_, uint64& outSize_,
+					   PpmdEncoder* ppmd_, const PpmdModel* ppmdModel_ = NULL);
+	static bool Decode(uint32 codec_, const byte* in_, uint64 inSize_, byte* out_, uint64 outSize_,
+					   PpmdDecoder* ppmd_, const PpmdModel* ppmdModel_ = NULL);
+
+private:
+	static bool EncodeContext(const byte* in_, uint64 inSize_, byte* out_, uint64& outSize_);
+
+	static bool EncodeLz(const byte* in_, uint64 inSize_, byte* out_, uint64& outSize_);
+	static bool DecodeLz(const byte* in_, uint64 inSize_, byte* out_, uint64 outSize_);
+
+	static bool EncodePackedDna(const byte* in_, uint64 inSize_, byte* out_, uint64& outSize_);
+	static bool DecodePackedDna(const byte* in_, uint64 inSize_, byte* out_, uint64 outSize_);
+};
+
+
+#endif // H_STREAMCODECREGISTRY
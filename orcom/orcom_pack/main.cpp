@@ -14,6 +14,8 @@
 #include "main.h"
 #include "DnarchModule.h"
 #include "Params.h"
+#include "CompressedBlockData.h"
+#include "StreamCodecRegistry.h"
 
 #include "../orcom_bin/Utils.h"
 #include "../orcom_bin/Thread.h"
@@ -24,7 +26,7 @@ uint32 InputArguments::DefaultThreadNumber = MIN(8, InputArguments::AvailableCor
 
 int main(int argc_, const char* argv_[])
 {
-	if (argc_ < 1 + 3 || (argv_[1][0] != 'e' && argv_[1][0] != 'd'))
+	if (argc_ < 1 + 3 || (argv_[1][0] != 'e' && argv_[1][0] != 'd' && argv_[1][0] != 'x'))
 	{
 		usage();
 		return -1;
@@ -36,6 +38,8 @@ int main(int argc_, const char* argv_[])
 
 	if (args.mode == InputArguments::EncodeMode)
 		return bin2dnarch(args);
+	if (args.mode == InputArguments::ExtractMode)
+		return dnarch2dnaExtract(args);
 	return dnarch2dna(args);
 }
 
@@ -47,7 +51,7 @@ void usage()
 	std::cerr << "Version: " << APP_VERSION << '\n';
 	std::cerr << "Authors: Sebastian Deorowicz, Szymon Grabowski and Lucas Roguski\n\n";
 
-	std::cerr << "usage:\n\torcom_pack <e|d> [options] -i<input_file> -o<output_file>\n";
+	std::cerr << "usage:\n\torcom_pack <e|d|x> [options] -i<input_file> -o<output_file>\n";
 	std::cerr << "options:\n";
 
 	std::cerr << "\t-i<file>\t: orcom_bin generated input files prefix\n";
@@ -57,7 +61,16 @@ void usage()
 	std::cerr << "\t-m<n>\t\t: mismatch cost, default: " << CompressorParams::DefaultMismatchCost << '\n';
 	std::cerr << "\t-s<n>\t\t: insert cost, default: " << CompressorParams::DefaultInsertCost << '\n';
 	std::cerr << "\t-t<n>\t\t: threads count, default: " << InputArguments::DefaultThreadNumber << '\n';
+	std::cerr << "\t-l<n>\t\t: max LZ candidates examined per read, default: 0 (0 - all)\n";
+	std::cerr << "\t-x<n>\t\t: split bins larger than n MB into independently compressed segments, default: 0 (0 - disabled)\n";
+	std::cerr << "\t-L<n>\t\t: compression level (1 - fast, 2 - default, 3 - max), presets -l, -C, -H and -T, default: " << DnaCodingParams::DefaultLevel << '\n';
+	std::cerr << "\t-C<n>\t\t: LzId, Shift, Len and Match streams codec (0 - PPMd, 1 - context models, 2 - raw, 3 - LZ), default: " << CompressorParams::DefaultStreamCodec << '\n';
+	std::cerr << "\t-H<n>\t\t: hard reads codec (0 - PPMd, 1 - context models, 2 - raw, 3 - LZ, 4 - 2-bit packing), default: " << CompressorParams::DefaultHardReadsCodec << '\n';
+	std::cerr << "\t-T\t\t: select the streams codecs by trial on the first bins, default: false\n";
 	std::cerr << "\t-v\t\t: verbose mode, default: false\n";
+	std::cerr << "extract (x) options:\n";
+	std::cerr << "\t-S<n>\t\t: extract only the reads of signature n, default: all\n";
+	std::cerr << "\t-r<n>\t\t: extract at most n reads, default: 0 (0 - all)\n";
 
 #if (DEV_TWEAK_MODE)
 	std::cerr << "\t-n<n>\t\t: max encode value, default: " << CompressorParams::DefaultMaxCostValue << '\n';
@@ -101,9 +114,50 @@ int dnarch2dna(const InputArguments& args_)
 }
 
 
+int dnarch2dnaExtract(const InputArguments& args_)
+{
+	try
+	{
+		DnarchModule module;
+		module.ExtractDna(args_.inputFile, args_.outputFile, args_.extractSignature,
+						  args_.extractRecordsNum, args_.verboseMode);
+	}
+	catch (const std::exception& e)
+	{
+		std::cerr << "Error: " << e.what() << std::endl;
+		return -1;
+	}
+
+	return 0;
+}
+
+
 bool parse_arguments(int argc_, const char* argv_[], InputArguments& outArgs_)
 {
-	outArgs_.mode = (argv_[1][0] == 'e') ? InputArguments::EncodeMode : InputArguments::DecodeMode;
+	switch (argv_[1][0])
+	{
+		case 'e':	outArgs_.mode = InputArguments::EncodeMode;		break;
+		case 'x':	outArgs_.mode = InputArguments::ExtractMode;	break;
+		default:	outArgs_.mode = InputArguments::DecodeMode;		break;
+	}
+
+	// the level presets are applied first, the explicit options override them
+	//
+	int level = DnaCodingParams::DefaultLevel;
+	for (int i = 2; i < argc_; ++i)
+	{
+		const char* param = argv_[i];
+		const int len = strlen(param);
+		if (param[0] == '-' && param[1] == 'L')
+			level = (len > 2 && len < 10) ? (int)to_num((const uchar*)param + 2, len - 2) : -1;
+	}
+
+	if (level < (int)DnaCodingParams::FastLevel || level > (int)DnaCodingParams::MaxLevel)
+	{
+		std::cerr << "Error: invalid compression level specified\n";
+		return false;
+	}
+	outArgs_.params.SetLevel(level);
 
 	// parse params
 	//
@@ -132,7 +186,14 @@ bool parse_arguments(int argc_, const char* argv_[], InputArguments& outArgs_)
 			case 's':	outArgs_.params.insertCost = pval;				break;
 			case 'm':	outArgs_.params.mismatchCost = pval;			break;
 			case 't':	outArgs_.threadsNum = pval;						break;
+			case 'x':	outArgs_.params.splitBinSize = pval;			break;
+			case 'C':	outArgs_.params.streamCodec = pval;				break;
+			case 'H':	outArgs_.params.hardReadsCodec = pval;			break;
+			case 'T':	outArgs_.params.streamCodecsTrial = true;		break;
+			case 'l':	outArgs_.params.lzCandidatesNum = pval;			break;
 			case 'v':	outArgs_.verboseMode = true;					break;
+			case 'S':	outArgs_.extractSignature = pval;				break;
+			case 'r':	outArgs_.extractRecordsNum = pval;				break;
 #if (DEV_TWEAK_MODE)
 			case 'n':	outArgs_.params.maxCostValue = pval;			break;
 			case 'f':	outArgs_.params.minBinSize = pval;				break;
@@ -160,5 +221,19 @@ bool parse_arguments(int argc_, const char* argv_[], InputArguments& outArgs_)
 		return false;
 	}
 
+	if (!StreamCodecRegistry::IsAvailable(outArgs_.params.streamCodec)
+			|| !StreamCodecRegistry::IsApplicable(outArgs_.params.streamCodec, DnaCompressedBin::LzIdBuffer))
+	{
+		std::cerr << "Error: invalid streams codec specified\n";
+		return false;
+	}
+
+	if (!StreamCodecRegistry::IsAvailable(outArgs_.params.hardReadsCodec)
+			|| !StreamCodecRegistry::IsApplicable(outArgs_.params.hardReadsCodec, DnaCompressedBin::HardReadsBuffer))
+	{
+		std::cerr << "Error: invalid hard reads codec specified\n";
+		return false;
+	}
+
 	return true;
 }
@@ -21,7 +21,8 @@ struct InputArguments
 	enum ModeEnum
 	{
 		EncodeMode,
-		DecodeMode
+		DecodeMode,
+		ExtractMode
 	};
 
 	static const bool DefaultVerboseMode = false;
@@ -38,9 +39,14 @@ struct InputArguments
 	uint32 threadsNum;
 	bool verboseMode;
 
+	int64 extractSignature;		// -1 - all
+	uint64 extractRecordsNum;	// 0 - all
+
 	InputArguments()
 		:	threadsNum(DefaultThreadNumber)
 		,	verboseMode(DefaultVerboseMode)
+		,	extractSignature(-1)
+		,	extractRecordsNum(0)
 	{}
 };
 
@@ -48,6 +54,7 @@ struct InputArguments
 void usage();
 int bin2dnarch(const InputArguments& args_);
 int dnarch2dna(const InputArguments& args_);
+int dnarch2dnaExtract(const InputArguments& args_);
 bool parse_arguments(int argc_, const char* argv_[], InputArguments& outArgs_);
 
 int main(int argc_, const char* argv_[]);
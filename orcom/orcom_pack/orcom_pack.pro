@@ -7,6 +7,7 @@ QMAKE_CXXFLAGS += -D_FILE_OFFSET_BITS=64 -D_LARGEFILE_SOURCE -DDISABLE_GZ_STREAM
 #QMAKE_CXXFLAGS += -DUSE_BOOST_THREAD
 QMAKE_CXXFLAGS += -std=c++0x
 
+LIBS += -lz
 LIBS += -lpthread
 #LIBS += -lboost_thread -lboost_system
 
@@ -15,14 +16,16 @@ HEADERS += \
     ../orcom_bin/utils.h \
     ../orcom_bin/Globals.h \
     ../orcom_bin/FileStream.h \
-    ../orcom_bin/DnaParser.h \
     ../orcom_bin/DnaPacker.h \
     ../orcom_bin/DataStream.h \
     ../orcom_bin/Buffer.h \
     ../orcom_bin/BitMemory.h \
     ../orcom_bin/BinFile.h \
+    ../orcom_bin/DnaRecordSorter.h \
     BinFileExtractor.h \
     DnaCompressor.h \
+    StreamCodecRegistry.h \
+    MismatchKernel.h \
     DnarchFile.h \
     DnarchModule.h \
     DnarchOperator.h \
@@ -42,12 +45,13 @@ HEADERS += \
 
 SOURCES += \
     ../orcom_bin/FileStream.cpp \
-    ../orcom_bin/DnaParser.cpp \
     ../orcom_bin/DnaPacker.cpp \
     ../orcom_bin/BinFile.cpp \
     BinFileExtractor.cpp \
     main.cpp \
     DnaCompressor.cpp \
+    StreamCodecRegistry.cpp \
+    MismatchKernel.cpp \
     DnarchFile.cpp \
     DnarchModule.cpp \
     DnarchOperator.cpp \
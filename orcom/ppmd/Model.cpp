@@ -614,3 +614,88 @@ STOP_DECODING:
 	//PrintInfo(DecodedFile,EncodedFile);
 	return;
 }
+
+// Model snapshots: the used parts of the heap -- the text area, the units and the contexts
+// -- and the model state, with the pointers stored as offsets from the heap start. Hence
+// a snapshot can be restored in any thread having the sub-allocator of the same size
+//
+struct PPMD_SNAPSHOT {
+    UINT HeapSize, TextSize, UnitsOffset, UnitsSize, HiOffset, AuxOffset;
+    UINT MaxContextOffset, FoundStateOffset, GlueCount, GlueCount1;
+    BLK_NODE BList[N_INDEXES+1];
+    SEE2_CONTEXT SEE2Cont[23][32], DummySEE2Cont;
+    WORD BinSumm[25][64];
+    int BSumm, OrderFall, RunLength, InitRL, MaxOrder;
+    BYTE NumMasked, PrevSuccess, EscCount;
+    BOOL CutOff;
+    _BYTE* Heap;
+};
+static const UINT SNAPSHOT_NULL=~0U;
+inline UINT SnapshotOffset(void* p) {
+    return (p != NULL && (_BYTE*)p >= HeapStart && (_BYTE*)p < HeapStart+SubAllocatorSize)?
+            (UINT)((_BYTE*)p-HeapStart):(SNAPSHOT_NULL);
+}
+inline _BYTE* SnapshotPointer(UINT Offset) {
+    return (Offset != SNAPSHOT_NULL)?(HeapStart+Offset):(NULL);
+}
+void* _STDCALL SaveModel()
+{
+    if ( !SubAllocatorSize )                return NULL;
+    PPMD_SNAPSHOT* s=new PPMD_SNAPSHOT;
+    s->HeapSize=SubAllocatorSize;           s->TextSize=pText-HeapStart;
+    s->UnitsOffset=UnitsStart-HeapStart;    s->UnitsSize=LoUnit-UnitsStart;
+    s->HiOffset=HiUnit-HeapStart;           s->AuxOffset=SnapshotOffset(AuxUnit);
+    s->MaxContextOffset=SnapshotOffset(MaxContext);
+    s->FoundStateOffset=SnapshotOffset(FoundState);
+    s->GlueCount=GlueCount;                 s->GlueCount1=GlueCount1;
+    memcpy(s->BList,BList,sizeof(BList));   memcpy(s->SEE2Cont,SEE2Cont,sizeof(SEE2Cont));
+    s->DummySEE2Cont=DummySEE2Cont;         memcpy(s->BinSumm,BinSumm,sizeof(BinSumm));
+    s->BSumm=BSumm;                         s->OrderFall=OrderFall;
+    s->RunLength=RunLength;                 s->InitRL=InitRL;
+    s->MaxOrder=MaxOrder;                   s->NumMasked=NumMasked;
+    s->PrevSuccess=PrevSuccess;             s->EscCount=EscCount;
+    s->CutOff=CutOff;
+    UINT ContextsSize=SubAllocatorSize-s->HiOffset;
+    s->Heap=new _BYTE[s->TextSize+s->UnitsSize+ContextsSize];
+    memcpy(s->Heap,HeapStart,s->TextSize);
+    memcpy(s->Heap+s->TextSize,UnitsStart,s->UnitsSize);
+    memcpy(s->Heap+s->TextSize+s->UnitsSize,HiUnit,ContextsSize);
+    return s;
+}
+int _STDCALL RestoreModel(const void* Snapshot)
+{
+    const PPMD_SNAPSHOT* s=(const PPMD_SNAPSHOT*)Snapshot;
+    if (s == NULL || s->HeapSize != SubAllocatorSize) return PPMD_ERR;
+    pText=HeapStart+s->TextSize;            UnitsStart=HeapStart+s->UnitsOffset;
+    LoUnit=UnitsStart+s->UnitsSize;         HiUnit=HeapStart+s->HiOffset;
+    AuxUnit=SnapshotPointer(s->AuxOffset);
+#if !defined(_32_NORMAL) && !defined(_64_EXOTIC)
+    HeapNull=HeapStart-1;
+#endif /* !defined(_32_NORMAL) && !defined(_64_EXOTIC) */
+    MaxContext=(PPM_CONTEXT*)SnapshotPointer(s->MaxContextOffset);
+    FoundState=(PPM_CONTEXT::STATE*)SnapshotPointer(s->FoundStateOffset);
+    GlueCount=s->GlueCount;                 GlueCount1=s->GlueCount1;
+    memcpy(BList,s->BList,sizeof(BList));   memcpy(SEE2Cont,s->SEE2Cont,sizeof(SEE2Cont));
+    DummySEE2Cont=s->DummySEE2Cont;         memcpy(BinSumm,s->BinSumm,sizeof(BinSumm));
+    BSumm=s->BSumm;                         OrderFall=s->OrderFall;
+    RunLength=s->RunLength;                 InitRL=s->InitRL;
+    MaxOrder=s->MaxOrder;                   NumMasked=s->NumMasked;
+    PrevSuccess=s->PrevSuccess;             EscCount=s->EscCount;
+    CutOff=s->CutOff;
+    UINT ContextsSize=SubAllocatorSize-s->HiOffset;
+    memcpy(HeapStart,s->Heap,s->TextSize);
+    memcpy(UnitsStart,s->Heap+s->TextSize,s->UnitsSize);
+    memcpy(HiUnit,s->Heap+s->TextSize+s->UnitsSize,ContextsSize);
+    return PPMD_OK;
+}
+UINT _STDCALL GetModelSize(const void* Snapshot)
+{
+    const PPMD_SNAPSHOT* s=(const PPMD_SNAPSHOT*)Snapshot;
+    return (s != NULL)?(s->TextSize+s->UnitsSize+(s->HeapSize-s->HiOffset)):(0);
+}
+void _STDCALL FreeModel(void* Snapshot)
+{
+    PPMD_SNAPSHOT* s=(PPMD_SNAPSHOT*)Snapshot;
+    if (s == NULL)                          return;
+    delete[] s->Heap;                       delete s;
+}
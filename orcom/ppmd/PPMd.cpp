@@ -25,11 +25,18 @@ unsigned int ppmd_used_memory();
 int ppmd_compress(unsigned char* pInMemory_, uint64_t inSize_,
 				  unsigned char* pOutMemory_, uint64_t* outSize_,
 				  unsigned int maxOrder_ = PPMD_DEFAULT_ORDER, bool useAutoAllocation_ = true,
-				  unsigned int allocatorSizeMb_ = PPMD_DEFAULT_ALLOC_SIZE_MB, bool doOrderCutOff_ = false);
+				  unsigned int allocatorSizeMb_ = PPMD_DEFAULT_ALLOC_SIZE_MB, bool doOrderCutOff_ = false,
+				  const void* model_ = NULL);
 
 int ppmd_decompress(unsigned char* pInMemory_, uint64_t inSize_,
 					unsigned char* pOutMemory_, uint64_t* outSize_,
-					bool useAutoAllocation_ = true, unsigned int allocatorSizeMb_ = PPMD_DEFAULT_ALLOC_SIZE_MB);
+					bool useAutoAllocation_ = true, unsigned int allocatorSizeMb_ = PPMD_DEFAULT_ALLOC_SIZE_MB,
+					const void* model_ = NULL);
+
+int ppmd_train(unsigned char* pInMemory_, uint64_t inSize_, unsigned int maxOrder_,
+			   unsigned int allocatorSizeMb_, void** model_);
+void ppmd_free_model(void* model_);
+uint64_t ppmd_model_size(const void* model_);
 
 
 // C++ class wrapper:
@@ -57,11 +64,13 @@ bool PpmdEncoder::StartCompress(unsigned  order_, unsigned int memorySize_)
 }
 
 bool PpmdEncoder::EncodeNextMember(unsigned char *inBuffer_, uint64_t inBufferSize_,
-								   unsigned char *outBuffer_, uint64_t &outBufferSize_)
+								   unsigned char *outBuffer_, uint64_t &outBufferSize_,
+								   const PpmdModel* model_)
 {
 	return ppmd_compress(inBuffer_, inBufferSize_,
 						 outBuffer_, &outBufferSize_,
-						 order, false) == PPMD_OK;
+						 order, false, PPMD_DEFAULT_ALLOC_SIZE_MB, false,
+						 model_ != NULL ? model_->snapshot : NULL) == PPMD_OK;
 }
 
 bool PpmdEncoder::FinishCompress()
@@ -91,11 +100,13 @@ bool PpmdDecoder::StartDecompress(unsigned int memorySizeMb_)
 }
 
 bool PpmdDecoder::DecodeNextMember(unsigned char *inBuffer_, uint64_t inBufferSize_,
-								   unsigned char *outBuffer_, uint64_t &outBufferSize_)
+								   unsigned char *outBuffer_, uint64_t &outBufferSize_,
+								   const PpmdModel* model_)
 {
 	return ppmd_decompress(inBuffer_, inBufferSize_,
 						   outBuffer_, &outBufferSize_,
-						   false) == PPMD_OK;
+						   false, PPMD_DEFAULT_ALLOC_SIZE_MB,
+						   model_ != NULL ? model_->snapshot : NULL) == PPMD_OK;
 }
 
 bool PpmdDecoder::FinishDecompress()
@@ -104,6 +115,34 @@ bool PpmdDecoder::FinishDecompress()
 }
 
 
+PpmdModel::PpmdModel()
+	:	snapshot(NULL)
+{}
+
+PpmdModel::~PpmdModel()
+{
+	Clear();
+}
+
+bool PpmdModel::Train(unsigned char *inBuffer_, uint64_t inBufferSize_,
+					  unsigned int order_, unsigned int memorySizeMb_)
+{
+	Clear();
+	return ppmd_train(inBuffer_, inBufferSize_, order_, memorySizeMb_, &snapshot) == PPMD_OK;
+}
+
+void PpmdModel::Clear()
+{
+	ppmd_free_model(snapshot);
+	snapshot = NULL;
+}
+
+uint64_t PpmdModel::Size() const
+{
+	return ppmd_model_size(snapshot);
+}
+
+
 // C-style function wrappers:
 //
 
@@ -115,11 +154,16 @@ int _STDCALL StartSubAllocator(UINT SASize);
 // Model:
 void EncodeFile(_PPMD_FILE* EncodedFile,_PPMD_FILE* DecodedFile, int MaxOrder,BOOL CutOff);
 void DecodeFile(_PPMD_FILE* DecodedFile,_PPMD_FILE* EncodedFile, int MaxOrder,BOOL CutOff);
+void* _STDCALL SaveModel();
+int _STDCALL RestoreModel(const void* Snapshot);
+UINT _STDCALL GetModelSize(const void* Snapshot);
+void _STDCALL FreeModel(void* Snapshot);
 
 int ppmd_compress(unsigned char *pInMemory_, uint64_t inSize_,
 				  unsigned char *pOutMemory_, uint64_t* outSize_,
 				  unsigned int maxOrder_, bool useAutoAllocation_,
-				  unsigned int allocatorSizeMb_, bool doOrderCutOff_)
+				  unsigned int allocatorSizeMb_, bool doOrderCutOff_,
+				  const void* model_)
 {
 	if (maxOrder_ == 0 || maxOrder_ > 9
 			|| outSize_ == NULL
@@ -132,7 +176,7 @@ int ppmd_compress(unsigned char *pInMemory_, uint64_t inSize_,
 
 	// write only important header shit
 	//
-	unsigned int header = ((int)doOrderCutOff_ << 7) | maxOrder_;
+	unsigned int header = ((int)doOrderCutOff_ << 7) | ((int)(model_ != NULL) << 6) | maxOrder_;
 	streamOut.Put(PPMD_CONTROL_BYTE);
 	streamOut.Put(header);
 
@@ -141,7 +185,12 @@ int ppmd_compress(unsigned char *pInMemory_, uint64_t inSize_,
 		ppmd_start_suballocator(allocatorSizeMb_);
 	}
 
-	EncodeFile(&streamOut, &streamIn, maxOrder_, doOrderCutOff_);
+	// continue the restored model in solid mode (order < 2)
+	//
+	if (model_ != NULL && RestoreModel(model_) != PPMD_OK)
+		return PPMD_ERR;
+
+	EncodeFile(&streamOut, &streamIn, model_ != NULL ? 1 : maxOrder_, doOrderCutOff_);
 
 	*outSize_ = streamOut.Position();
 
@@ -155,7 +204,8 @@ int ppmd_compress(unsigned char *pInMemory_, uint64_t inSize_,
 
 int ppmd_decompress(unsigned char *pInMemory_, uint64_t inSize_,
 					unsigned char *pOutMemory_, uint64_t* outSize_,
-					bool useAutoAllocation_, unsigned int allocatorSizeMb_)
+					bool useAutoAllocation_, unsigned int allocatorSizeMb_,
+					const void* model_)
 {
 	if (outSize_ == 0 || *outSize_ < inSize_
 			|| pInMemory_ == NULL || pOutMemory_ == NULL)
@@ -171,18 +221,27 @@ int ppmd_decompress(unsigned char *pInMemory_, uint64_t inSize_,
 		return PPMD_ERR;
 
 	header = streamIn.Get();
-	bool doCoutoff = (header & 80) != 0;
-	int maxOrder = header & 0x7F;
+	bool doCoutoff = (header & 0x80) != 0;
+	bool useModel = (header & 0x40) != 0;
+	int maxOrder = header & 0x3F;
 
 	if (maxOrder == 0 || maxOrder > 9)
 		return PPMD_ERR;
 
+	// the member was coded using the trained model
+	//
+	if (useModel && model_ == NULL)
+		return PPMD_ERR;
+
 	if (useAutoAllocation_)
 	{
 		ppmd_start_suballocator(allocatorSizeMb_);	// default: 10 MB
 	}
 
-	DecodeFile(&streamOut, &streamIn, maxOrder, doCoutoff);
+	if (useModel && RestoreModel(model_) != PPMD_OK)
+		return PPMD_ERR;
+
+	DecodeFile(&streamOut, &streamIn, useModel ? 1 : maxOrder, doCoutoff);
 
 	*outSize_ = streamOut.Position();
 
@@ -194,6 +253,26 @@ int ppmd_decompress(unsigned char *pInMemory_, uint64_t inSize_,
 	return PPMD_OK;
 }
 
+int ppmd_train(unsigned char *pInMemory_, uint64_t inSize_, unsigned int maxOrder_,
+			   unsigned int allocatorSizeMb_, void** model_)
+{
+	if (maxOrder_ < 2 || maxOrder_ > 9
+			|| pInMemory_ == NULL || model_ == NULL
+			|| ppmd_start_suballocator(allocatorSizeMb_) != PPMD_OK)
+		return PPMD_ERR;
+
+	// only the model matters, the output is discarded
+	//
+	unsigned char outMemory[16];
+	ByteStream streamIn(pInMemory_, inSize_);
+	ByteStream streamOut(outMemory, sizeof(outMemory));
+
+	EncodeFile(&streamOut, &streamIn, maxOrder_, false);
+
+	*model_ = SaveModel();
+	return *model_ != NULL ? PPMD_OK : PPMD_ERR;
+}
+
 int ppmd_start_suballocator(unsigned int subAllocatorSize_)
 {
 	return StartSubAllocator(subAllocatorSize_);
@@ -208,3 +287,13 @@ unsigned int ppmd_used_memory()
 {
 	return GetUsedMemory();
 }
+
+void ppmd_free_model(void* model_)
+{
+	FreeModel(model_);
+}
+
+uint64_t ppmd_model_size(const void* model_)
+{
+	return GetModelSize(model_);
+}
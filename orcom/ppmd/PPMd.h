@@ -8,11 +8,18 @@
 #define _PPMD_H_
 
 #include <stdint.h>
+#include <stddef.h>
 
 #ifdef  __cplusplus
 extern "C" {
 #endif
 
+class PpmdModel;
+
+// Each member is coded starting with a fresh model, unless the model snapshot is given --
+// then the coding starts with the restored statistics, and the same snapshot is needed
+// to decode the member
+//
 class PpmdEncoder
 {
 public:
@@ -28,7 +35,8 @@ public:
 
 	bool StartCompress(unsigned int order_ = DefaultOrder, unsigned int memorySize_ = DefaultMemorySizeMb);
 	bool EncodeNextMember(unsigned char* inBuffer_, uint64_t inBufferSize_,
-						  unsigned char* outBuffer_, uint64_t &outBufferSize_);
+						  unsigned char* outBuffer_, uint64_t &outBufferSize_,
+						  const PpmdModel* model_ = NULL);
 	bool FinishCompress();
 
 private:
@@ -49,10 +57,42 @@ public:
 
 	bool StartDecompress(unsigned int memorySizeMb_ = DefaultMemorySizeMb);
 	bool DecodeNextMember(unsigned char* inBuffer_, uint64_t inBufferSize_,
-						  unsigned char* outBuffer_, uint64_t &outBufferSize_);
+						  unsigned char* outBuffer_, uint64_t &outBufferSize_,
+						  const PpmdModel* model_ = NULL);
 	bool FinishDecompress();
 };
 
+// Snapshot of the model trained on the sample data. The training uses the sub-allocator
+// of the calling thread, which needs to have the same size as the one used for coding
+//
+class PpmdModel
+{
+public:
+	PpmdModel();
+	~PpmdModel();
+
+	bool Train(unsigned char* inBuffer_, uint64_t inBufferSize_,
+			   unsigned int order_ = PpmdEncoder::DefaultOrder,
+			   unsigned int memorySizeMb_ = PpmdEncoder::DefaultMemorySizeMb);
+	void Clear();
+
+	bool IsTrained() const
+	{
+		return snapshot != NULL;
+	}
+
+	uint64_t Size() const;
+
+private:
+	void* snapshot;
+
+	PpmdModel(const PpmdModel& );
+	PpmdModel& operator= (const PpmdModel& );
+
+	friend class PpmdEncoder;
+	friend class PpmdDecoder;
+};
+
 #ifdef  __cplusplus
 }
 #endif
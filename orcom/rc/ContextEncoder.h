@@ -42,8 +42,8 @@ public:
 	{
 		hash = 0;
 		symBuffer = 0;
-		CoderStatType* cd = (CoderStatType*)models;
-		std::fill(cd, cd + ModelCount * SymbolCount, 1);
+		for (uint32 i = 0; i < ModelCount; ++i)
+			models[i].Clear();
 	}
 
 protected:
@@ -54,7 +54,6 @@ protected:
 	static const uint64 HiPow = TPow<AlphabetSize, _TSymbolOrder-1>::Value;
 
 	typedef TSymbolCoderRC<AlphabetSize> Coder;
-	typedef typename Coder::StatType CoderStatType;
 
 	Coder* models;
 	THash hash;
@@ -90,8 +89,21 @@ public:
 
 	TStaticContextCoderBase()
 		:	hash(0)
+		,	symbolHashMask(SymbolHashMask)
+		,	usedModelCount(ModelCount)
 	{}
 
+	// lowers the context order of the symbols, only the models of the shorter contexts are
+	// used (and cleared) then
+	//
+	void SetOrder(uint32 order_)
+	{
+		ASSERT(order_ > 0 && order_ <= SymbolOrder);
+
+		symbolHashMask = (1ULL << (order_ * AlphabetBits)) - 1;
+		usedModelCount = 1 << (AlphabetBits * (order_ + TotalOrder - SymbolOrder));
+	}
+
 	void EncodeSymbol(RangeEncoder& rc_, uint32 sym_)
 	{
 		models[GetHash()].EncodeSymbol(rc_, sym_);
@@ -113,15 +125,14 @@ public:
 		// clear hash
 		hash = 0;
 
-		// clear stats -- fill context data with initial '1' value
-		CoderStatType* cd = (CoderStatType*)models;
-		std::fill(cd, cd + ModelCount * AlphabetSize, 1);
+		// clear stats -- reset the used models to the initial '1' frequencies
+		for (uint32 i = 0; i < usedModelCount; ++i)
+			models[i].Clear();
 	}
 
 protected:
 	typedef uint64 HashType;
 	typedef TSymbolCoderRC<AlphabetSize> Coder;
-	typedef typename Coder::StatType CoderStatType;
 
 	static const HashType HashMask = (1ULL << (TotalOrder * AlphabetBits)) - 1;
 	static const HashType SymbolHashMask = (1ULL << (SymbolOrder * AlphabetBits)) - 1;
@@ -130,10 +141,12 @@ protected:
 
 	Coder models[ModelCount];
 	HashType hash;
+	HashType symbolHashMask;
+	uint32 usedModelCount;
 
 	HashType GetHash()
 	{
-		return hash & SymbolHashMask;
+		return hash & symbolHashMask;
 	}
 
 	void UpdateHash(uint32 sym_)
@@ -206,6 +219,236 @@ private:
 };
 
 
+// codes the byte symbols bit by bit, starting from the most significant one. Every bit is
+// predicted by the adaptive binary models of the already coded bit prefix in two contexts:
+// order-0 and order-1 (the previous symbol). The predictions are mixed in the logistic domain
+// with the weights selected by the prefix and trained online. The binary models adapt fast
+// after the reset and slow down with the number of updates
+//
+class ByteContextCoder
+{
+public:
+	static const uint32 AlphabetSize = 256;
+
+	ByteContextCoder()
+		:	order1Models(NULL)
+	{
+		order1Models = new BitModel[AlphabetSize * AlphabetSize];
+		Clear();
+	}
+
+	ByteContextCoder(const ByteContextCoder& coder_)
+		:	order1Models(NULL)
+	{
+		order1Models = new BitModel[AlphabetSize * AlphabetSize];
+		*this = coder_;
+	}
+
+	~ByteContextCoder()
+	{
+		delete[] order1Models;
+	}
+
+	ByteContextCoder& operator=(const ByteContextCoder& coder_)
+	{
+		if (this == &coder_)
+			return *this;
+
+		std::copy(coder_.order0Models, coder_.order0Models + AlphabetSize, order0Models);
+		std::copy(coder_.order1Models, coder_.order1Models + AlphabetSize * AlphabetSize, order1Models);
+		std::copy(&coder_.weights[0][0], &coder_.weights[0][0] + AlphabetSize * InputsNum, &weights[0][0]);
+		prevSym = coder_.prevSym;
+		return *this;
+	}
+
+	void EncodeSymbol(RangeEncoder& rc_, uint32 sym_)
+	{
+		ASSERT(sym_ < AlphabetSize);
+
+		uint32 node = 1;
+		for (int32 i = 7; i >= 0; --i)
+		{
+			const uint32 bit = (sym_ >> i) & 1;
+			const uint32 prob = Predict(node);
+
+			if (bit == 0)
+				rc_.EncodeFrequency(prob, 0, ProbScale);
+			else
+				rc_.EncodeFrequency(ProbScale - prob, prob, ProbScale);
+
+			UpdateBit(node, bit, prob);
+			node = (node << 1) | bit;
+		}
+		prevSym = sym_;
+	}
+
+	uint32 DecodeSymbol(RangeDecoder& rc_)
+	{
+		uint32 node = 1;
+		for (uint32 i = 0; i < 8; ++i)
+		{
+			const uint32 prob = Predict(node);
+			const uint32 bit = rc_.GetCumulativeFreq(ProbScale) >= prob;
+
+			if (bit == 0)
+				rc_.UpdateFrequency(prob, 0, ProbScale);
+			else
+				rc_.UpdateFrequency(ProbScale - prob, prob, ProbScale);
+
+			UpdateBit(node, bit, prob);
+			node = (node << 1) | bit;
+		}
+		prevSym = node - AlphabetSize;
+		return prevSym;
+	}
+
+	// updates the models as if the symbol was coded
+	//
+	void Update(uint32 sym_)
+	{
+		ASSERT(sym_ < AlphabetSize);
+
+		uint32 node = 1;
+		for (int32 i = 7; i >= 0; --i)
+		{
+			const uint32 bit = (sym_ >> i) & 1;
+			UpdateBit(node, bit, Predict(node));
+			node = (node << 1) | bit;
+		}
+		prevSym = sym_;
+	}
+
+	void Clear()
+	{
+		BitModel m;
+		m.prob = ProbScale / 2;
+		m.count = 0;
+
+		std::fill(order0Models, order0Models + AlphabetSize, m);
+		std::fill(order1Models, order1Models + AlphabetSize * AlphabetSize, m);
+		std::fill(&weights[0][0], &weights[0][0] + AlphabetSize * InputsNum, (int32)InitialWeight);
+		prevSym = 0;
+	}
+
+private:
+	static const uint32 ProbBits = 12;
+	static const uint32 ProbScale = 1 << ProbBits;
+	static const uint32 MinProb = 16;
+	static const uint32 MaxUpdateCount = 30;
+
+	// the mixer -- 16.16 fixed point weights of the stretched predictions and the bias
+	//
+	static const uint32 InputsNum = 3;
+	static const int32 InitialWeight = 19661;
+	static const int32 BiasInput = 128;
+	static const int32 MixerRate = 21;
+
+	struct BitModel
+	{
+		uint16 prob;			// of the bit being 0
+		uint16 count;
+	};
+
+	BitModel order0Models[AlphabetSize];			// the bit prefixes tree, 1-based
+	BitModel* order1Models;							// the trees for every previous symbol
+	int32 weights[AlphabetSize][InputsNum];
+	uint32 prevSym;
+
+	int32 inputs[InputsNum];
+
+	uint32 Predict(uint32 node_)
+	{
+		inputs[0] = Stretch(order0Models[node_].prob);
+		inputs[1] = Stretch(order1Models[(prevSym << 8) | node_].prob);
+		inputs[2] = BiasInput;
+
+		const int32* w = weights[node_];
+		const int64 dot = (int64)w[0] * inputs[0] + (int64)w[1] * inputs[1] + (int64)w[2] * inputs[2];
+
+		const uint32 prob = Squash((int32)(dot >> 16));
+		return MIN(MAX(prob, MinProb), ProbScale - MinProb);
+	}
+
+	void UpdateBit(uint32 node_, uint32 bit_, uint32 prob_)
+	{
+		const int32 err = ((int32)((bit_ ^ 1) << ProbBits) - (int32)prob_) * MixerRate;
+
+		int32* w = weights[node_];
+		for (uint32 i = 0; i < InputsNum; ++i)
+			w[i] += (inputs[i] * err + 0x8000) >> 16;
+
+		UpdateModel(order0Models[node_], bit_);
+		UpdateModel(order1Models[(prevSym << 8) | node_], bit_);
+	}
+
+	void UpdateModel(BitModel& m_, uint32 bit_)
+	{
+		// the adaptation rate is 1/(count+2) -- the reciprocals are scaled by 2^16
+		//
+		static const uint16 rates[MaxUpdateCount + 1] = {
+			32768, 21845, 16384, 13107, 10923, 9362, 8192, 7282, 6554, 5958, 5461,
+			5041, 4681, 4369, 4096, 3855, 3641, 3449, 3277, 3121, 2979, 2849,
+			2731, 2621, 2521, 2427, 2341, 2260, 2185, 2114, 2048
+		};
+
+		const uint32 rate = rates[m_.count];
+		if (bit_ == 0)
+			m_.prob += ((ProbScale - m_.prob) * rate) >> 16;
+		else
+			m_.prob -= (m_.prob * rate) >> 16;
+
+		m_.prob = MIN(MAX(m_.prob, MinProb), ProbScale - MinProb);
+		if (m_.count < MaxUpdateCount)
+			m_.count++;
+	}
+
+	// the logistic function and its inverse in the fixed point: the probabilities are scaled
+	// by 2^12 and the log-odds by 2^8, both computed on integers to be platform-independent
+	//
+	static uint32 Squash(int32 d_)
+	{
+		static const int32 points[33] = {
+			1, 2, 3, 6, 10, 16, 27, 45, 73, 120, 194, 310, 488, 747, 1101, 1546,
+			2047, 2549, 2994, 3348, 3607, 3785, 3901, 3975, 4024, 4050, 4068, 4079,
+			4085, 4089, 4092, 4093, 4094
+		};
+
+		if (d_ > 2047)
+			return ProbScale - 1;
+		if (d_ < -2047)
+			return 1;
+
+		const int32 w = d_ & 127;
+		const int32 i = (d_ >> 7) + 16;
+		return (points[i] * (128 - w) + points[i + 1] * w + 64) >> 7;
+	}
+
+	static int32 Stretch(uint32 prob_)
+	{
+		struct StretchTable
+		{
+			int16 values[ProbScale];
+
+			StretchTable()
+			{
+				uint32 p = 0;
+				for (int32 d = -2047; d <= 2047; ++d)
+				{
+					const uint32 v = Squash(d);
+					for ( ; p <= v; ++p)
+						values[p] = d;
+				}
+				for ( ; p < ProbScale; ++p)
+					values[p] = 2047;
+			}
+		};
+
+		static const StretchTable table;
+		return table.values[prob_];
+	}
+};
+
+
 template <class _TRangeCoder, class _TBitMemory>
 struct TCoderBase : public ICoder
 {
@@ -13,7 +13,20 @@
 
 #include "RangeCoder.h"
 
-
+#if defined(__GNUC__) && defined(__SSE2__)
+#	define SYMBOL_CODER_SSE2 1
+#	include <emmintrin.h>
+#else
+#	define SYMBOL_CODER_SSE2 0
+#endif
+
+
+// adaptive frequency model of a small alphabet -- the cumulative frequencies (the high ends of
+// the symbols' ranges) are kept instead of the frequencies, so the total is the last one and
+// the coded range is looked up directly. For 8 symbols the update and the decoding lookup are
+// single SSE2 operations over the whole model. The statistics evolve exactly as the frequency
+// counts would, with the same increments and rescaling, so the coded streams are unchanged
+//
 template <uint32 _TMaxSymbolCount>
 class TSymbolCoderRC
 {
@@ -31,14 +44,11 @@ public:
 		ASSERT(sym_ < MaxSymbolCount);
 
 		uint32 acc = Accumulate();
-		uint32 loEnd = 0;
-
-		for (uint32 i = 0; i < sym_; ++i)
-			loEnd += stats[i];
+		uint32 loEnd = (sym_ > 0) ? hiEnds[sym_ - 1] : 0;
 
-		rc_.EncodeFrequency(stats[sym_], loEnd, acc);
+		rc_.EncodeFrequency(hiEnds[sym_] - loEnd, loEnd, acc);
 
-		stats[sym_] += StepSize;
+		Update(sym_);
 	}
 
 	uint32 DecodeSymbol(RangeDecoder& rc_)
@@ -46,19 +56,18 @@ public:
 		uint32 acc = Accumulate();
 		uint32 cul = rc_.GetCumulativeFreq(acc);
 
-		uint32 idx, hiEnd;
-		for (idx = 0, hiEnd = 0; (hiEnd += stats[idx]) <= cul; ++idx)
-			;
-		hiEnd -= stats[idx];
+		uint32 idx = Find(cul);
+		uint32 loEnd = (idx > 0) ? hiEnds[idx - 1] : 0;
 
-		rc_.UpdateFrequency(stats[idx], hiEnd, acc);
-		stats[idx] += StepSize;
+		rc_.UpdateFrequency(hiEnds[idx] - loEnd, loEnd, acc);
+		Update(idx);
 		return idx;
 	}
 
 	void Clear()
 	{
-		std::fill(stats, stats + MaxSymbolCount, 1);
+		for (uint32 i = 0; i < MaxSymbolCount; ++i)
+			hiEnds[i] = i + 1;
 	}
 
 private:
@@ -67,28 +76,71 @@ private:
 
 	void Rescale()
 	{
+		uint32 prevEnd = 0;
+		uint32 acc = 0;
 		for (uint32 i = 0; i < MaxSymbolCount; ++i)
-			stats[i] -= stats[i] >> 1;		// no '>>=' to avoid reducing stats to 0
+		{
+			uint32 freq = hiEnds[i] - prevEnd;
+			prevEnd = hiEnds[i];
+
+			acc += freq - (freq >> 1);		// no '>>=' to avoid reducing stats to 0
+			hiEnds[i] = acc;
+		}
 	}
 
 	uint32 Accumulate()
 	{
-		uint32 acc = 0;
-		for (uint32 i = 0; i < MaxSymbolCount; ++i)
-			acc += stats[i];
+		if (hiEnds[MaxSymbolCount - 1] >= MaxAccumulatedValue)
+			Rescale();
 
-		if (acc >= MaxAccumulatedValue)
+		return hiEnds[MaxSymbolCount - 1];
+	}
+
+	// adds the step to the high ends of the symbol and the following ones
+	//
+	void Update(uint32 sym_)
+	{
+#if SYMBOL_CODER_SSE2
+		if (MaxSymbolCount == 8)
 		{
-			acc = 0;
-			Rescale();
-			for (uint32 i = 0; i < MaxSymbolCount; ++i)
-				acc += stats[i];
+			const __m128i lanes = _mm_set_epi16(8, 7, 6, 5, 4, 3, 2, 1);
+			const __m128i mask = _mm_cmpgt_epi16(lanes, _mm_set1_epi16((int16)sym_));
+			__m128i v = _mm_loadu_si128((const __m128i*)hiEnds);
+
+			v = _mm_add_epi16(v, _mm_and_si128(mask, _mm_set1_epi16(StepSize)));
+			_mm_storeu_si128((__m128i*)hiEnds, v);
+			return;
 		}
+#endif
+		for (uint32 i = 0; i < MaxSymbolCount; ++i)
+			hiEnds[i] += (i >= sym_) ? StepSize : 0;
+	}
 
-		return acc;
+	// returns the symbol of the range containing the cumulative frequency -- the high ends are
+	// increasing, so it is the number of the ones not above it, for 8 symbols counted at once
+	//
+	uint32 Find(uint32 cul_) const
+	{
+#if SYMBOL_CODER_SSE2
+		if (MaxSymbolCount == 8)
+		{
+			// the unsigned 'hiEnd <= cul' as the saturated difference being 0, the matching
+			// lanes form a prefix
+			const __m128i v = _mm_loadu_si128((const __m128i*)hiEnds);
+			const __m128i le = _mm_cmpeq_epi16(_mm_subs_epu16(v, _mm_set1_epi16((int16)cul_)), _mm_setzero_si128());
+			const uint32 idx = __builtin_ctz(~(uint32)_mm_movemask_epi8(le)) >> 1;
+
+			// a corrupted stream can give the frequency past the total
+			return MIN(idx, MaxSymbolCount - 1);
+		}
+#endif
+		uint32 idx = 0;
+		while (idx < MaxSymbolCount - 1 && hiEnds[idx] <= cul_)
+			++idx;
+		return idx;
 	}
 
-	StatType stats[MaxSymbolCount];			// can be assumed to be uint16
+	StatType hiEnds[MaxSymbolCount];		// the cumulative frequencies
 };
 
 
@@ -13,10 +13,13 @@
 #include "../orcom_bin/BitMemory.h"
 
 
-class BinaryRleEncoder : public ICoder
+// the symbols are written to any byte sink providing PutByte()
+//
+template <class _TWriter>
+class TBinaryRleEncoder : public ICoder
 {
 public:
-	BinaryRleEncoder(BitMemoryWriter& writer_)
+	TBinaryRleEncoder(_TWriter& writer_)
 		:	writer(writer_)
 		,	currentCount(0)
 	{}
@@ -63,7 +66,7 @@ private:
 	static const uint32 RleMax = 255;
 	static const uint32 RleOffset = 2;
 
-	BitMemoryWriter& writer;
+	_TWriter& writer;
 
 	uint32 currentCount;
 
@@ -74,10 +77,13 @@ private:
 };
 
 
-class BinaryRleDecoder : public ICoder
+// the symbols are read from any byte source providing GetByte(), Position() and Size()
+//
+template <class _TReader>
+class TBinaryRleDecoder : public ICoder
 {
 public:
-	BinaryRleDecoder(BitMemoryReader& reader_)
+	TBinaryRleDecoder(_TReader& reader_)
 		:	reader(reader_)
 		,	currentCount(0)
 		,	onlyMatches(false)
@@ -114,7 +120,7 @@ private:
 	static const uint32 RleOffset = 2;
 	static const uint32 RleMax = 255;
 
-	BitMemoryReader& reader;
+	_TReader& reader;
 	uint32 currentCount;
 	bool onlyMatches;
 
@@ -129,4 +135,8 @@ private:
 };
 
 
+typedef TBinaryRleEncoder<BitMemoryWriter> BinaryRleEncoder;
+typedef TBinaryRleDecoder<BitMemoryReader> BinaryRleDecoder;
+
+
 #endif // RLEENCODER_H
@@ -0,0 +1,63 @@
+#!/bin/bash
+
+# measures the orcom_pack compression levels on the given FASTQ file: the reads are binned
+# once, then for each level the compression and decompression speed (the best of the
+# runs) in Mbases/s and the archive size in bits per base are reported, checking that
+# each archive decodes to the same reads
+
+orcom_bin=$1/orcom_bin
+orcom_pack=$1/orcom_pack
+in_fastq=$2
+levels=${3:-"1 2 3"}
+runs=${RUNS:-3}
+threads=${THREADS:-1}
+tmp=${TMPDIR:-/tmp}/bench_levels_$$
+
+
+####
+#
+# main
+#
+if [[ $# -lt 2 ]]; then
+	echo "Usage: ./$( basename $0 ) <orcom_binaries_path> <in_fastq_file> [\"<-L values>\"]"
+	echo "  environment: RUNS (default: 3), THREADS (default: 1), BIN_OPTIONS (orcom_bin options)"
+	exit 1
+fi
+
+best_ms()
+{
+	best=
+	for (( r = 0; r < runs; ++r )); do
+		start=$(date +%s%N)
+		"$@" > /dev/null 2>&1 || { echo "Error: $1 failed" >&2; exit 1; }
+		ms=$(( ($(date +%s%N) - start) / 1000000 ))
+		if [[ -z $best || $ms -lt $best ]]; then
+			best=$ms
+		fi
+	done
+	echo $(( best > 0 ? best : 1 ))
+}
+
+$orcom_bin e -i$in_fastq -o$tmp.bin -t$threads $BIN_OPTIONS > /dev/null 2>&1 || { echo "Error: binning failed"; exit 1; }
+
+printf "%-6s %10s %10s %12s %12s %12s %8s\n" "-L" "enc ms" "dec ms" "enc Mbase/s" "dec Mbase/s" "bits/base" "reads"
+
+for l in $levels; do
+	enc_ms=$(best_ms $orcom_pack e -i$tmp.bin -o$tmp -t$threads -L$l) || exit 1
+	dec_ms=$(best_ms $orcom_pack d -i$tmp -o$tmp.dna -t$threads) || exit 1
+
+	sort $tmp.dna > $tmp.sorted
+	if [[ -e $tmp.ref ]]; then
+		cmp -s $tmp.sorted $tmp.ref && check=ok || check=DIFFER
+	else
+		mv $tmp.sorted $tmp.ref
+		check=ok
+	fi
+
+	bases=$(( $(stat -c%s $tmp.dna) - $(wc -l < $tmp.dna) ))
+	size=$(( $(stat -c%s $tmp.cdna) + $(stat -c%s $tmp.cmeta) ))
+	awk -v l=$l -v e=$enc_ms -v d=$dec_ms -v b=$bases -v s=$size -v c=$check 'BEGIN {
+		printf "%-6s %10d %10d %12.1f %12.1f %12.3f %8s\n", l, e, d, b / e / 1000, b / d / 1000, s * 8 / b, c }'
+done
+
+rm -f $tmp.bin.bdna $tmp.bin.bmeta $tmp.cdna $tmp.cmeta $tmp.dna $tmp.sorted $tmp.ref
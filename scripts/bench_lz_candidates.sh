@@ -0,0 +1,57 @@
+#!/bin/bash
+
+# measures the LZ match search of orcom_pack for the given -l settings (max LZ candidates
+# examined per read, 0 - all): single-threaded compression time (the best of the runs),
+# records/s and the archive size, checking that each archive decodes to the same reads
+
+orcom_pack=$1/orcom_pack
+in_bins=$2
+candidates=${3:-"0 4 8 16 32 64"}
+runs=${RUNS:-3}
+tmp=${TMPDIR:-/tmp}/bench_lz_$$
+
+
+####
+#
+# main
+#
+if [[ $# -lt 2 ]]; then
+	echo "Usage: ./$( basename $0 ) <orcom_binaries_path> <in_bins_prefix> [\"<-l values>\"]"
+	echo "  in_bins_prefix: the output of orcom_bin, environment: RUNS (default: 3)"
+	exit 1
+fi
+
+best_ms()
+{
+	best=
+	for (( r = 0; r < runs; ++r )); do
+		start=$(date +%s%N)
+		"$@" > /dev/null 2>&1 || { echo "Error: $1 failed" >&2; exit 1; }
+		ms=$(( ($(date +%s%N) - start) / 1000000 ))
+		if [[ -z $best || $ms -lt $best ]]; then
+			best=$ms
+		fi
+	done
+	echo $best
+}
+
+printf "%-8s %10s %12s %12s %8s\n" "-l" "enc ms" "records/s" "size" "reads"
+
+for l in $candidates; do
+	ms=$(best_ms $orcom_pack e -i$in_bins -o$tmp -t1 -l$l) || exit 1
+
+	$orcom_pack d -i$tmp -o$tmp.dna -t1 > /dev/null 2>&1 || { echo "Error: decoding failed"; exit 1; }
+	sort $tmp.dna > $tmp.sorted
+	if [[ -e $tmp.ref ]]; then
+		cmp -s $tmp.sorted $tmp.ref && check=ok || check=DIFFER
+	else
+		mv $tmp.sorted $tmp.ref
+		check=ok
+	fi
+
+	records=$(wc -l < $tmp.dna)
+	size=$(( $(stat -c%s $tmp.cdna) + $(stat -c%s $tmp.cmeta) ))
+	printf "%-8s %10d %12d %12d %8s\n" $l $ms $(( records * 1000 / (ms > 0 ? ms : 1) )) $size $check
+done
+
+rm -f $tmp.cdna $tmp.cmeta $tmp.dna $tmp.sorted $tmp.ref
@@ -1,9 +1,6 @@
 #!/bin/bash
 
-bin_tmp_prefix=__tmp.bin
-
-orcom_bin=$1/orcom_bin
-orcom_pack=$1/orcom_pack
+orcom=$1/orcom
 
 in_fastq=$2
 out_orcom=$3
@@ -18,13 +15,7 @@ if [[ ! $# -eq 3 ]]; then
 	exit 1
 fi
 
-echo "Binning..."
-$orcom_bin e -i$in_fastq -o$bin_tmp_prefix
-
-echo "Packing..."
-$orcom_pack e -i$bin_tmp_prefix -o$out_orcom
-
-echo "Cleaning..."
-rm $bin_tmp_prefix*
+echo "Binning and packing..."
+$orcom e -i$in_fastq -o$out_orcom
 
 echo "Done!"
@@ -0,0 +1,244 @@
+/*
+  This file is a part of ORCOM software distributed under GNU GPL 2 licence.
+  Homepage:	http://sun.aei.polsl.pl/orcom
+  Github:	http://github.com/lrog/orcom
+
+  Authors: Sebastian Deorowicz, Szymon Grabowski and Lucas Roguski
+*/
+
+#include "../../orcom/orcom_bin/Globals.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <map>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <algorithm>
+
+#include "../../orcom/orcom_bin/DnaCategorizer.h"
+#include "../../orcom/orcom_bin/DnaBlockData.h"
+
+
+// measures the bin re-balancing of orcom_bin on a block with many tiny bins -- reads sampled
+// from a random genome long enough for most of the signature bins to stay below the minimum
+// bin size, so most of the records go through the re-balancing. Reported are:
+//  - the extraction of the re-balancing candidates (the unique signatures of a read with their
+//    first positions) done with the previous std::map and with the flat sorted array used by
+//    DnaCategorizer::FindMinimizers,
+//  - the whole DnaCategorizer::Categorize pass, with and without the re-balancing
+//
+struct Candidate
+{
+	uint32 minimizer;
+	uint16 pos;
+
+	bool operator< (const Candidate& c_) const
+	{
+		return minimizer < c_.minimizer || (minimizer == c_.minimizer && pos < c_.pos);
+	}
+};
+
+
+typedef std::chrono::steady_clock Clock;
+
+static double ElapsedMs(Clock::time_point start_)
+{
+	return std::chrono::duration<double, std::milli>(Clock::now() - start_).count();
+}
+
+
+static uint64 ExtractWithMap(MinimizerKernel& kernel_, const MinimizerParameters& params_,
+							 const std::vector<DnaRecord>& records_)
+{
+	const uint32 suffixMask = (1 << (2 * params_.signatureSuffixLen)) - 1;
+	uint32 sigs[MinimizerKernel::BufferSize];
+	uint64 checksum = 0;
+
+	for (uint64 r = 0; r < records_.size(); ++r)
+	{
+		const DnaRecord& rec = records_[r];
+		kernel_.ComputeSignatures(rec.dna, rec.len, sigs);
+
+		std::map<uint32, uint16> signatures;
+		for (int32 i = 0; i < rec.len - params_.signatureLen + 1 - params_.skipZoneLen; ++i)
+		{
+			if (sigs[i] == MinimizerKernel::InvalidSignature)
+				continue;
+
+			const uint32 m = sigs[i] & suffixMask;
+			if (signatures.count(m) == 0)
+				signatures[m] = i + (params_.signatureLen - params_.signatureSuffixLen);
+		}
+
+		for (std::map<uint32, uint16>::iterator i = signatures.begin(); i != signatures.end(); ++i)
+			checksum = checksum * 31 + i->first * 257 + i->second;
+	}
+	return checksum;
+}
+
+
+static uint64 ExtractWithArray(MinimizerKernel& kernel_, const MinimizerParameters& params_,
+							   const std::vector<DnaRecord>& records_)
+{
+	const uint32 suffixMask = (1 << (2 * params_.signatureSuffixLen)) - 1;
+	uint32 sigs[MinimizerKernel::BufferSize];
+	Candidate candidates[DnaRecord::MaxDnaLen + 1];
+	uint64 checksum = 0;
+
+	for (uint64 r = 0; r < records_.size(); ++r)
+	{
+		const DnaRecord& rec = records_[r];
+		kernel_.ComputeSignatures(rec.dna, rec.len, sigs);
+
+		uint32 count = 0;
+		for (int32 i = 0; i < rec.len - params_.signatureLen + 1 - params_.skipZoneLen; ++i)
+		{
+			if (sigs[i] == MinimizerKernel::InvalidSignature)
+				continue;
+
+			candidates[count].minimizer = sigs[i] & suffixMask;
+			candidates[count].pos = i + (params_.signatureLen - params_.signatureSuffixLen);
+			count++;
+		}
+
+		std::sort(candidates, candidates + count);
+
+		uint32 unique = MIN(count, 1);
+		for (uint32 i = 1; i < count; ++i)
+		{
+			if (candidates[i].minimizer != candidates[unique - 1].minimizer)
+				candidates[unique++] = candidates[i];
+		}
+
+		for (uint32 i = 0; i < unique; ++i)
+			checksum = checksum * 31 + candidates[i].minimizer * 257 + candidates[i].pos;
+	}
+	return checksum;
+}
+
+
+static double Categorize(const MinimizerParameters& params_, const CategorizerParameters& catParams_,
+						 const std::vector<char>& dna_, uint32 readLen_, uint64 readsNum_,
+						 uint64& nBinSize_, uint64& tinyBinsSize_, uint32 tinyBinSize_)
+{
+	// the records are modified in place (reverse-complemented), so each run uses a fresh copy
+	//
+	std::vector<char> dna(dna_);
+	std::vector<DnaRecord> records(readsNum_);
+	for (uint64 i = 0; i < readsNum_; ++i)
+	{
+		records[i].dna = &dna[i * readLen_];
+		records[i].len = readLen_;
+	}
+
+	DnaCategorizer categorizer(params_, catParams_);
+	DnaBinBlock bins(params_.TotalMinimizersCount());
+
+	const Clock::time_point start = Clock::now();
+	categorizer.Categorize(records, readsNum_, bins);
+	const double ms = ElapsedMs(start);
+
+	nBinSize_ = bins.nBin.Size();
+	tinyBinsSize_ = 0;
+	for (uint32 i = 0; i < bins.stdBins.Size(); ++i)
+	{
+		if (bins.stdBins[i].Size() < tinyBinSize_)
+			tinyBinsSize_ += bins.stdBins[i].Size();
+	}
+	return ms;
+}
+
+
+int main(int argc_, char* argv_[])
+{
+	if (argc_ > 1 && argv_[1][0] == '-')
+	{
+		fprintf(stderr, "usage: categorizer_bench [reads_num = 200000] [read_len = 100] "
+						"[genome_len = 50000000] [signature_len = 12]\n");
+		return 1;
+	}
+
+	const uint64 readsNum = (argc_ > 1) ? atoll(argv_[1]) : 200000;
+	const uint32 readLen = (argc_ > 2) ? atoi(argv_[2]) : 100;
+	const uint64 genomeLen = (argc_ > 3) ? atoll(argv_[3]) : 50000000;
+	const uint32 sigLen = (argc_ > 4) ? atoi(argv_[4]) : 12;
+
+	if (readLen < 32 || readLen > DnaRecord::MaxDnaLen || genomeLen < readLen || sigLen < 4 || sigLen > 15)
+	{
+		fprintf(stderr, "Error: invalid parameters\n");
+		return 1;
+	}
+
+	// generate the reads from both strands of a random genome
+	//
+	std::mt19937_64 rng(1);
+	const char bases[] = "ACGT";
+
+	std::vector<char> genome(genomeLen);
+	for (uint64 i = 0; i < genomeLen; ++i)
+		genome[i] = bases[rng() & 3];
+
+	std::vector<char> dna(readsNum * readLen);
+	for (uint64 i = 0; i < readsNum; ++i)
+	{
+		const uint64 pos = rng() % (genomeLen - readLen + 1);
+		char* read = &dna[i * readLen];
+		std::copy(genome.begin() + pos, genome.begin() + pos + readLen, read);
+
+		if (rng() & 1)
+		{
+			std::reverse(read, read + readLen);
+			for (uint32 j = 0; j < readLen; ++j)
+				read[j] = bases[3 - (std::find(bases, bases + 4, read[j]) - bases)];
+		}
+	}
+
+	MinimizerParameters params(sigLen, MIN(sigLen, 8), 12);
+	CategorizerParameters catParams;
+
+	std::vector<DnaRecord> records(readsNum);
+	for (uint64 i = 0; i < readsNum; ++i)
+	{
+		records[i].dna = &dna[i * readLen];
+		records[i].len = readLen;
+	}
+
+	printf("%llu reads of length %u, genome length %llu, signature length %u, %s kernel\n",
+		   (unsigned long long)readsNum, readLen, (unsigned long long)genomeLen, sigLen,
+		   MinimizerKernel::DetectInstructionSet() == MinimizerKernel::InstrScalar ? "scalar" : "vectorized");
+
+	MinimizerKernel kernel(params);
+
+	Clock::time_point start = Clock::now();
+	const uint64 mapChecksum = ExtractWithMap(kernel, params, records);
+	const double mapMs = ElapsedMs(start);
+
+	start = Clock::now();
+	const uint64 arrayChecksum = ExtractWithArray(kernel, params, records);
+	const double arrayMs = ElapsedMs(start);
+
+	if (mapChecksum != arrayChecksum)
+	{
+		fprintf(stderr, "Error: the candidates differ\n");
+		return 1;
+	}
+
+	printf("candidate extraction, std::map:    %8.1f ms, %6.2f M reads/s\n", mapMs, readsNum / mapMs / 1000.0);
+	printf("candidate extraction, flat array:  %8.1f ms, %6.2f M reads/s\n", arrayMs, readsNum / arrayMs / 1000.0);
+
+	const uint32 minBinSize = catParams.minBlockBinSize;
+	uint64 nBinSize = 0;
+	uint64 tinyBinsSize = 0;
+
+	const double withMs = Categorize(params, catParams, dna, readLen, readsNum, nBinSize, tinyBinsSize, minBinSize);
+	printf("categorize, re-balancing:          %8.1f ms, %6.2f M reads/s, N bin: %llu reads\n",
+		   withMs, readsNum / withMs / 1000.0, (unsigned long long)nBinSize);
+
+	catParams.minBlockBinSize = 0;
+	const double withoutMs = Categorize(params, catParams, dna, readLen, readsNum, nBinSize, tinyBinsSize, minBinSize);
+	printf("categorize, no re-balancing:       %8.1f ms, %6.2f M reads/s, reads in bins below %u: %llu\n",
+		   withoutMs, readsNum / withoutMs / 1000.0, minBinSize, (unsigned long long)tinyBinsSize);
+
+	return 0;
+}
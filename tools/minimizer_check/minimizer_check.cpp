@@ -0,0 +1,144 @@
+/*
+  This file is a part of ORCOM software distributed under GNU GPL 2 licence.
+  Homepage:	http://sun.aei.polsl.pl/orcom
+  Github:	http://github.com/lrog/orcom
+
+  Authors: Sebastian Deorowicz, Szymon Grabowski and Lucas Roguski
+*/
+
+#include "../../orcom/orcom_bin/Globals.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <random>
+
+#include "../../orcom/orcom_bin/MinimizerKernel.h"
+
+
+// compares the signatures computed by the vectorized MinimizerKernel variants available on
+// this CPU with the scalar ones -- on random reads made of the DNA symbols mixed with the
+// lowercase, IUPAC and arbitrary bytes, which all have to be treated as 'N'
+//
+static const char* InstructionSetName(MinimizerKernel::InstructionSet instrSet_)
+{
+	const char* names[] = {"scalar", "SSE4.2", "AVX2"};
+	return names[instrSet_];
+}
+
+
+static void GenerateRead(std::mt19937& rng_, uint32 len_, uint32 noiseLevel_, char* dna_)
+{
+	static const char dnaSymbols[] = "ACGTN";
+	static const char otherSymbols[] = "acgtnRYKMSWBDHVrykmswbdhvqQXx-.*";
+
+	for (uint32 i = 0; i < len_; ++i)
+	{
+		const uint32 r = rng_() % 1000;
+		if (r >= noiseLevel_)
+			dna_[i] = dnaSymbols[(r % 64 == 0) ? 4 : rng_() % 4];
+		else if (r % 2 == 0)
+			dna_[i] = otherSymbols[rng_() % (sizeof(otherSymbols) - 1)];
+		else
+			dna_[i] = (char)(1 + rng_() % 255);
+	}
+}
+
+
+static bool CheckRead(MinimizerKernel& scalar_, MinimizerKernel& simd_, const char* dna_, uint32 len_,
+					  std::mt19937& rng_)
+{
+	uint32 sigScalar[MinimizerKernel::BufferSize];
+	uint32 sigSimd[MinimizerKernel::BufferSize];
+
+	const int32 windows = scalar_.ComputeSignatures(dna_, len_, sigScalar);
+	if (simd_.ComputeSignatures(dna_, len_, sigSimd) != windows)
+		return false;
+
+	for (int32 i = 0; i < windows; ++i)
+	{
+		if (sigScalar[i] != sigSimd[i])
+			return false;
+	}
+
+	// the forward-only window ranges, as used by the categorizer, and the random ones on both
+	// strands, also reaching past the read end
+	//
+	for (uint32 t = 0; t < 4; ++t)
+	{
+		const int32 span = (int32)len_ + 8;
+		const int32 fwdBeg = (int32)(rng_() % span);
+		const int32 fwdEnd = fwdBeg + (int32)(rng_() % span) - 4;
+		const int32 revBeg = (t == 0) ? 0 : (int32)(rng_() % span);
+		const int32 revEnd = (t == 0) ? -1 : revBeg + (int32)(rng_() % span) - 4;
+
+		uint32 minFwd[2], minRev[2];
+		scalar_.FindMinimumSignatures(dna_, len_, fwdBeg, fwdEnd, revBeg, revEnd, minFwd[0], minRev[0]);
+		simd_.FindMinimumSignatures(dna_, len_, fwdBeg, fwdEnd, revBeg, revEnd, minFwd[1], minRev[1]);
+
+		if (minFwd[0] != minFwd[1] || minRev[0] != minRev[1])
+			return false;
+	}
+	return true;
+}
+
+
+int main(int argc_, char* argv_[])
+{
+	const uint32 readsNum = (argc_ > 1) ? atoi(argv_[1]) : 20000;
+	const uint32 noiseLevels[] = {0, 5, 50, 500};
+
+	MinimizerKernel::InstructionSet instrSets[] = {MinimizerKernel::InstrSse42, MinimizerKernel::InstrAvx2};
+	const MinimizerKernel::InstructionSet maxInstrSet = MinimizerKernel::DetectInstructionSet();
+
+	char dna[MinimizerKernel::BufferSize];
+	uint32 failures = 0;
+
+	for (uint32 s = 0; s < 2; ++s)
+	{
+		if (instrSets[s] > maxInstrSet)
+		{
+			printf("%s: not supported, skipped\n", InstructionSetName(instrSets[s]));
+			continue;
+		}
+
+		for (uint32 sigLen = 3; sigLen <= 15; ++sigLen)
+		{
+			MinimizerParameters params(sigLen, MIN(sigLen, 8), 12);
+			MinimizerKernel* scalar = new MinimizerKernel(params, MinimizerKernel::InstrScalar);
+			MinimizerKernel* simd = new MinimizerKernel(params, instrSets[s]);
+			std::mt19937 rng(sigLen);
+
+			uint32 sigFailures = 0;
+			for (uint32 i = 0; i < readsNum; ++i)
+			{
+				const uint32 len = (i % 8 == 0) ? rng() % (DnaRecord::MaxDnaLen + 1) : 100 + rng() % 52;
+				const uint32 noise = noiseLevels[i % 4];
+
+				memset(dna, 0, sizeof(dna));
+				GenerateRead(rng, len, noise, dna);
+
+				if (!CheckRead(*scalar, *simd, dna, len, rng))
+					sigFailures++;
+			}
+
+			if (sigFailures > 0)
+				printf("%s: signature length %u: %u of %u reads differ\n", InstructionSetName(instrSets[s]),
+					   sigLen, sigFailures, readsNum);
+			failures += sigFailures;
+
+			delete simd;
+			delete scalar;
+		}
+
+		printf("%s: checked\n", InstructionSetName(instrSets[s]));
+	}
+
+	if (failures > 0)
+	{
+		printf("FAILED: %u reads differ from the scalar kernel\n", failures);
+		return 1;
+	}
+
+	printf("OK\n");
+	return 0;
+}
@@ -0,0 +1,201 @@
+/*
+  This file is a part of ORCOM software distributed under GNU GPL 2 licence.
+  Homepage:	http://sun.aei.polsl.pl/orcom
+  Github:	http://github.com/lrog/orcom
+
+  Authors: Sebastian Deorowicz, Szymon Grabowski and Lucas Roguski
+*/
+
+#include "../../orcom/orcom_bin/Globals.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <deque>
+#include <vector>
+#include <atomic>
+#include <chrono>
+#include <algorithm>
+
+#include "../../orcom/orcom_bin/DataQueue.h"
+
+
+// measures the contention on the parts queue shared by the threads -- half of the threads push
+// the parts with the ids taken from a shared counter, the other half pop them, with no work
+// done on the parts. Compared are the previous queue (the parts sorted on every push, all the
+// waiting threads notified), and the current TDataQueue with the ordered and the unordered
+// delivery, in ms and M parts/s
+//
+template <class _TDataType>
+class TSortedDataQueue
+{
+	typedef _TDataType DataType;
+	typedef std::pair<int64, DataType*> part_pair;
+	typedef std::deque<part_pair> part_queue;
+
+public:
+	TSortedDataQueue(uint32 maxPartNum_, uint32 threadNum_)
+		:	maxPartNum(maxPartNum_)
+		,	currentThreadMask(0)
+	{
+		completedThreadMask = ((uint64)1 << threadNum_) - 1;
+	}
+
+	void SetCompleted()
+	{
+		mt::lock_guard<mt::mutex> lock(mutex);
+
+		currentThreadMask = (currentThreadMask << 1) | 1;
+		queueEmptyCondition.notify_all();
+	}
+
+	void Push(int64 partId_, const DataType* part_)
+	{
+		mt::unique_lock<mt::mutex> lock(mutex);
+
+		while (parts.size() > maxPartNum && partId_ > parts.front().first)
+			queueFullCondition.wait(lock);
+
+		parts.push_back(std::make_pair(partId_, (DataType*)part_));
+		if(parts.size() > 1)
+		{
+			std::sort(parts.begin(), parts.end(), sortByPartId);
+		}
+
+		queueEmptyCondition.notify_one();
+	}
+
+	bool Pop(int64 &partId_, DataType* &part_)
+	{
+		mt::unique_lock<mt::mutex> lock(mutex);
+
+		while ((parts.size() == 0) && currentThreadMask != completedThreadMask)
+			queueEmptyCondition.wait(lock);
+
+		if (parts.size() != 0)
+		{
+			partId_ = parts.front().first;
+			part_ = parts.front().second;
+			parts.pop_front();
+			queueFullCondition.notify_one();
+			return true;
+		}
+		return false;
+	}
+
+private:
+	const uint32 maxPartNum;
+	uint64 completedThreadMask;
+	uint64 currentThreadMask;
+	part_queue parts;
+
+	mt::mutex mutex;
+	mt::condition_variable queueFullCondition;
+	mt::condition_variable queueEmptyCondition;
+
+	static bool sortByPartId(const part_pair& p1_, const part_pair& p2_)
+	{
+		return p1_.first < p2_.first;
+	}
+};
+
+
+typedef std::chrono::steady_clock Clock;
+
+template <class _TQueue>
+static double RunQueue(_TQueue& queue_, uint32 producersNum_, uint32 consumersNum_, uint64 partsNum_)
+{
+	std::atomic<int64> nextId(0);
+	std::atomic<uint64> poppedNum(0);
+	uint32 part = 0;
+
+	std::vector<mt::thread*> threads;
+	Clock::time_point start = Clock::now();
+
+	for (uint32 i = 0; i < producersNum_; ++i)
+	{
+		threads.push_back(new mt::thread([&]()
+		{
+			int64 id;
+			while ((id = nextId++) < (int64)partsNum_)
+				queue_.Push(id, &part);
+			queue_.SetCompleted();
+		}));
+	}
+
+	for (uint32 i = 0; i < consumersNum_; ++i)
+	{
+		threads.push_back(new mt::thread([&]()
+		{
+			int64 id;
+			uint32* p;
+			uint64 n = 0;
+			while (queue_.Pop(id, p))
+				n++;
+			poppedNum += n;
+		}));
+	}
+
+	for (uint32 i = 0; i < threads.size(); ++i)
+	{
+		threads[i]->join();
+		delete threads[i];
+	}
+
+	double ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+	if (poppedNum != partsNum_)
+	{
+		fprintf(stderr, "Error: %llu parts popped of %llu\n", (unsigned long long)poppedNum.load(),
+				(unsigned long long)partsNum_);
+		exit(1);
+	}
+	return ms;
+}
+
+
+int main(int argc_, char* argv_[])
+{
+	if (argc_ > 1 && argv_[1][0] == '-')
+	{
+		fprintf(stderr, "usage: queue_bench [parts_num = 200000] [max_parts_in_queue = 64] "
+						"[max_threads = 64]\n");
+		return 0;
+	}
+
+	const uint64 partsNum = (argc_ > 1) ? atoll(argv_[1]) : 200000;
+	const uint32 maxPartNum = (argc_ > 2) ? atoi(argv_[2]) : 64;
+	const uint32 maxThreads = (argc_ > 3) ? atoi(argv_[3]) : 64;
+
+	if (partsNum == 0 || maxPartNum == 0 || maxThreads < 2 || maxThreads > 64)
+	{
+		fprintf(stderr, "Error: invalid parameters\n");
+		return -1;
+	}
+
+	typedef TSortedDataQueue<uint32> SortedQueue;
+	typedef TDataQueue<uint32> Queue;
+
+	printf("%llu parts, at most %u parts in the queue\n", (unsigned long long)partsNum, maxPartNum);
+	printf("threads       sorted (ms)   ordered (ms)   unordered (ms)   M parts/s: sorted/ordered/unordered\n");
+
+	for (uint32 t = 2; t <= maxThreads; t *= 2)
+	{
+		const uint32 producersNum = t / 2;
+		const uint32 consumersNum = t - producersNum;
+
+		SortedQueue sortedQueue(maxPartNum, producersNum);
+		const double sortedMs = RunQueue(sortedQueue, producersNum, consumersNum, partsNum);
+
+		Queue orderedQueue(maxPartNum, producersNum, Queue::OrderedDelivery);
+		const double orderedMs = RunQueue(orderedQueue, producersNum, consumersNum, partsNum);
+
+		Queue unorderedQueue(maxPartNum, producersNum, Queue::UnorderedDelivery);
+		const double unorderedMs = RunQueue(unorderedQueue, producersNum, consumersNum, partsNum);
+
+		printf("%4u (%2u/%2u) %12.1f %14.1f %16.1f   %6.2f / %6.2f / %6.2f\n",
+			   t, producersNum, consumersNum, sortedMs, orderedMs, unorderedMs,
+			   partsNum / sortedMs / 1000.0, partsNum / orderedMs / 1000.0, partsNum / unorderedMs / 1000.0);
+	}
+
+	return 0;
+}